@@ -0,0 +1,99 @@
+// Compares the generator based neighbor and segment walks in wforge/2d.h with
+// the allocation free offset tables and SegmentTiles used by element steps.
+#include "wforge/2d.h"
+#include <chrono>
+#include <cstdint>
+#include <print>
+
+namespace {
+
+constexpr int world_size = 500;
+constexpr int segment_length = 8;
+constexpr int rounds = 20;
+
+template<typename Fn>
+void runCase(const char *name, Fn &&fn) {
+	std::uint64_t checksum = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int r = 0; r < rounds; ++r) {
+		for (int y = 0; y < world_size; ++y) {
+			for (int x = 0; x < world_size; ++x) {
+				checksum += fn(x, y);
+			}
+		}
+	}
+	auto elapsed = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - start
+	);
+
+	double ns_per_call = elapsed.count() * 1e6
+		/ (static_cast<double>(rounds) * world_size * world_size);
+	std::println(
+		"{:<28} {:>9.2f} ms {:>7.2f} ns/call  (checksum {})", name,
+		elapsed.count(), ns_per_call, checksum
+	);
+}
+
+bool inBounds(int x, int y) noexcept {
+	return x >= 0 && x < world_size && y >= 0 && y < world_size;
+}
+
+} // namespace
+
+int main() {
+	using namespace wf;
+	const std::array<int, 2> dim{world_size, world_size};
+
+	runCase("neighbors4 generator", [&](int x, int y) {
+		int sum = 0;
+		for (auto [nx, ny] : neighbors4({x, y}, dim)) {
+			sum += nx ^ ny;
+		}
+		return sum;
+	});
+	runCase("neighbor4_offsets", [&](int x, int y) {
+		int sum = 0;
+		for (auto [dx, dy] : neighbor4_offsets) {
+			if (inBounds(x + dx, y + dy)) {
+				sum += (x + dx) ^ (y + dy);
+			}
+		}
+		return sum;
+	});
+
+	runCase("neighbors8 generator", [&](int x, int y) {
+		int sum = 0;
+		for (auto [nx, ny] : neighbors8({x, y}, dim)) {
+			sum += nx ^ ny;
+		}
+		return sum;
+	});
+	runCase("neighbor8_offsets", [&](int x, int y) {
+		int sum = 0;
+		for (auto [dx, dy] : neighbor8_offsets) {
+			if (inBounds(x + dx, y + dy)) {
+				sum += (x + dx) ^ (y + dy);
+			}
+		}
+		return sum;
+	});
+
+	// Roughly the distance a falling pixel covers in one step
+	runCase("tilesOnSegment generator", [&](int x, int y) {
+		int sum = 0;
+		for (auto [tx, ty] :
+		     tilesOnSegment({x, y}, {x + 3, y + segment_length})) {
+			sum += tx ^ ty;
+		}
+		return sum;
+	});
+	runCase("SegmentTiles", [&](int x, int y) {
+		int sum = 0;
+		for (auto [tx, ty] : SegmentTiles({x, y}, {x + 3, y + segment_length})) {
+			sum += tx ^ ty;
+		}
+		return sum;
+	});
+
+	return 0;
+}
@@ -0,0 +1,111 @@
+// Compares the float heat kernel with the fixed point ones, scalar and SIMD,
+// on the levels of the level sequence. Levels hold little heat until the
+// player lights something, so the bottom rows of each map are heated first.
+#include "wforge/assets.h"
+#include "wforge/fallsand.h"
+#include "wforge/level.h"
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <print>
+#include <utility>
+
+std::filesystem::path wf::_executable_path;
+
+namespace {
+
+constexpr int warmup_ticks = 120;
+constexpr int heat_steps = 200;
+
+constexpr std::pair<wf::HeatKernel, const char *> kernels[] = {
+	{wf::HeatKernel::Float, "float"},
+	{wf::HeatKernel::Scalar, "fixed scalar"},
+	{wf::HeatKernel::SSE41, "fixed sse4.1"},
+	{wf::HeatKernel::AVX2, "fixed avx2"},
+};
+
+// Steps nothing but the heat
+struct HeatOnlyWorld : wf::PixelWorld {
+	explicit HeatOnlyWorld(wf::PixelWorld world)
+		: PixelWorld(std::move(world)) {}
+
+	using PixelWorld::thermalAnalysisStep;
+};
+
+std::uint64_t totalHeatOf(const wf::PixelWorld &world) noexcept {
+	std::uint64_t total = 0;
+	for (int y = 0; y < world.height(); ++y) {
+		for (int x = 0; x < world.width(); ++x) {
+			total += world.tagOf(x, y).heat;
+		}
+	}
+	return total;
+}
+
+void runLevel(const wf::LevelMetadata &metadata) {
+	auto level = wf::Level::loadFromMetadata(metadata);
+	level.fallsand.setParallelStep(true);
+	for (int tick = 0; tick < warmup_ticks; ++tick) {
+		level.step();
+	}
+
+	auto &world = level.fallsand;
+	const int hot_from = world.height() - world.height() / 4;
+	for (int y = hot_from; y < world.height(); ++y) {
+		for (int x = 0; x < world.width(); ++x) {
+			world.tagOf(x, y).heat = wf::PixelTag::heat_max;
+		}
+	}
+
+	std::println(
+		"{} ({}x{}, {} tiles)", metadata.map_id, world.width(),
+		world.height(), world.tilesX() * world.tilesY()
+	);
+
+	double float_ms = 0;
+	for (const auto &[kernel, name] : kernels) {
+		if (!wf::PixelWorld::isHeatKernelSupported(kernel)) {
+			std::println("  {:<14} not supported by this CPU", name);
+			continue;
+		}
+
+		wf::PixelWorld::setHeatKernel(kernel);
+		HeatOnlyWorld heat_world(world.fork());
+		auto start = std::chrono::steady_clock::now();
+		for (int step = 0; step < heat_steps; ++step) {
+			heat_world.thermalAnalysisStep();
+		}
+		auto elapsed = std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - start
+		);
+
+		const double ms_per_step = elapsed.count() / heat_steps;
+		if (kernel == wf::HeatKernel::Float) {
+			float_ms = ms_per_step;
+		}
+		std::println(
+			"  {:<14} {:>8.3f} ms/step {:>6.2f}x  (total heat {})", name,
+			ms_per_step, float_ms / ms_per_step, totalHeatOf(heat_world)
+		);
+	}
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+	wf::_executable_path = argc > 0 ? std::filesystem::absolute(argv[0])
+	                                : std::filesystem::current_path();
+	wf::AssetsManager::loadAllAssets();
+
+	const auto default_kernel = wf::PixelWorld::heatKernel();
+	const auto &level_seq =
+		wf::AssetsManager::instance().getAsset<wf::LevelSequence>(
+			"level-sequence"
+		);
+	for (const auto *metadata : level_seq.levels) {
+		runLevel(*metadata);
+	}
+	wf::PixelWorld::setHeatKernel(default_kernel);
+
+	return 0;
+}
@@ -2,10 +2,25 @@
 #define WFORGE_2D_H
 
 #include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
 #include <generator>
+#include <iterator>
 
 namespace wf {
 
+struct Vec2f {
+	float x = .0f;
+	float y = .0f;
+
+	constexpr Vec2f &operator+=(const Vec2f &other) noexcept {
+		x += other.x;
+		y += other.y;
+		return *this;
+	}
+};
+
 enum class FacingDirection : std::uint8_t {
 	North = 0,
 	East = 1,
@@ -51,7 +66,112 @@ inline constexpr FacingDirection rotate90CCW(FacingDirection dir) noexcept {
 	);
 }
 
-// All tiles from start to end inclusively
+// Offsets of the 4-neighbors and 8-neighbors, in the order neighbors4() and
+// neighbors8() yield them
+inline constexpr std::array<std::array<int, 2>, 4> neighbor4_offsets{{
+	{-1, 0},
+	{1, 0},
+	{0, -1},
+	{0, 1},
+}};
+
+inline constexpr std::array<std::array<int, 2>, 8> neighbor8_offsets{{
+	{-1, -1},
+	{-1, 0},
+	{-1, 1},
+	{0, -1},
+	{0, 1},
+	{1, -1},
+	{1, 0},
+	{1, 1},
+}};
+
+// All tiles from start to end inclusively, like tilesOnSegment(). Walks the
+// segment in place with Bresenham's line algorithm, so unlike the generator
+// it never allocates. Use it in steps that run per pixel.
+class SegmentTiles {
+public:
+	class Iterator {
+	public:
+		using value_type = std::array<int, 2>;
+		using difference_type = std::ptrdiff_t;
+
+		constexpr Iterator() noexcept = default;
+
+		constexpr Iterator(
+			std::array<int, 2> start, std::array<int, 2> end
+		) noexcept
+			: _x(start[0])
+			, _y(start[1])
+			, _x1(end[0])
+			, _y1(end[1])
+			, _dx(std::abs(end[0] - start[0]))
+			, _dy(-std::abs(end[1] - start[1]))
+			, _sx(start[0] < end[0] ? 1 : -1)
+			, _sy(start[1] < end[1] ? 1 : -1)
+			, _err(_dx + _dy) {}
+
+		constexpr value_type operator*() const noexcept {
+			return {_x, _y};
+		}
+
+		constexpr Iterator &operator++() noexcept {
+			if (_x == _x1 && _y == _y1) {
+				_done = true;
+				return *this;
+			}
+
+			int e2 = 2 * _err;
+			if (e2 >= _dy) {
+				_err += _dy;
+				_x += _sx;
+			}
+			if (e2 <= _dx) {
+				_err += _dx;
+				_y += _sy;
+			}
+			return *this;
+		}
+
+		constexpr Iterator operator++(int) noexcept {
+			Iterator old = *this;
+			++*this;
+			return old;
+		}
+
+		constexpr bool operator==(std::default_sentinel_t) const noexcept {
+			return _done;
+		}
+
+	private:
+		int _x = 0, _y = 0;
+		int _x1 = 0, _y1 = 0;
+		int _dx = 0, _dy = 0;
+		int _sx = 0, _sy = 0;
+		int _err = 0;
+		bool _done = false;
+	};
+
+	constexpr SegmentTiles(
+		std::array<int, 2> start, std::array<int, 2> end
+	) noexcept
+		: _start(start), _end(end) {}
+
+	constexpr Iterator begin() const noexcept {
+		return Iterator(_start, _end);
+	}
+
+	constexpr std::default_sentinel_t end() const noexcept {
+		return std::default_sentinel;
+	}
+
+private:
+	std::array<int, 2> _start;
+	std::array<int, 2> _end;
+};
+
+// All tiles from start to end inclusively. Each call allocates a coroutine
+// frame, per pixel steps use SegmentTiles and the offset tables instead.
 std::generator<std::array<int, 2>> tilesOnSegment(
 	std::array<int, 2> start, std::array<int, 2> end
 ) noexcept;
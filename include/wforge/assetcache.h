@@ -0,0 +1,50 @@
+#ifndef WFORGE_ASSETCACHE_H
+#define WFORGE_ASSETCACHE_H
+
+#include <map>
+#include <string>
+
+namespace wf {
+
+// Cache of loaded assets, singleton
+// The simulation only reads from the cache (pixel shapes, level metadata),
+// populating it is up to the client, see AssetsManager::loadAllAssets
+class AssetsManager {
+public:
+	static AssetsManager &instance() noexcept;
+
+	// Load all assets from the `assets/` directory, respecting manifest.json
+	// See assets/README.md and assets/manifest.json for details
+	// Defined by the game client, not part of wforge_sim
+	static void loadAllAssets();
+
+	// Only what the simulation reads: images, pixel shapes and the level
+	// metadata without minimap textures. Needs no display or audio device.
+	// Defined by the game client, not part of wforge_sim
+	static void loadSimulationAssets();
+
+	// throws for unrecognized asset ID
+	// WARNING: no check for type correctness, always ensure T is correct!
+	template<typename T>
+	T &getAsset(const std::string &id) {
+		return *static_cast<T *>(_getAssetRaw(id));
+	}
+
+	// asset ownership is transferred to AssetsManager
+	template<typename T>
+	void cacheAsset(const std::string &id, T *asset) {
+		_cacheAssetRaw(id, static_cast<void *>(asset));
+	}
+
+private:
+	AssetsManager() = default;
+
+	void *_getAssetRaw(const std::string &id);
+	void _cacheAssetRaw(const std::string &id, void *asset);
+
+	std::map<std::string, void *> _asset_cache; // owned pointers
+};
+
+} // namespace wf
+
+#endif // WFORGE_ASSETCACHE_H
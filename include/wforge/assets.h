@@ -2,7 +2,9 @@
 #define WFORGE_ASSETS_H
 
 #include "wforge/2d.h"
+#include "wforge/assetcache.h"
 #include "wforge/fallsand.h"
+#include "wforge/pixelshape.h"
 #include <SFML/Audio/Music.hpp>
 #include <SFML/Graphics.hpp>
 #include <SFML/Graphics/Color.hpp>
@@ -10,22 +12,13 @@
 #include <SFML/Graphics/Rect.hpp>
 #include <SFML/Graphics/Texture.hpp>
 #include <cstdint>
+#include <filesystem>
 #include <generator>
-#include <map>
 #include <string>
 #include <string_view>
 
 namespace wf {
 
-struct PixelTypeAndColor {
-	PixelType type : 8;
-	unsigned int color_index : 8;
-};
-
-// Determine pixel type and color index from a color
-// Returns {PixelType::Decoration, 255} for not recognized colors
-PixelTypeAndColor pixelTypeFromColor(const sf::Color &color) noexcept;
-
 class PixelFont {
 public:
 	PixelFont(
@@ -69,31 +62,8 @@ private:
 	CharInfo _char_info[128]; // ASCII
 };
 
-// Bitmap shape of a pixel-based entity
-class PixelShape {
-public:
-	PixelShape(const sf::Image &img) noexcept;
-	PixelShape() noexcept;
-
-	int width() const noexcept {
-		return _width;
-	}
-
-	int height() const noexcept {
-		return _height;
-	}
-
-	// not fully transparent at (x, y)
-	bool hasPixel(int x, int y) const noexcept;
-	sf::Color colorOf(int x, int y) const noexcept;
-
-	bool isPOIPixel(int x, int y) const noexcept;
-
-protected:
-	int _width;
-	int _height;
-	const std::uint8_t *_data; // no ownership, ~static
-};
+// Shape over the pixels of img, which must outlive the shape
+PixelShape pixelShapeOf(const sf::Image &img) noexcept;
 
 class PixelAnimationFrames {
 public:
@@ -139,39 +109,8 @@ struct MusicCollection {
 	sf::Music *getRandomMusic() const;
 };
 
-// Cache of loaded assets, singleton
-class AssetsManager {
-public:
-	static AssetsManager &instance() noexcept;
-
-	// Load all assets from the `assets/` directory, respecting manifest.json
-	// See assets/README.md and assets/manifest.json for details
-	static void loadAllAssets();
-
-	// throws for unrecognized asset ID
-	// WARNING: no check for type correctness, always ensure T is correct!
-	template<typename T>
-	T &getAsset(const std::string &id) {
-		return *static_cast<T *>(_getAssetRaw(id));
-	}
-
-	// asset ownership is transferred to AssetsManager
-	template<typename T>
-	void cacheAsset(const std::string &id, T *asset) {
-		_cacheAssetRaw(id, static_cast<void *>(asset));
-	}
-
-	MusicCollection &getMusicCollection(const std::string &id);
-
-private:
-	AssetsManager() = default;
-
-	void *_getAssetRaw(const std::string &id);
-	void _cacheAssetRaw(const std::string &id, void *asset);
-
-	std::map<std::string, void *> _asset_cache; // owned pointers
-	std::map<std::string, MusicCollection> _music_collections;
-};
+// Music collection of the given ID, created empty on first access
+MusicCollection &musicCollectionOf(const std::string &id);
 
 // Checkpoint area sprite, which animates based on progress
 struct CheckpointSprite {
@@ -1,154 +1,162 @@
 #ifndef WFORGE_COLORPALETTE_H
 #define WFORGE_COLORPALETTE_H
 
-#include <SFML/Graphics/Color.hpp>
 #include <array>
 #include <cstdint>
 
 namespace wf {
 
+// Plain RGBA color, same packing as sf::Color, so that the simulation does not
+// depend on SFML
+struct RGBAColor {
+	std::uint8_t r = 0;
+	std::uint8_t g = 0;
+	std::uint8_t b = 0;
+	std::uint8_t a = 255;
+
+	constexpr std::uint32_t toInteger() const noexcept {
+		return (static_cast<std::uint32_t>(r) << 24)
+			| (static_cast<std::uint32_t>(g) << 16)
+			| (static_cast<std::uint32_t>(b) << 8)
+			| static_cast<std::uint32_t>(a);
+	}
+
+	constexpr bool operator==(const RGBAColor &) const noexcept = default;
+};
+
 struct ColorPaletteEntry {
 	const char *name;
-	sf::Color color;        // in RGBA
-	sf::Color active_color; // electricity blend
+	RGBAColor color;        // in RGBA
+	RGBAColor active_color; // electricity blend
 };
 
-constexpr sf::Color ui_text_color(std::uint8_t a) {
-	return sf::Color(0, 0, 0, a);
-}
-
-constexpr sf::Color ui_active_color{250, 200, 46, 255};
-constexpr sf::Color ui_text_bright_color(std::uint8_t a) {
-	return sf::Color(255, 255, 255, a);
-}
-
 // All indexed colors must be here, for dynamic generated textures
 // Colors in static assets (e.g. PNG files) can be outside this palette
 constexpr ColorPaletteEntry _colors[] = {
 	{
 		.name = "Air",
-		.color = sf::Color(0, 0, 0, 0),
+		.color = RGBAColor{0, 0, 0, 0},
 	},
 	{
 		.name = "Stone1",
-		.color = sf::Color(96, 96, 96, 255),
+		.color = RGBAColor{96, 96, 96, 255},
 	},
 	{
 		.name = "Stone2",
-		.color = sf::Color(128, 128, 128, 255),
+		.color = RGBAColor{128, 128, 128, 255},
 	},
 	{
 		.name = "Stone3",
-		.color = sf::Color(144, 144, 144, 255),
+		.color = RGBAColor{144, 144, 144, 255},
 	},
 	{
 		.name = "Stone4",
-		.color = sf::Color(182, 182, 182, 255),
+		.color = RGBAColor{182, 182, 182, 255},
 	},
 	{
 		.name = "Wood1",
-		.color = sf::Color(228, 202, 167, 255),
+		.color = RGBAColor{228, 202, 167, 255},
 	},
 	{
 		.name = "Wood2",
-		.color = sf::Color(209, 177, 135, 255),
+		.color = RGBAColor{209, 177, 135, 255},
 	},
 	{
 		.name = "Wood3",
-		.color = sf::Color(186, 145, 88, 255),
+		.color = RGBAColor{186, 145, 88, 255},
 	},
 	{
 		.name = "Copper1",
-		.color = sf::Color(194, 107, 76, 255),
-		.active_color = sf::Color(2, 177, 240, 255),
+		.color = RGBAColor{194, 107, 76, 255},
+		.active_color = RGBAColor{2, 177, 240, 255},
 	},
 	{
 		.name = "Copper2",
-		.color = sf::Color(201, 129, 104, 255),
-		.active_color = sf::Color(93, 196, 233, 255),
+		.color = RGBAColor{201, 129, 104, 255},
+		.active_color = RGBAColor{93, 196, 233, 255},
 	},
 	{
 		.name = "Copper3", // holder
-		.color = sf::Color(87, 55, 8, 255),
-		.active_color = sf::Color(87, 55, 8, 255),
+		.color = RGBAColor{87, 55, 8, 255},
+		.active_color = RGBAColor{87, 55, 8, 255},
 	},
 	{
 		.name = "Copper4", // holder
-		.color = sf::Color(97, 63, 13, 255),
-		.active_color = sf::Color(97, 63, 13, 255),
+		.color = RGBAColor{97, 63, 13, 255},
+		.active_color = RGBAColor{97, 63, 13, 255},
 	},
 	{
 		.name = "Copper5", // legacy copper color
-		.color = sf::Color(184, 115, 51, 255),
-		.active_color = sf::Color(2, 177, 240, 255),
+		.color = RGBAColor{184, 115, 51, 255},
+		.active_color = RGBAColor{2, 177, 240, 255},
 	},
 	{
 		.name = "Sand1",
-		.color = sf::Color(218, 207, 163, 255),
+		.color = RGBAColor{218, 207, 163, 255},
 	},
 	{
 		.name = "Sand2", // darker
-		.color = sf::Color(198, 174, 113, 255),
+		.color = RGBAColor{198, 174, 113, 255},
 	},
 	{
 		.name = "Water",
-		.color = sf::Color(64, 164, 223, 200),
+		.color = RGBAColor{64, 164, 223, 200},
 	},
 	{
 		.name = "Oil",
-		.color = sf::Color(85, 107, 47, 200),
+		.color = RGBAColor{85, 107, 47, 200},
 	},
 	{
 		.name = "Smoke1", // light gray
-		.color = sf::Color(200, 200, 200, 180),
+		.color = RGBAColor{200, 200, 200, 180},
 	},
 	{
 		.name = "Smoke2", // dark gray
-		.color = sf::Color(100, 100, 100, 180),
+		.color = RGBAColor{100, 100, 100, 180},
 	},
 	{
 		.name = "Steam1", // very light blue
-		.color = sf::Color(220, 240, 255, 150),
+		.color = RGBAColor{220, 240, 255, 150},
 	},
 	{
 		.name = "Steam2", // light blue
-		.color = sf::Color(180, 220, 255, 150),
+		.color = RGBAColor{180, 220, 255, 150},
 	},
 	{
 		.name = "Fire1", // orange
-		.color = sf::Color(255, 69, 0, 255),
+		.color = RGBAColor{255, 69, 0, 255},
 	},
 	{
 		.name = "Fire2", // yellow
-		.color = sf::Color(255, 215, 0, 255),
+		.color = RGBAColor{255, 215, 0, 255},
 	},
 	{
 		.name = "Fire3", // red orange
-		.color = sf::Color(255, 140, 0, 255),
+		.color = RGBAColor{255, 140, 0, 255},
 	},
 	{
 		.name = "Electric",
-		.color = sf::Color(0, 242, 255, 255),
+		.color = RGBAColor{0, 242, 255, 255},
 	},
 	{
 		.name = "Laser",
-		.color = sf::Color(51, 255, 184, 200),
+		.color = RGBAColor{51, 255, 184, 200},
 	},
 	{
 		.name = "LaserStroke",
-		.color = sf::Color(146, 226, 80, 255),
+		.color = RGBAColor{146, 226, 80, 255},
 	},
 	{
 		.name = "POIMarker",
-		.color = sf::Color(255, 0, 0, 40),
+		.color = RGBAColor{255, 0, 0, 40},
 	},
 	{
 		.name = "Ruin",
-		.color = sf::Color(128, 128, 128, 255),
+		.color = RGBAColor{128, 128, 128, 255},
 	},
 	{
 		.name = "DebugRed",
-		.color = sf::Color(255, 0, 0, 255),
+		.color = RGBAColor{255, 0, 0, 255},
 	}
 };
 
@@ -174,7 +182,7 @@ inline consteval unsigned int colorIndexOf(const char *name) {
 	return -1;
 }
 
-inline constexpr sf::Color colorOfIndex(unsigned int index) {
+inline constexpr RGBAColor colorOfIndex(unsigned int index) {
 	return _colors[index].color;
 }
 
@@ -182,7 +190,7 @@ inline constexpr ColorPaletteEntry colorPaletteOfIndex(unsigned int index) {
 	return _colors[index];
 }
 
-inline consteval sf::Color colorOfName(const char *name) {
+inline consteval RGBAColor colorOfName(const char *name) {
 	return colorOfIndex(colorIndexOf(name));
 }
 
@@ -196,8 +204,8 @@ inline consteval unsigned int packColorByName(const char *name) {
 	return colorOfName(name).toInteger();
 }
 
-inline constexpr sf::Color blendColor(
-	const sf::Color overlay, const sf::Color base
+inline constexpr RGBAColor blendColor(
+	const RGBAColor overlay, const RGBAColor base
 ) {
 	const uint32_t alpha_numerator = static_cast<uint32_t>(overlay.a) * 255
 		+ static_cast<uint32_t>(base.a) * (255 - overlay.a);
@@ -226,14 +234,14 @@ inline constexpr sf::Color blendColor(
 }
 
 constexpr auto _laser_blended_colors = ([]() constexpr {
-	std::array<sf::Color, _color_palette_size> arr{};
+	std::array<RGBAColor, _color_palette_size> arr{};
 	for (unsigned int i = 0; i < _color_palette_size; ++i) {
 		arr[i] = blendColor(colorOfName("Laser"), _colors[i].color);
 	}
 	return arr;
 })();
 
-constexpr sf::Color laserBlendedColorOfIndex(unsigned int index) {
+constexpr RGBAColor laserBlendedColorOfIndex(unsigned int index) {
 	return _laser_blended_colors[index];
 }
 
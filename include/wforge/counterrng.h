@@ -0,0 +1,84 @@
+#ifndef WFORGE_COUNTERRNG_H
+#define WFORGE_COUNTERRNG_H
+
+#include <cstdint>
+#include <limits>
+
+namespace wf {
+
+/**
+ * @brief Stateless counter-based random number generator.
+ * @note The number at a counter only depends on the key and the counter, not
+ * on the numbers drawn before. Parallel kernels draw the number of a pixel by
+ * its index, so their results do not depend on how the pixels are divided
+ * among threads. Each value is the SplitMix64 output at that position.
+ * @link https://prng.di.unimi.it/splitmix64.c @endlink
+ */
+class CounterRng {
+public:
+	using result_type = std::uint64_t;
+
+	constexpr explicit CounterRng(std::uint64_t key) noexcept: _key(key) {}
+
+	static constexpr result_type min() noexcept {
+		return std::numeric_limits<result_type>::min();
+	}
+	static constexpr result_type max() noexcept {
+		return std::numeric_limits<result_type>::max();
+	}
+
+	/**
+	 * @brief The random number at `counter`.
+	 * @note Uniformly distributed, thread-safe.
+	 */
+	constexpr std::uint64_t at(std::uint64_t counter) const noexcept {
+		return mix(_key + (counter + 1) * golden_gamma);
+	}
+
+	/**
+	 * @brief An independent generator for the stream `id`, e.g. one phase of
+	 * a pass.
+	 */
+	constexpr CounterRng substream(std::uint64_t id) const noexcept {
+		return CounterRng(mix(_key ^ mix(id + golden_gamma)));
+	}
+
+	/**
+	 * @brief 32 random bits at `counter`, for kernels without 64-bit
+	 * multiplies, e.g. SIMD ones. Not related to at(counter).
+	 * @note mix32(key32() + (counter + 1) * golden_gamma32), kernels drawing
+	 * several counters at once spell it out.
+	 */
+	constexpr std::uint32_t at32(std::uint32_t counter) const noexcept {
+		return mix32(key32() + (counter + 1) * golden_gamma32);
+	}
+
+	static constexpr std::uint32_t golden_gamma32 = 0x9e3779b9;
+
+	constexpr std::uint32_t key32() const noexcept {
+		return static_cast<std::uint32_t>(_key ^ (_key >> 32));
+	}
+
+	// lowbias32 by Chris Wellons
+	// @link https://nullprogram.com/blog/2018/07/31/ @endlink
+	static constexpr std::uint32_t mix32(std::uint32_t z) noexcept {
+		z = (z ^ (z >> 16)) * 0x7feb352d;
+		z = (z ^ (z >> 15)) * 0x846ca68b;
+		return z ^ (z >> 16);
+	}
+
+private:
+	static constexpr std::uint64_t golden_gamma = 0x9e3779b97f4a7c15;
+
+	static constexpr std::uint64_t mix(std::uint64_t z) noexcept {
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+		return z ^ (z >> 31);
+	}
+
+	std::uint64_t _key;
+};
+
+} // namespace wf
+
+#endif // WFORGE_COUNTERRNG_H
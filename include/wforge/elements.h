@@ -2,17 +2,59 @@
 #define WFORGE_ELEMENTS_H
 
 #include "wforge/fallsand.h"
+#include <type_traits>
 
 namespace wf {
 
+// Shared instance of the element of a type, see sharedElement()
 PixelElement constructElementByType(PixelType type) noexcept;
 
+// Behavior of the elements of a PixelType. Elements keep their per pixel
+// state in PixelWorld::stateOf(), so no object is stored with the pixels,
+// see element.cpp
+struct ElementDispatch {
+	void (*step)(PixelWorld &world, int x, int y) noexcept;
+	void (*on_charge)(PixelWorld &world, int x, int y) noexcept;
+
+	// Null if the element never sleeps, see EmptySubsElement::isAsleep()
+	bool (*is_asleep)(
+		const PixelWorld &world, int x, int y, PixelTag tag
+	) noexcept;
+
+	// step does nothing, element passes skip the pixel without touching it
+	bool is_static;
+};
+
+const ElementDispatch &elementDispatchOf(PixelType type) noexcept;
+
 namespace element {
 
+// Elements have no members, so every pixel of a type can use the same
+// instance. Handing it out is a pointer store instead of a construction.
+template<typename E>
+PixelElement sharedElement() noexcept {
+	static_assert(std::is_empty_v<E>);
+	static E instance;
+	return PixelElement(&instance);
+}
+
 // Common superclass for all elements, no special behavior
 struct EmptySubsElement {
+	ElementState newState() const noexcept {
+		return {};
+	}
+
 	void step(PixelWorld &world, int x, int y) noexcept {}
 	void onCharge(PixelWorld &world, int x, int y) noexcept {}
+
+	// step would leave the pixel as it is until one of its neighbors
+	// changes. Element passes skip it and let its chunk rest, changes next
+	// to it wake it through PixelWorld::markActive().
+	bool isAsleep(
+		const PixelWorld &world, int x, int y, PixelTag tag
+	) const noexcept {
+		return false;
+	}
 };
 
 // Common superclass for solid elements
@@ -23,6 +65,11 @@ struct SolidElement : EmptySubsElement {
 // Common superclass for fluid elements
 struct FluidElement : EmptySubsElement {
 	void step(PixelWorld &world, int x, int y) noexcept;
+
+	// Enclosed by fluid it does not sink into and nothing to flow to
+	bool isAsleep(
+		const PixelWorld &world, int x, int y, PixelTag tag
+	) const noexcept;
 };
 
 // Common superclass for gas elements (except air)
@@ -33,11 +80,15 @@ struct GasElement : EmptySubsElement {
 struct Steam : GasElement {
 	PixelTag newTag() const noexcept;
 	void step(PixelWorld &world, int x, int y) noexcept;
+
+	static PixelElement create() noexcept;
 };
 
 struct Smoke : GasElement {
 	PixelTag newTag() const noexcept;
 	void step(PixelWorld &world, int x, int y) noexcept;
+
+	static PixelElement create() noexcept;
 };
 
 struct Air : EmptySubsElement {
@@ -46,6 +97,14 @@ struct Air : EmptySubsElement {
 	static PixelElement create() noexcept;
 };
 
+// Frame around the world, see PixelWorld::ghost_border. Elements moving
+// into it fall off the world.
+struct Void : SolidElement {
+	PixelTag newTag() const noexcept;
+
+	static PixelElement create() noexcept;
+};
+
 struct Decoration : SolidElement {
 	PixelTag newTag() const noexcept;
 
@@ -59,15 +118,11 @@ struct Stone : SolidElement {
 };
 
 struct Wood : SolidElement {
-	Wood() noexcept;
-
 	PixelTag newTag() const noexcept;
+	ElementState newState() const noexcept; // burn_time_left
 	void step(PixelWorld &world, int x, int y) noexcept;
 
 	static PixelElement create() noexcept;
-
-private:
-	int burn_time_left;
 };
 
 struct Copper : SolidElement {
@@ -78,14 +133,17 @@ struct Copper : SolidElement {
 	static PixelElement create() noexcept;
 };
 
+// Uses vx and vy of its ElementState
 struct Sand : SolidElement {
 	PixelTag newTag() const noexcept;
 	void step(PixelWorld &world, int x, int y) noexcept;
 
-	static PixelElement create() noexcept;
+	// Came to rest on solid ground, see is_free_falling
+	bool isAsleep(
+		const PixelWorld &world, int x, int y, PixelTag tag
+	) const noexcept;
 
-protected:
-	float vx = 0, vy = 0;
+	static PixelElement create() noexcept;
 };
 
 struct Water : FluidElement {
@@ -96,27 +154,25 @@ struct Water : FluidElement {
 };
 
 struct Oil : FluidElement {
-	Oil() noexcept;
-
 	PixelTag newTag() const noexcept;
+	ElementState newState() const noexcept; // burn_time_left
 	void step(PixelWorld &world, int x, int y) noexcept;
 
 	static PixelElement create() noexcept;
-
-private:
-	int burn_time_left;
 };
 
+// A falling drop of the fluid in carried_type of its ElementState. The
+// state of the fluid, e.g. the burn time of oil, is kept while falling.
 struct FluidParticle : EmptySubsElement {
 	PixelTag newTag() const noexcept;
 	void step(PixelWorld &world, int x, int y) noexcept;
 
-	FluidParticle() noexcept = default;
-	FluidParticle(float init_vx, float init_vy, PixelElement element) noexcept;
+	static PixelElement create() noexcept;
 
-protected:
-	PixelElement element;
-	float vx = 0, vy = 0;
+	// Turn the fluid at (x, y) into a particle
+	static void detach(
+		PixelWorld &world, int x, int y, float init_vx, float init_vy
+	) noexcept;
 };
 
 } // namespace element
@@ -1,12 +1,18 @@
 #ifndef WFORGE_FALLSAND_H
 #define WFORGE_FALLSAND_H
 
+#include "wforge/counterrng.h"
+#include "wforge/xoroshiro.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <proxy/proxy.h>
 #include <proxy/v4/proxy.h>
 #include <proxy/v4/proxy_macros.h>
 #include <span>
+#include <type_traits>
 #include <vector>
 
 namespace wf {
@@ -15,31 +21,42 @@ namespace _dispatch {
 
 // See microsoft/proxy library for the semantics of dispatch conventions
 PRO_DEF_MEM_DISPATCH(MemNewTag, newTag);
+PRO_DEF_MEM_DISPATCH(MemNewState, newState);
 PRO_DEF_MEM_DISPATCH(MemStep, step);
 PRO_DEF_MEM_DISPATCH(MemOnCharge, onCharge);
 
 PRO_DEF_MEM_DISPATCH(MemSetup, setup);
 PRO_DEF_MEM_DISPATCH(MemCustomRender, customRender);
 PRO_DEF_MEM_DISPATCH(MemPriority, priority);
+PRO_DEF_MEM_DISPATCH(MemSaveState, saveState);
+PRO_DEF_MEM_DISPATCH(MemLoadState, loadState);
 
 } // namespace _dispatch
 
 struct PixelTag;
+struct ElementState;
 class PixelWorld;
+class TilePageFile;
+class StateWriter;
+class StateReader;
 
 /* clang-format off */
 // See microsoft/proxy library for the semantics of proxy and facade
 struct PixelFacade : pro::facade_builder
 	::add_convention<_dispatch::MemNewTag, PixelTag() const noexcept>
+	::add_convention<_dispatch::MemNewState, ElementState() const noexcept>
 	::add_convention<_dispatch::MemStep, void(PixelWorld &world, int x, int y) noexcept>
 	::add_convention<_dispatch::MemOnCharge, void(PixelWorld &world, int x, int y) noexcept>
 	::build {};
 
 struct StructureEntityFacade : pro::facade_builder
+	::support_copy<pro::constraint_level::nontrivial> // see PixelWorld::fork()
 	::add_convention<_dispatch::MemSetup, void(PixelWorld &world)>
 	::add_convention<_dispatch::MemCustomRender, void(std::span<std::uint8_t> buf, const PixelWorld &world) const noexcept>
 	::add_convention<_dispatch::MemStep, bool(PixelWorld &world) noexcept>
 	::add_convention<_dispatch::MemPriority, int() const noexcept> // lower value means higher priority
+	::add_convention<_dispatch::MemSaveState, void(StateWriter &out) const> // what changes after setup()
+	::add_convention<_dispatch::MemLoadState, void(StateReader &in)>
 	::build {};
 /* clang-format on */
 
@@ -67,6 +84,9 @@ enum class PixelType : std::uint8_t {
 	Copper,
 	Sand,
 
+	// Frame around the world, see PixelWorld::ghost_border
+	Void,
+
 	// for internal use only, keep at the end
 	_count
 };
@@ -100,6 +120,191 @@ struct PixelTag {
 	unsigned int electric_power : 4 = 0;
 };
 
+// Pixel of a map or a structure shape, see pixelTypeFromColor(). A color
+// index of 255 stands for the color of the element.
+struct PixelTypeAndColor {
+	PixelType type : 8;
+	unsigned int color_index : 8;
+};
+
+// Refers to a field of a pixel tag stored in a byte plane of PixelTile,
+// reads and writes behave like the bit-field of the same name in PixelTag
+template <typename T, int shift, int bits>
+class PixelFieldRef {
+public:
+	// Bits of the plane byte holding the field
+	static constexpr std::uint8_t byte_mask = ((1u << bits) - 1) << shift;
+
+	explicit PixelFieldRef(std::uint8_t *byte) noexcept: _byte(byte) {}
+	PixelFieldRef(const PixelFieldRef &) noexcept = default;
+
+	operator T() const noexcept {
+		unsigned int value = (*_byte & byte_mask) >> shift;
+		if constexpr (std::is_same_v<T, signed int>) {
+			// Sign extension
+			constexpr unsigned int sign_bit = 1u << (bits - 1);
+			return static_cast<int>(value ^ sign_bit)
+				- static_cast<int>(sign_bit);
+		} else {
+			return static_cast<T>(value);
+		}
+	}
+
+	PixelFieldRef &operator=(T value) noexcept {
+		*_byte = (*_byte & ~byte_mask)
+			| ((static_cast<unsigned int>(value) << shift) & byte_mask);
+		return *this;
+	}
+
+	// Assigns the referred value like a reference would
+	PixelFieldRef &operator=(const PixelFieldRef &other) noexcept {
+		return *this = static_cast<T>(other);
+	}
+
+	PixelFieldRef &operator+=(T value) noexcept
+		requires std::is_arithmetic_v<T>
+	{
+		return *this = static_cast<T>(*this) + value;
+	}
+
+	PixelFieldRef &operator-=(T value) noexcept
+		requires std::is_arithmetic_v<T>
+	{
+		return *this = static_cast<T>(*this) - value;
+	}
+
+private:
+	std::uint8_t *_byte;
+};
+
+namespace _plane {
+
+// Layout of the fields within the planes of PixelTile
+using Type = PixelFieldRef<PixelType, 0, 6>;
+using Class = PixelFieldRef<PixelClass, 6, 2>;
+using ColorIndex = PixelFieldRef<unsigned int, 0, 8>;
+using Dirty = PixelFieldRef<bool, 0, 1>; // own plane, see PixelTile::dirty
+using FreeFalling = PixelFieldRef<bool, 0, 1>;
+using FluidDir = PixelFieldRef<signed int, 1, 2>;
+using Ignited = PixelFieldRef<bool, 3, 1>;
+using Heat = PixelFieldRef<unsigned int, 0, 7>;
+using ThermalConductivity = PixelFieldRef<unsigned int, 0, 6>;
+using ElectricPower = PixelFieldRef<unsigned int, 0, 4>;
+
+} // namespace _plane
+
+// What PixelWorld::tagOf() returns for writing. Copies refer to the same
+// pixel. Use PixelTag to take a snapshot of a tag instead.
+struct PixelTagRef {
+	_plane::Type type;
+	_plane::Class pclass;
+	_plane::ColorIndex color_index;
+	_plane::Dirty dirty;
+	_plane::FreeFalling is_free_falling;
+	_plane::FluidDir fluid_dir;
+	_plane::Heat heat;
+	_plane::Ignited ignited;
+	_plane::ThermalConductivity thermal_conductivity;
+	_plane::ElectricPower electric_power;
+
+	PixelTagRef(
+		std::uint8_t *kind, std::uint8_t *color, std::uint8_t *dirty,
+		std::uint8_t *flags, std::uint8_t *heat, std::uint8_t *conductivity,
+		std::uint8_t *power
+	) noexcept
+		: type(kind)
+		, pclass(kind)
+		, color_index(color)
+		, dirty(dirty)
+		, is_free_falling(flags)
+		, fluid_dir(flags)
+		, heat(heat)
+		, ignited(flags)
+		, thermal_conductivity(conductivity)
+		, electric_power(power) {}
+
+	PixelTagRef(const PixelTagRef &) noexcept = default;
+
+	operator PixelTag() const noexcept {
+		return PixelTag{
+			.type = type,
+			.pclass = pclass,
+			.color_index = color_index,
+			.dirty = dirty,
+			.is_free_falling = is_free_falling,
+			.fluid_dir = fluid_dir,
+			.heat = heat,
+			.ignited = ignited,
+			.thermal_conductivity = thermal_conductivity,
+			.electric_power = electric_power,
+		};
+	}
+
+	PixelTagRef &operator=(const PixelTag &tag) noexcept {
+		type = tag.type;
+		pclass = tag.pclass;
+		color_index = tag.color_index;
+		dirty = tag.dirty;
+		is_free_falling = tag.is_free_falling;
+		fluid_dir = tag.fluid_dir;
+		heat = tag.heat;
+		ignited = tag.ignited;
+		thermal_conductivity = tag.thermal_conductivity;
+		electric_power = tag.electric_power;
+		return *this;
+	}
+
+	// Assigns the referred tag like a reference would
+	PixelTagRef &operator=(const PixelTagRef &other) noexcept {
+		return *this = static_cast<PixelTag>(other);
+	}
+};
+
+inline void swap(PixelTagRef a, PixelTagRef b) noexcept {
+	PixelTag t = a;
+	a = b;
+	b = t;
+}
+
+// Inclusive pixel bounds of the changed area within a chunk
+struct DirtyRect {
+	int x_min = 0;
+	int y_min = 0;
+	int x_max = -1;
+	int y_max = -1;
+
+	bool empty() const noexcept {
+		return x_min > x_max;
+	}
+
+	void expand(int x0, int y0, int x1, int y1) noexcept {
+		if (empty()) {
+			x_min = x0;
+			y_min = y0;
+			x_max = x1;
+			y_max = y1;
+			return;
+		}
+
+		x_min = std::min(x_min, x0);
+		y_min = std::min(y_min, y0);
+		x_max = std::max(x_max, x1);
+		y_max = std::max(y_max, y1);
+	}
+};
+
+// Per pixel state of the elements that need any, moves with its pixel
+struct ElementState {
+	float vx = 0;
+	float vy = 0;
+	std::int16_t burn_time_left = 0;
+
+	// Fluid carried by a FluidParticle
+	PixelType carried_type = PixelType::Air;
+
+	bool operator==(const ElementState &) const noexcept = default;
+};
+
 struct StaticPixelTag {
 	bool laser_active : 1 = false;
 	bool laser_stroke : 1 = false;
@@ -107,12 +312,197 @@ struct StaticPixelTag {
 	bool is_reflective_surface : 1 = false;
 };
 
+// Refers to a bit of a BitPlane, reads and writes behave like a bool
+class PixelBitRef {
+public:
+	PixelBitRef(std::uint64_t *word, int bit) noexcept
+		: _word(word), _mask(std::uint64_t{1} << bit) {}
+	PixelBitRef(const PixelBitRef &) noexcept = default;
+
+	operator bool() const noexcept {
+		return (*_word & _mask) != 0;
+	}
+
+	PixelBitRef &operator=(bool value) noexcept {
+		*_word = value ? (*_word | _mask) : (*_word & ~_mask);
+		return *this;
+	}
+
+	// Assigns the referred value like a reference would
+	PixelBitRef &operator=(const PixelBitRef &other) noexcept {
+		return *this = static_cast<bool>(other);
+	}
+
+private:
+	std::uint64_t *_word;
+	std::uint64_t _mask;
+};
+
+// One bit per pixel of a PixelTile, packed into words so that clearing the
+// whole plane is a single memset. Not safe to write from several threads,
+// neighboring pixels share a word.
+template<int size>
+class BitPlane {
+public:
+	bool test(int i) const noexcept {
+		return (_words[i / 64] >> (i % 64)) & 1;
+	}
+
+	PixelBitRef operator[](int i) noexcept {
+		return PixelBitRef(&_words[i / 64], i % 64);
+	}
+
+	bool any() const noexcept {
+		return std::ranges::any_of(_words, [](std::uint64_t w) {
+			return w != 0;
+		});
+	}
+
+	void clear() noexcept {
+		_words.fill(0);
+	}
+
+	// Bit i is bit i % 64 of word i / 64, see PixelWorld::saveState()
+	std::span<std::uint64_t> words() noexcept {
+		return _words;
+	}
+
+	std::span<const std::uint64_t> words() const noexcept {
+		return _words;
+	}
+
+private:
+	std::array<std::uint64_t, (size + 63) / 64> _words{};
+};
+
+// What PixelWorld::staticTagOf() returns for writing, like PixelTagRef
+struct StaticPixelTagRef {
+	PixelBitRef laser_active;
+	PixelBitRef laser_stroke;
+	PixelBitRef external_entity_present;
+	PixelBitRef is_reflective_surface;
+
+	operator StaticPixelTag() const noexcept {
+		return StaticPixelTag{
+			.laser_active = laser_active,
+			.laser_stroke = laser_stroke,
+			.external_entity_present = external_entity_present,
+			.is_reflective_surface = is_reflective_surface,
+		};
+	}
+};
+
+// Square block of pixels, the unit PixelWorld stores its pixels in. Tiles
+// nobody writes to can be shared, see PixelWorld::compactTiles().
+struct PixelTile {
+	static constexpr int size_log2 = 5;
+	static constexpr int size = 1 << size_log2;
+	static constexpr int area = size * size;
+
+	static constexpr int indexOf(int local_x, int local_y) noexcept {
+		return local_y * size + local_x;
+	}
+
+	// The fields of PixelTag, see _plane for the layout
+	std::array<std::uint8_t, area> kinds; // type and pclass
+	std::array<std::uint8_t, area> colors;
+	std::array<std::uint8_t, area> dirty; // a byte each, see resetDirtyFlags
+	std::array<std::uint8_t, area> flags;
+	std::array<std::uint8_t, area> heat;
+	std::array<std::uint8_t, area> conductivity;
+	std::array<std::uint8_t, area> electric_power;
+	std::array<ElementState, area> states;
+
+	// The fields of StaticPixelTag
+	BitPlane<area> laser_active;
+	BitPlane<area> laser_stroke;
+	BitPlane<area> external_entity_present;
+	BitPlane<area> is_reflective_surface;
+
+	PixelTag tagAt(int i) const noexcept {
+		return const_cast<PixelTile *>(this)->tagAt(i);
+	}
+
+	PixelTagRef tagAt(int i) noexcept {
+		return PixelTagRef(
+			&kinds[i], &colors[i], &dirty[i], &flags[i], &heat[i],
+			&conductivity[i], &electric_power[i]
+		);
+	}
+
+	StaticPixelTag staticTagAt(int i) const noexcept {
+		return StaticPixelTag{
+			.laser_active = laser_active.test(i),
+			.laser_stroke = laser_stroke.test(i),
+			.external_entity_present = external_entity_present.test(i),
+			.is_reflective_surface = is_reflective_surface.test(i),
+		};
+	}
+
+	StaticPixelTagRef staticTagAt(int i) noexcept {
+		return StaticPixelTagRef{
+			.laser_active = laser_active[i],
+			.laser_stroke = laser_stroke[i],
+			.external_entity_present = external_entity_present[i],
+			.is_reflective_surface = is_reflective_surface[i],
+		};
+	}
+
+	bool hasClass(PixelClass pclass) const noexcept;
+	bool hasHeat() const noexcept;
+
+	// Every pixel becomes tag with a default state and no static flags
+	void fill(PixelTag tag) noexcept;
+};
+
+// How PixelWorld::thermalAnalysisStep() spreads heat. The fixed point
+// kernels all give the same results, on any CPU. Float is the kernel they
+// were derived from, kept to compare against, see bench/thermal.cpp.
+enum class HeatKernel : std::uint8_t {
+	Float,  // float weights, 64-bit draws per transfer
+	Scalar, // fixed point, one pixel at a time
+	SSE41,  // fixed point, four pixels at a time
+	AVX2,   // fixed point, eight pixels at a time
+};
+
 class PixelWorld {
 public:
 	constexpr static float gAcceleration = 0.5f;
 
+	// Side length of the chunks used for active region tracking. A chunk is
+	// the pixels of one tile.
+	constexpr static int chunk_size = PixelTile::size;
+
+	// Steps between two compactions of the tiles at rest, see compactTiles()
+	constexpr static int compaction_interval = 64;
+
+	// Most steps between two runs of a global pass, see setFluidInterval()
+	constexpr static int max_pass_interval = 4;
+
+	// Pixels never move further than this within one step. Together with
+	// the reach of a step around the moved pixel it must stay below half a
+	// chunk, so that chunks updated at the same time never touch the same
+	// pixel, see parallel.cpp
+	constexpr static int max_move_distance = 12;
+
+	// Width of the frame of Void pixels around the world. Steps only look
+	// one pixel past a pixel they can move to, so the neighbors of any pixel
+	// in the world can be read without checking the bounds first. The frame
+	// is a ring of shared Void tiles that is never written.
+	constexpr static int ghost_border = 1;
+
 	PixelWorld() noexcept;
 	PixelWorld(int width, int height) noexcept;
+	PixelWorld(PixelWorld &&) noexcept = default;
+	PixelWorld &operator=(PixelWorld &&) noexcept = default;
+
+	// Independent copy of the world, structures and generator included, so
+	// it steps the same way as long as both see the same inputs. Tiles are
+	// shared until either world writes to them. Worlds may step on threads
+	// of their own. The workers of the process go to one stepping world at
+	// a time, the others step on their own thread meanwhile, with the same
+	// results.
+	PixelWorld fork();
 
 	int width() const noexcept {
 		return _width;
@@ -126,12 +516,21 @@ public:
 		return x >= 0 && x < _width && y >= 0 && y < _height;
 	}
 
+	// (x, y) may lie within the ghost border. Access through a non-const
+	// world copies a shared tile first, so read through a const one where
+	// nothing is written.
 	PixelTag tagOf(int x, int y) const noexcept;
-	PixelTag &tagOf(int x, int y) noexcept;
-	PixelElement &elementOf(int x, int y) noexcept;
+	PixelTagRef tagOf(int x, int y) noexcept;
+	ElementState &stateOf(int x, int y) noexcept;
+
+	// tagOf() and stateOf() without bounds checks in debug builds, for
+	// loops that only visit pixels in the world
+	PixelTag uncheckedTagOf(int x, int y) const noexcept;
+	PixelTagRef uncheckedTagOf(int x, int y) noexcept;
+	ElementState &uncheckedStateOf(int x, int y) noexcept;
 
 	StaticPixelTag staticTagOf(int x, int y) const noexcept;
-	StaticPixelTag &staticTagOf(int x, int y) noexcept;
+	StaticPixelTagRef staticTagOf(int x, int y) noexcept;
 
 	void activateLaserAt(int x, int y) noexcept;
 	bool isExternalEntityPresent(int x, int y) const noexcept;
@@ -147,37 +546,412 @@ public:
 	) noexcept;
 	void replacePixelWithAir(int x, int y) noexcept;
 
+	// Only ever gives pixels electric power, see decayElectricPower()
 	void chargeElement(int x, int y) noexcept;
 
+	// Pixel (x, y) changed, update it and its neighbors in the next step
+	// Called by swapPixels, replacePixel etc. Direct writes through tagOf()
+	// must call it themselves
+	void markActive(int x, int y) noexcept;
+
+	// markActive() for every pixel from (x0, y0) to (x1, y1), inclusive
+	void markRectActive(int x0, int y0, int x1, int y1) noexcept;
+	bool isChunkActive(int chunk_x, int chunk_y) const noexcept;
+
 	bool typeOfIs(int x, int y, PixelType ptype) const noexcept;
 	bool classOfIs(int x, int y, PixelClass pclass) const noexcept;
 
 	void step() noexcept;
 
+	// Update the elements of non-adjacent chunks on worker threads
+	void setParallelStep(bool enabled) noexcept;
+	bool isParallelStep() const noexcept;
+
+	// Run the fluid and the thermal analysis only every interval steps,
+	// clamped to [1, max_pass_interval]. The two are staggered, so that
+	// they do not fall on the same step. Heat spreads and decays in
+	// proportion, so it takes about as long to settle either way.
+	void setFluidInterval(int interval) noexcept;
+	void setThermalInterval(int interval) noexcept;
+	int fluidInterval() const noexcept;
+	int thermalInterval() const noexcept;
+
+	// The heat kernel of all worlds, by default the widest fixed point one
+	// the CPU supports. Kernels it does not support fall back to Scalar.
+	static void setHeatKernel(HeatKernel kernel) noexcept;
+	static HeatKernel heatKernel() noexcept;
+	static bool isHeatKernelSupported(HeatKernel kernel) noexcept;
+
+	// Generator behind Xoroshiro128PP::globalInstance() while the world
+	// steps. Worker threads draw their streams from it, so the same
+	// generator and the same inputs always lead to the same world.
+	void setRng(Xoroshiro128PP rng) noexcept;
+
 	void renderToBuffer(std::span<std::uint8_t> buf) const noexcept;
 
+	// Replace the pixels within the rect, clipped to the world, for which
+	// filter(tag, static_tag) holds with new_pixel and return how many were
+	// replaced. keep_heat keeps the heat of the replaced pixels. The area
+	// is marked active once instead of per pixel.
+	template<typename Filter>
+	int fillRect(
+		int x, int y, int width, int height, PixelElement new_pixel,
+		Filter &&filter, bool keep_heat = false
+	) noexcept;
+
+	// fillRect() with a pixel of its own for each pixel (x + mx, y + my) of
+	// the rect, mask(mx, my) returns a const PixelTypeAndColor * to it or
+	// null to leave the pixel alone
+	template<typename Mask, typename Filter>
+	int fillMask(
+		int x, int y, int width, int height, Mask &&mask, Filter &&filter,
+		bool keep_heat = false
+	) noexcept;
+
+	// Call paint(x, y) for the pixels within the rect, clipped to the
+	// world, for which filter(tag, static_tag) holds and return how many
+	// were painted. paint writes to the pixel without marking it, the area
+	// is marked active once afterwards.
+	template<typename Filter, typename Paint>
+	int paintIf(
+		int x, int y, int width, int height, Filter &&filter, Paint &&paint
+	) noexcept;
+
 	void addStructure(StructureEntity structure);
 
 	void resetEntityPresenceTags() noexcept;
 
+	// Tiles covering the world, tile (tx, ty) holds the pixels from
+	// (tx * PixelTile::size, ty * PixelTile::size) on. Pixels of the tiles on
+	// the right and bottom edge that lie outside of the world are Void.
+	int tilesX() const noexcept {
+		return _chunks_x;
+	}
+
+	int tilesY() const noexcept {
+		return _chunks_y;
+	}
+
+	// -1 <= tile_x <= tilesX() and -1 <= tile_y <= tilesY(), the ring around
+	// the world is the ghost border
+	const PixelTile &tileAt(int tile_x, int tile_y) const noexcept {
+		return *_tiles[(tile_y + 1) * (_chunks_x + 2) + tile_x + 1].tile;
+	}
+
+	// Whether the tile is a shared constant tile, all pixels of which are
+	// the same static pixel at rest, see compactTiles()
+	bool isTileUniform(int tile_x, int tile_y) const noexcept {
+		return _tiles[(tile_y + 1) * (_chunks_x + 2) + tile_x + 1].uniform;
+	}
+
+	// Tiles of the world not shared with anything, the memory of a world
+	// grows with this rather than with its area
+	int ownedTileCount() const noexcept;
+
+	// Put shared constant tiles in place of tiles that are all the same
+	// static pixel at rest, e.g. air or stone. Steps do it on their own for
+	// the chunks at rest every compaction_interval steps.
+	void compactTiles() noexcept;
+
+	// Where pageOutTiles() moves tiles to, see pagefile.h. Worlds without one
+	// keep all their tiles in memory.
+	void setPageFile(std::shared_ptr<TilePageFile> page_file) noexcept;
+
+	// Move the tiles at rest farther than keep_distance pixels from (focus_x,
+	// focus_y) to the page file and return how many were moved. Only tiles
+	// no pass looks into go, ones without fluid, fire, heat, power, lasers or
+	// entities. Their colors stay in memory for renderToBuffer(). Writing to
+	// a paged tile copies it back into memory.
+	int pageOutTiles(int focus_x, int focus_y, int keep_distance) noexcept;
+
+	bool isTilePaged(int tile_x, int tile_y) const noexcept {
+		return _tiles[(tile_y + 1) * (_chunks_x + 2) + tile_x + 1].paged;
+	}
+
+	// Steps since the world was created
+	std::uint64_t stepCount() const noexcept {
+		return _steps;
+	}
+
+	// Everything of the world that changes as it steps, see savestate.h.
+	// loadState() restores it into a world of the same size and structures,
+	// e.g. a level freshly loaded from the same map, and throws
+	// std::runtime_error if it does not fit.
+	// Without tiles the state only holds what is not in the tiles, see
+	// saveTileDelta().
+	void saveState(StateWriter &out, bool with_tiles = true) const;
+	void loadState(StateReader &in, bool with_tiles = true);
+
+	// The XOR of the tiles that differ from the ones of from, a fork of the
+	// world taken earlier. Applying it to either of the two turns its tiles
+	// into the other's, see rewind.h.
+	void saveTileDelta(StateWriter &out, const PixelWorld &from) const;
+	void applyTileDelta(StateReader &in);
+
 protected:
 	void resetDirtyFlags() noexcept;
 
+	// Per-tick upkeep before the passes: clear the laser flags and take one
+	// unit of power from every charged pixel
+	void maintenanceStep() noexcept;
+
+	// Charged pixels are listed in _charged_pixels, so only they are visited
+	void decayElectricPower() noexcept;
+
+	// Keep the chunk of (x, y) active without waking its neighbors
+	void keepActive(int x, int y) noexcept;
+
+	// Step the elements inside the active rects, row by row
+	void elementStep() noexcept;
+
+	// elementStep() in four checkerboard phases of chunks on worker threads
+	void parallelElementStep() noexcept;
+
+	// Step the elements inside the active rect of a chunk, bottom to top
+	void stepChunk(int chunk_index) noexcept;
+
+	// Step the element at (x, y) until the pixel there has been stepped
+	void stepPixel(int x, int y) noexcept;
+
+	// replacePixel() without marking the pixel active, see fillMask()
+	void placePixel(
+		int x, int y, PixelTypeAndColor pixel, bool keep_heat
+	) noexcept;
+
+	// Call visit(x, y) for the pixels within the rect, clipped to the
+	// world, and mark the ones it returns true for active at once
+	template<typename Visit>
+	int visitRect(int x, int y, int width, int height, Visit &&visit) noexcept;
+
 	// Global fluid analysis, custom heuristics
 	void fluidAnalysisStep() noexcept;
 
 	// Global thermal analysis
 	void thermalAnalysisStep() noexcept;
 
+	// A counter-based generator keyed from the world's generator, for passes
+	// on worker threads. See counterrng.h
+	CounterRng nextCounterRng() noexcept;
+
+	// Index into _tiles, (x, y) may lie within the ghost border
+	int tileIndexOf(int x, int y) const noexcept {
+		return ((y >> PixelTile::size_log2) + 1) * (_chunks_x + 2)
+			+ (x >> PixelTile::size_log2) + 1;
+	}
+
+	static int localIndexOf(int x, int y) noexcept {
+		return PixelTile::indexOf(
+			x & (PixelTile::size - 1), y & (PixelTile::size - 1)
+		);
+	}
+
+	const PixelTile &tileOf(int x, int y) const noexcept {
+		return *_tiles[tileIndexOf(x, y)].tile;
+	}
+
+	// The tile of (x, y) for writing, copied first if it is shared
+	PixelTile &mutableTileOf(int x, int y) noexcept;
+	PixelTile &mutableTile(int tile_index) noexcept;
+
+	// Give the world its own copy of a shared tile. On a worker thread only
+	// for tiles no other worker reaches, see parallelElementStep().
+	void unshareTile(int tile_index) noexcept;
+
+	// Copies go through fork(), which shares the tiles first
+	PixelWorld(const PixelWorld &) = default;
+
+	// Shared constant tiles in place of the tiles of the world
+	void initTiles() noexcept;
+	void compactTile(int tile_x, int tile_y) noexcept;
+
+	// Put the shared constant tile of tag in place of a tile of the world
+	void setUniformTile(int tile_index, PixelTag tag) noexcept;
+	void compactRestingTiles() noexcept;
+
 private:
+	struct TileSlot {
+		std::shared_ptr<PixelTile> tile;
+		bool shared = false;  // copy the tile before writing to it, unless
+		                      // nothing else holds it any more
+		bool uniform = false; // see isTileUniform()
+		bool paged = false;   // see isTilePaged()
+		bool touched = false; // written to since the last thermal step
+
+		// Copy of the colors of a paged tile, so that renderToBuffer() does
+		// not load it back
+		std::shared_ptr<const decltype(PixelTile::colors)> colors;
+	};
+
+	// No chunk around the tile changed in this step or the last one
+	bool isTileAtRest(int tile_x, int tile_y) const noexcept;
+
 	int _width;
 	int _height;
 
-	std::unique_ptr<PixelTag[]> _tags;
-	std::unique_ptr<PixelElement[]> _elements;
-	std::unique_ptr<StaticPixelTag[]> _static_tags;
+	// Tiles of the world and the ring of Void tiles around it, row by row,
+	// see tileIndexOf()
+	std::vector<TileSlot> _tiles;
+	std::shared_ptr<TilePageFile> _page_file;
+
+	// Indices y * width + x of the pixels given power by chargeElement(). A
+	// pixel charged again after it ran out is listed twice until the next
+	// decay.
+	std::vector<int> _charged_pixels;
 	std::vector<StructureEntity> _structures;
+
+	int _chunks_x;
+	int _chunks_y;
+	std::vector<DirtyRect> _active_rects; // updated in current step
+	std::vector<DirtyRect> _next_active_rects;
+
+	// Where markActive() and chargeElement() record on a worker thread, see
+	// parallel.cpp
+	static thread_local DirtyRect *_thread_next_active_rects;
+	static thread_local std::vector<int> *_thread_charged_pixels;
+
+	// Tiles that held heat at the last thermal step. Heat only shows up
+	// anywhere else by a write, which marks the tile touched.
+	std::vector<int> _hot_tiles;
+
+	bool _parallel_step = false;
+	int _fluid_interval = 1;
+	int _thermal_interval = 1;
+	std::uint64_t _steps = 0;
+
+	Xoroshiro128PP _rng;
+
+	void _checkBounds(const char *func, int x, int y) const noexcept;
 };
+
+// Inline, so that passes reading a single field only load its plane
+inline PixelTag PixelWorld::tagOf(int x, int y) const noexcept {
+#ifndef NDEBUG
+	_checkBounds("tagOf", x, y);
+#endif
+	return uncheckedTagOf(x, y);
+}
+
+inline PixelTagRef PixelWorld::tagOf(int x, int y) noexcept {
+#ifndef NDEBUG
+	_checkBounds("tagOf", x, y);
+#endif
+	return uncheckedTagOf(x, y);
+}
+
+inline PixelTag PixelWorld::uncheckedTagOf(int x, int y) const noexcept {
+	return tileOf(x, y).tagAt(localIndexOf(x, y));
+}
+
+inline PixelTagRef PixelWorld::uncheckedTagOf(int x, int y) noexcept {
+	return mutableTileOf(x, y).tagAt(localIndexOf(x, y));
+}
+
+inline ElementState &PixelWorld::uncheckedStateOf(int x, int y) noexcept {
+	return mutableTileOf(x, y).states[localIndexOf(x, y)];
+}
+
+// Filter of fillRect(), fillMask() and paintIf() that takes every pixel
+struct AnyPixel {
+	bool operator()(PixelTag, StaticPixelTag) const noexcept {
+		return true;
+	}
+};
+
+template<typename Visit>
+int PixelWorld::visitRect(
+	int x, int y, int width, int height, Visit &&visit
+) noexcept {
+	DirtyRect changed;
+	int count = 0;
+	for (int py = std::max(y, 0); py < std::min(y + height, _height); ++py) {
+		for (int px = std::max(x, 0); px < std::min(x + width, _width); ++px) {
+			if (visit(px, py)) {
+				changed.expand(px, py, px, py);
+				++count;
+			}
+		}
+	}
+
+	if (!changed.empty()) {
+		markRectActive(
+			changed.x_min, changed.y_min, changed.x_max, changed.y_max
+		);
+	}
+	return count;
+}
+
+template<typename Filter, typename Paint>
+int PixelWorld::paintIf(
+	int x, int y, int width, int height, Filter &&filter, Paint &&paint
+) noexcept {
+	return visitRect(x, y, width, height, [&](int px, int py) {
+		const PixelWorld &view = *this;
+		if (!filter(view.uncheckedTagOf(px, py), view.staticTagOf(px, py))) {
+			return false;
+		}
+
+		paint(px, py);
+		return true;
+	});
+}
+
+template<typename Filter>
+int PixelWorld::fillRect(
+	int x, int y, int width, int height, PixelElement new_pixel,
+	Filter &&filter, bool keep_heat
+) noexcept {
+	// Tags and states are made per pixel like replacePixel() does, some
+	// elements pick a random color or burn time
+	return paintIf(x, y, width, height, filter, [&](int px, int py) {
+		auto tag = uncheckedTagOf(px, py);
+		const unsigned int heat = tag.heat;
+		tag = new_pixel->newTag();
+		if (keep_heat) {
+			tag.heat = heat;
+		}
+		uncheckedStateOf(px, py) = new_pixel->newState();
+	});
+}
+
+template<typename Mask, typename Filter>
+int PixelWorld::fillMask(
+	int x, int y, int width, int height, Mask &&mask, Filter &&filter,
+	bool keep_heat
+) noexcept {
+	return visitRect(x, y, width, height, [&](int px, int py) {
+		const PixelTypeAndColor *pixel = mask(px - x, py - y);
+		const PixelWorld &view = *this;
+		if (!pixel
+		    || !filter(
+				view.uncheckedTagOf(px, py), view.staticTagOf(px, py)
+			)) {
+			return false;
+		}
+
+		placePixel(px, py, *pixel, keep_heat);
+		return true;
+	});
+}
+
+inline PixelTile &PixelWorld::mutableTileOf(int x, int y) noexcept {
+	return mutableTile(tileIndexOf(x, y));
+}
+
+inline PixelTile &PixelWorld::mutableTile(int tile_index) noexcept {
+	auto &slot = _tiles[tile_index];
+	if (slot.shared) [[unlikely]] {
+		unshareTile(tile_index);
+	}
+
+	// Chunk workers may write to the same tile. Only the first write stores,
+	// so that they do not keep taking the cache line from each other.
+	std::atomic_ref<bool> touched(slot.touched);
+	if (!touched.load(std::memory_order_relaxed)) [[unlikely]] {
+		touched.store(true, std::memory_order_relaxed);
+	}
+	return *slot.tile;
+}
+
 } // namespace wf
 
 #endif // WFORGE_FALLSAND_H
@@ -1,17 +1,26 @@
 #ifndef WFORGE_LEVEL_H
 #define WFORGE_LEVEL_H
 
-#include "wforge/assets.h"
+#include "wforge/2d.h"
 #include "wforge/fallsand.h"
-#include <SFML/Graphics/RenderTarget.hpp>
-#include <SFML/System/Vector2.hpp>
+#include "wforge/pixelshape.h"
+#include "wforge/xoroshiro.h"
+#include <array>
 #include <cstdint>
 #include <memory>
+#include <optional>
 #include <proxy/proxy.h>
 #include <proxy/v4/proxy_macros.h>
+#include <span>
+#include <string>
+#include <string_view>
 #include <tuple>
 #include <vector>
 
+namespace sf {
+class Texture;
+} // namespace sf
+
 namespace wf {
 
 class Level;
@@ -20,8 +29,9 @@ namespace _dispatch {
 
 // See microsoft/proxy library for the semantics of dispatch conventions
 PRO_DEF_MEM_DISPATCH(MemUse, use);
-PRO_DEF_MEM_DISPATCH(MemRender, render);
 PRO_DEF_MEM_DISPATCH(MemChangeBrushSize, changeBrushSize);
+PRO_DEF_MEM_DISPATCH(MemBrushSize, brushSize);
+PRO_DEF_MEM_DISPATCH(MemBrushTopLeft, brushTopLeft);
 PRO_DEF_MEM_DISPATCH(MemName, name);
 
 } // namespace _dispatch
@@ -29,9 +39,11 @@ PRO_DEF_MEM_DISPATCH(MemName, name);
 /* clang-format off */
 // See microsoft/proxy library for the semantics of proxy and facade
 struct ItemFacade : pro::facade_builder
+	::support_copy<pro::constraint_level::nontrivial> // see Level::fork()
 	::add_convention<_dispatch::MemUse, bool(Level &level, int x, int y, int scale) noexcept>
-	::add_convention<_dispatch::MemRender, void(sf::RenderTarget &target, int x, int y, int scale) const>
 	::add_convention<_dispatch::MemChangeBrushSize, void(int delta) noexcept>
+	::add_convention<_dispatch::MemBrushSize, int() const noexcept>
+	::add_convention<_dispatch::MemBrushTopLeft, std::array<int, 2>(int x, int y, int scale) const noexcept>
 	::add_convention<_dispatch::MemName, std::string_view() const noexcept>
 	::build {};
 /* clang-format on */
@@ -45,7 +57,7 @@ struct ItemStack {
 };
 
 struct DuckEntity {
-	DuckEntity(sf::Vector2f pos = {.0f, .0f}) noexcept;
+	DuckEntity(Vec2f pos = {.0f, .0f}) noexcept;
 
 	auto width() const noexcept {
 		return shape.width();
@@ -56,8 +68,8 @@ struct DuckEntity {
 	}
 
 	PixelShape shape;
-	sf::Vector2f position; // anchor at top-left
-	sf::Vector2f velocity;
+	Vec2f position; // anchor at top-left
+	Vec2f velocity;
 
 	void setPosition(float x, float y) noexcept;
 
@@ -99,14 +111,16 @@ struct CheckpointArea {
 	int maxProgress() const noexcept;
 
 	void step(const Level &level) noexcept;
-	void render(sf::RenderTarget &target, int scale) const noexcept;
 
 	bool isCompleted() const noexcept;
 
+	// Only the progress changes, the area stays where the map put it
+	void saveState(StateWriter &out) const;
+	void loadState(StateReader &in);
+
 private:
 	int _width, _height;
 	int _progress;
-	CheckpointSprite &_sprite;
 
 	bool _isDuckInside(const Level &level) const noexcept;
 };
@@ -125,24 +139,71 @@ struct LevelMetadata {
 	std::string description;
 	std::string author;
 	Difficulty difficulty;
-	sf::Texture *minimap_texture;
+	sf::Texture *minimap_texture; // owned by the game client, null headless
 	std::vector<std::tuple<std::string, int>> items;
 
+	// Steps between two runs of the global passes of the world, see
+	// PixelWorld::setFluidInterval()
+	int fluid_interval = 1;
+	int thermal_interval = 1;
+
 	static Difficulty parseDifficulty(std::string_view diff_str) noexcept;
 	static std::string_view difficultyToString(Difficulty difficulty);
 };
 
 struct Level {
+	// Steps between two evictions of the tiles far from the duck, see
+	// PixelWorld::pageOutTiles()
+	static constexpr int page_out_interval = 256;
+
+	// Tiles within this many pixels of the duck stay in memory
+	static constexpr int page_keep_distance = 1024;
+
 	Level(int width, int height) noexcept;
 
+	// Build a level from its map bitmap, see loader.cpp for the markers
+	static Level loadFromBitmap(LevelMetadata metadata, const PixelShape &map);
+
+	// Defined by the game client, which owns the decoded map images
 	static Level loadFromAsset(const std::string &level_id);
 	static Level loadFromMetadata(LevelMetadata metadata);
 
+	// Levels loaded afterwards are seeded from their map id and run_seed,
+	// so that the same inputs replay the same way. Without a run seed every
+	// load is seeded from the device.
+	static void setRunSeed(std::string run_seed);
+	static const std::optional<std::string> &runSeed() noexcept;
+	static Seed seedOf(const std::string &map_id);
+
+	// Independent copy of the level in its current state, cheap since the
+	// world is forked, see PixelWorld::fork()
+	Level fork();
+
+	// Versioned binary snapshot of the level in progress, see savestate.h
+	std::vector<std::uint8_t> saveState() const;
+
+	// Restore a snapshot into the level freshly loaded from the same map.
+	// Throws std::runtime_error if the snapshot is broken or of another map,
+	// the level is left half restored then.
+	void loadState(std::span<const std::uint8_t> state);
+
+	// What saveState() holds after its header, optionally without the tiles
+	// of the world, see rewind.h
+	void writeState(StateWriter &out, bool with_tiles = true) const;
+	void readState(StateReader &in, bool with_tiles = true);
+
+	// Seeds rng and the world's generator, which is jumped from it
+	void seed(Seed seed) noexcept;
+
 	LevelMetadata metadata;
 	PixelWorld fallsand;
 	DuckEntity duck; // Quack!
 	CheckpointArea checkpoint;
 
+	// Draws of the level outside the world step, like item use and building
+	// the map
+	Xoroshiro128PP rng;
+
 	std::vector<ItemStack> items;
 
 	auto width() const noexcept {
@@ -166,6 +227,8 @@ struct Level {
 	void step();
 
 private:
+	Level(const Level &level, PixelWorld fallsand);
+
 	int _prevItemId() const noexcept;
 	int _nextItemId() const noexcept;
 	void _normalizeActiveItemIndex() noexcept;
@@ -174,28 +237,6 @@ private:
 	int _item_use_cooldown; // ticks until next item use allowed
 };
 
-struct LevelRenderer {
-	LevelRenderer(Level &level);
-
-	void render(sf::RenderTarget &target, int mouse_x, int mouse_y, int scale);
-
-private:
-	Level &_level;
-	std::unique_ptr<std::uint8_t[]> _fallsand_buffer;
-	sf::Texture _fallsand_texture;
-	sf::Sprite _fallsand_sprite;
-	std::unique_ptr<std::uint8_t[]> _heat_buffer;
-	sf::Texture _heat_texture;
-	sf::Sprite _heat_sprite;
-	sf::Sprite _duck_sprite;
-	PixelFont &_font;
-
-	void _renderFallsand(sf::RenderTarget &target);
-	void _renderHeat(sf::RenderTarget &target);
-	void _renderDuck(sf::RenderTarget &target, int scale);
-	void _renderItemText(sf::RenderTarget &target, int scale);
-};
-
 struct LevelSequence {
 	std::vector<LevelMetadata *> levels; // non-owning pointers
 };
@@ -207,9 +248,6 @@ struct BrushSizeChangableItem {
 	BrushSizeChangableItem(int max_brush_size, int initial_brush_size) noexcept;
 
 	void changeBrushSize(int delta) noexcept;
-	void render(sf::RenderTarget &target, int x, int y, int scale) const;
-
-protected:
 	int brushSize() const noexcept;
 	std::array<int, 2> brushTopLeft(int x, int y, int scale) const noexcept;
 
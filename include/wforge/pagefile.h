@@ -0,0 +1,63 @@
+#ifndef WFORGE_PAGEFILE_H
+#define WFORGE_PAGEFILE_H
+
+#include "wforge/fallsand.h"
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+namespace wf {
+
+// Tiles are stored and read back as their bytes
+static_assert(std::is_trivially_copyable_v<PixelTile>);
+
+/**
+ * @brief Memory-mapped file the tiles of a PixelWorld are evicted to.
+ * @note A stored tile is read straight from the mapping, so the system loads
+ * it back when it is touched and may drop it from memory again while it is
+ * not. The file grows by segments that are mapped once and never move, so a
+ * stored tile stays where it is until it is freed. Removed when closed.
+ */
+class TilePageFile : public std::enable_shared_from_this<TilePageFile> {
+public:
+	// Tiles per mapped segment, a segment is about 5 MB
+	static constexpr int segment_tiles = 256;
+
+	// Throws std::runtime_error if the file cannot be created
+	static std::shared_ptr<TilePageFile> create(
+		const std::filesystem::path &path
+	);
+
+	// A new file in the temporary directory of the system
+	static std::shared_ptr<TilePageFile> createTemporary();
+
+	TilePageFile(const TilePageFile &) = delete;
+	TilePageFile &operator=(const TilePageFile &) = delete;
+	~TilePageFile() noexcept;
+
+	// Copy of tile within the file, freed once the last owner lets go of
+	// it. Null if the file cannot grow any further. Must not be written to,
+	// see PixelWorld::pageOutTiles().
+	std::shared_ptr<PixelTile> store(const PixelTile &tile) noexcept;
+
+	int storedTileCount() const noexcept;
+
+private:
+	struct Handle;
+
+	explicit TilePageFile(std::unique_ptr<Handle> handle) noexcept;
+
+	bool addSegment() noexcept;
+	void release(PixelTile *tile) noexcept;
+
+	std::unique_ptr<Handle> _handle;
+	std::vector<PixelTile *> _segments;
+	std::vector<PixelTile *> _free_tiles;
+	mutable std::mutex _mutex;
+};
+
+} // namespace wf
+
+#endif // WFORGE_PAGEFILE_H
@@ -0,0 +1,43 @@
+#ifndef WFORGE_PIXELSHAPE_H
+#define WFORGE_PIXELSHAPE_H
+
+#include "wforge/colorpalette.h"
+#include "wforge/fallsand.h"
+#include <cstdint>
+
+namespace wf {
+
+// Determine pixel type and color index from a color
+// Returns {PixelType::Decoration, 255} for not recognized colors
+PixelTypeAndColor pixelTypeFromColor(const RGBAColor &color) noexcept;
+
+// Bitmap shape of a pixel-based entity, a view over RGBA8 pixel data
+class PixelShape {
+public:
+	// data: width * height * 4 bytes (RGBA), must outlive the shape
+	PixelShape(int width, int height, const std::uint8_t *data) noexcept;
+	PixelShape() noexcept;
+
+	int width() const noexcept {
+		return _width;
+	}
+
+	int height() const noexcept {
+		return _height;
+	}
+
+	// not fully transparent at (x, y)
+	bool hasPixel(int x, int y) const noexcept;
+	RGBAColor colorOf(int x, int y) const noexcept;
+
+	bool isPOIPixel(int x, int y) const noexcept;
+
+protected:
+	int _width;
+	int _height;
+	const std::uint8_t *_data; // no ownership, ~static
+};
+
+} // namespace wf
+
+#endif // WFORGE_PIXELSHAPE_H
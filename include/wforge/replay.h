@@ -0,0 +1,70 @@
+#ifndef WFORGE_REPLAY_H
+#define WFORGE_REPLAY_H
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace wf {
+
+struct Level;
+
+// A call of the player into a level, made before the step of tick
+struct ReplayInput {
+	enum class Kind : std::uint8_t {
+		UseItem,         // at (x, y), value is the render scale
+		SelectItem,      // value is the item index
+		PrevItem,
+		NextItem,
+		ChangeBrushSize, // value is the delta
+		Rewind,          // value is 1 while held, see RewindBuffer
+	};
+
+	std::uint32_t tick;
+	Kind kind;
+	std::int32_t value = 0;
+	std::int32_t x = 0;
+	std::int32_t y = 0;
+
+	// Make the call on level. Rewind is up to the caller, the rewind buffer
+	// is not part of the level.
+	void applyTo(Level &level) const noexcept;
+};
+
+/**
+ * @brief Inputs of one playthrough of a level, from its load on.
+ * @note The level is loaded with the run seed it was played with, see
+ * Level::setRunSeed(), so the same inputs at the same ticks play it the
+ * same way again.
+ */
+struct Replay {
+	std::string map_id;
+	std::string run_seed;
+
+	// Of the global passes the level was played with, see
+	// PixelWorld::setFluidInterval()
+	std::int32_t fluid_interval = 1;
+	std::int32_t thermal_interval = 1;
+
+	std::uint32_t num_ticks = 0;
+
+	// Digest of Level::saveState() after the last tick, to tell whether a
+	// replay still plays out the way it was recorded
+	std::uint64_t end_digest = 0;
+
+	std::vector<ReplayInput> inputs; // by tick
+
+	static std::uint64_t digestOf(std::span<const std::uint8_t> bytes
+	) noexcept;
+
+	// Throw std::runtime_error if the file cannot be written or read, or
+	// is not a replay
+	void save(const std::filesystem::path &path) const;
+	static Replay load(const std::filesystem::path &path);
+};
+
+} // namespace wf
+
+#endif // WFORGE_REPLAY_H
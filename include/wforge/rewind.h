@@ -0,0 +1,102 @@
+#ifndef WFORGE_REWIND_H
+#define WFORGE_REWIND_H
+
+#include "wforge/fallsand.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <vector>
+
+namespace wf {
+
+struct Level;
+
+/**
+ * @brief History of the last ticks of a level to step back and forth in.
+ * @note A tick is kept as the XOR of the tiles that changed since the tick
+ * before, see PixelWorld::saveTileDelta(), and the rest of the level state
+ * without tiles. Every keyframe_interval ticks a full save state is kept as
+ * well, so that seek() does not walk through every tick. The oldest ticks
+ * are dropped once there are more than capacity or all of them take more
+ * than max_bytes, see memoryUsage().
+ */
+class RewindBuffer {
+public:
+	RewindBuffer(int capacity, int keyframe_interval, std::size_t max_bytes);
+
+	// Keep the tick level is at after a step. Ticks ahead of the current
+	// one, left by stepping back, are dropped. The ticks recorded must all
+	// be of the same level, call clear() before recording another one.
+	void record(Level &level);
+
+	// Turn level into the tick before or after the current one, false if
+	// there is none
+	bool stepBackward(Level &level);
+	bool stepForward(Level &level);
+
+	// Turn level into the tick at index, 0 being the oldest one kept
+	void seek(Level &level, int index);
+
+	void clear() noexcept;
+
+	int size() const noexcept {
+		return static_cast<int>(_frames.size());
+	}
+
+	// Index of the tick the level is at
+	int position() const noexcept {
+		return _position;
+	}
+
+	// Bytes taken by the kept ticks and by the tiles the fork of the world
+	// kept in memory over the last tick, at most max_bytes. The world copies
+	// the tiles it writes to, while the fork holds on to the ones they were
+	// copied from until the next record().
+	std::size_t memoryUsage() const noexcept {
+		return _bytes + _pinned_bytes;
+	}
+
+	// Average of the kept ticks without the tiles of the fork, times the tick
+	// rate for the bytes per second of history
+	std::size_t bytesPerTick() const noexcept {
+		return _frames.empty() ? 0 : _bytes / _frames.size();
+	}
+
+private:
+	struct Frame {
+		std::vector<std::uint8_t> tile_delta; // to the tick before
+		std::vector<std::uint8_t> state;      // without tiles
+		std::vector<std::uint8_t> keyframe;   // Level::saveState() or empty
+
+		std::size_t bytes() const noexcept {
+			return tile_delta.size() + state.size() + keyframe.size();
+		}
+	};
+
+	void dropOldest() noexcept;
+
+	// Move level from the current tick to the one at index next to it, by
+	// the tile delta of the later of the two
+	void moveTo(Level &level, int index);
+
+	// Take the fork of the world the next delta is taken against
+	void forkWorld(Level &level);
+
+	int _capacity;
+	int _keyframe_interval;
+	std::size_t _max_bytes;
+
+	std::deque<Frame> _frames;
+	int _position = -1;
+	std::size_t _bytes = 0;
+
+	// Fork of the world at the current tick, what the next delta is taken
+	// against
+	std::optional<PixelWorld> _previous;
+	std::size_t _pinned_bytes = 0; // see memoryUsage()
+};
+
+} // namespace wf
+
+#endif // WFORGE_REWIND_H
@@ -9,6 +9,7 @@ struct UserSettings {
 	bool strict_pixel_perfection;
 	bool skip_animations;
 	bool debug_heat_render;
+	int pass_interval; // least for every level, see LevelMetadata
 
 	static UserSettings defaultSettings() noexcept;
 };
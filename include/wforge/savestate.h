@@ -0,0 +1,80 @@
+#ifndef WFORGE_SAVESTATE_H
+#define WFORGE_SAVESTATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace wf {
+
+// Binary snapshots of a level in progress, see Level::saveState(). Numbers
+// are stored in the byte order of the machine, which is little endian on
+// every platform the game runs on.
+class StateWriter {
+public:
+	template<typename T>
+		requires std::is_trivially_copyable_v<T>
+	void write(const T &value) {
+		const auto *bytes = reinterpret_cast<const std::uint8_t *>(&value);
+		_bytes.insert(_bytes.end(), bytes, bytes + sizeof(T));
+	}
+
+	void writeString(std::string_view str);
+
+	// Run-length encoded, made for the long runs of the same byte in the
+	// planes of a tile. A run takes two bytes per 130 bytes, other bytes one
+	// more per 128.
+	void writePacked(std::span<const std::uint8_t> bytes);
+
+	const std::vector<std::uint8_t> &bytes() const noexcept {
+		return _bytes;
+	}
+
+	std::vector<std::uint8_t> takeBytes() noexcept {
+		return std::move(_bytes);
+	}
+
+private:
+	std::vector<std::uint8_t> _bytes;
+};
+
+// Reads what StateWriter wrote. Throws std::runtime_error if the state ends
+// early or does not decode.
+class StateReader {
+public:
+	explicit StateReader(std::span<const std::uint8_t> bytes) noexcept
+		: _bytes(bytes) {}
+
+	template<typename T>
+		requires std::is_trivially_copyable_v<T>
+	T read() {
+		T value;
+		std::memcpy(&value, take(sizeof(T)), sizeof(T));
+		return value;
+	}
+
+	std::string readString();
+
+	// Fills all of out from what writePacked() wrote
+	void readPacked(std::span<std::uint8_t> out);
+
+	bool atEnd() const noexcept {
+		return _pos == _bytes.size();
+	}
+
+private:
+	const std::uint8_t *take(std::size_t count);
+
+	std::span<const std::uint8_t> _bytes;
+	std::size_t _pos = 0;
+};
+
+} // namespace wf
+
+#endif // WFORGE_SAVESTATE_H
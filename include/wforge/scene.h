@@ -5,6 +5,8 @@
 #include "wforge/audio.h"
 #include "wforge/fallsand.h"
 #include "wforge/level.h"
+#include "wforge/replay.h"
+#include "wforge/rewind.h"
 #include <SFML/Audio/Music.hpp>
 #include <SFML/Audio/Sound.hpp>
 #include <SFML/Graphics.hpp>
@@ -12,6 +14,9 @@
 #include <SFML/System/Vector2.hpp>
 #include <SFML/Window/Event.hpp>
 #include <SFML/Window/Window.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
 #include <memory>
 #include <nlohmann/json_fwd.hpp>
 #include <proxy/v4/proxy.h>
@@ -25,9 +30,19 @@ namespace _dispatch {
 
 PRO_DEF_MEM_DISPATCH(MemSize, size);
 PRO_DEF_MEM_DISPATCH(MemHandleEvent, handleEvent);
+PRO_DEF_MEM_DISPATCH(MemRender, render);
 
 }; // namespace _dispatch
 
+constexpr sf::Color ui_text_color(std::uint8_t a) {
+	return sf::Color(0, 0, 0, a);
+}
+
+constexpr sf::Color ui_active_color{250, 200, 46, 255};
+constexpr sf::Color ui_text_bright_color(std::uint8_t a) {
+	return sf::Color(255, 255, 255, a);
+}
+
 class SceneManager;
 
 /* clang-format off */
@@ -58,6 +73,33 @@ struct UITextDescriptor {
 
 int automaticScale(int width, int height, int scale_configured = 0);
 
+struct LevelRenderer {
+	LevelRenderer(Level &level);
+
+	void render(sf::RenderTarget &target, int mouse_x, int mouse_y, int scale);
+
+private:
+	Level &_level;
+	std::unique_ptr<std::uint8_t[]> _fallsand_buffer;
+	sf::Texture _fallsand_texture;
+	sf::Sprite _fallsand_sprite;
+	std::unique_ptr<std::uint8_t[]> _heat_buffer;
+	sf::Texture _heat_texture;
+	sf::Sprite _heat_sprite;
+	sf::Sprite _duck_sprite;
+	CheckpointSprite &_checkpoint_sprite;
+	PixelFont &_font;
+
+	void _renderFallsand(sf::RenderTarget &target);
+	void _renderHeat(sf::RenderTarget &target);
+	void _renderDuck(sf::RenderTarget &target, int scale);
+	void _renderCheckpoint(sf::RenderTarget &target, int scale);
+	void _renderItemText(sf::RenderTarget &target, int scale);
+	void _renderBrushOutline(
+		sf::RenderTarget &target, int mouse_x, int mouse_y, int scale
+	);
+};
+
 class SceneManager {
 public:
 	SceneManager(Scene initial_scene, int scale = 0);
@@ -92,8 +134,21 @@ struct ButtonDescriptor {
 namespace scene {
 
 struct LevelPlaying {
+	// Holding Backspace plays back up to 10 seconds at 24 ticks per second
+	static constexpr int rewind_ticks = 24 * 10;
+	static constexpr int rewind_keyframe_interval = 24 * 2;
+	static constexpr std::size_t rewind_max_bytes = 32 << 20;
+
 	LevelPlaying(const std::string &level_id);
 	LevelPlaying(Level level);
+	LevelPlaying(LevelPlaying &&) noexcept = default;
+
+	// Writes the replay when recording
+	~LevelPlaying();
+
+	// Record the inputs of the levels played from now on into a replay file
+	// at path, the level played last is kept, see replay.h
+	static void setRecordPath(std::filesystem::path path);
 
 	std::array<int, 2> size() const;
 	void setup(SceneManager &mgr);
@@ -107,10 +162,16 @@ struct LevelPlaying {
 	void unpause(SceneManager &mgr) noexcept;
 
 private:
+	// Every input of the player goes through here, so that it is recorded
+	void _input(ReplayInput::Kind kind, int value = 0, int x = 0, int y = 0);
 	void _restartLevel(SceneManager &mgr, bool is_failed = true);
 
 	int _tick;
 	Level _level;
+	Level _pristine_level; // fork of the level as loaded, a retry resumes it
+	RewindBuffer _rewind;  // the last ticks played, see rewind.h
+	bool _rewinding;       // Backspace held
+	std::unique_ptr<Replay> _replay; // inputs recorded, see setRecordPath()
 	mutable LevelRenderer _renderer;
 	int _hint_type;
 	int _hint_opacity;
@@ -126,7 +187,7 @@ private:
 struct DuckDeath {
 	DuckDeath(
 		int level_width, int level_height, int duck_x, int duck_y,
-		LevelMetadata level_metadata
+		Level pristine_level
 	);
 
 	std::array<int, 2> size() const;
@@ -155,7 +216,7 @@ private:
 	int _sperate_sfx_start;
 	int _reborn_sfx_start;
 
-	LevelMetadata _level_metadata;
+	Level _pristine_level; // played again once the animation is over
 	PixelAnimationFrames &_animation;
 	sf::Sound _reborn_sound;
 	sf::Sound _duck_death_separate_sound;
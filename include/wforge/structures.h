@@ -2,7 +2,8 @@
 #define WFORGE_STRUCTURES_H
 
 #include "wforge/2d.h"
-#include "wforge/assets.h"
+#include "wforge/assetcache.h"
+#include "wforge/pixelshape.h"
 #include "wforge/fallsand.h"
 #include <cstdint>
 #include <memory>
@@ -31,6 +32,11 @@ struct PixelShapedStructure : PositionedStructure {
 
 	bool step(PixelWorld &world) const noexcept;
 
+	// Nothing of the shape changes after setup(), structures with a state
+	// of their own extend these
+	void saveState(StateWriter &out) const;
+	void loadState(StateReader &in);
+
 protected:
 	int width() const noexcept {
 		return _shape.width();
@@ -45,7 +51,8 @@ protected:
 	std::vector<std::array<int, 2>> poi;
 
 private:
-	std::unique_ptr<PixelTypeAndColor[]> _pixel_types;
+	// Never changed after construction, shared by the copies of a fork
+	std::shared_ptr<PixelTypeAndColor[]> _pixel_types;
 	const PixelShape &_shape;
 };
 
@@ -53,6 +60,8 @@ struct InputElectricalStructure : PixelShapedStructure {
 	InputElectricalStructure(int x, int y, const PixelShape &shape) noexcept;
 
 	bool step(PixelWorld &world) noexcept;
+	void saveState(StateWriter &out) const;
+	void loadState(StateReader &in);
 
 protected:
 	static constexpr int power_capacity = 12;
@@ -130,6 +139,8 @@ struct Gate : InputElectricalStructure {
 		std::span<std::uint8_t> buf, const PixelWorld &world
 	) const noexcept;
 	int priority() const noexcept;
+	void saveState(StateWriter &out) const;
+	void loadState(StateReader &in);
 
 	Gate(int x, int y, FacingDirection dir);
 
@@ -148,12 +159,14 @@ private:
 	int _base_place_x;
 	int _base_place_y;
 	const PixelShape &_gate_wall_shape;
-	std::unique_ptr<PixelTypeAndColor[]> _gate_wall_pixel_types;
+	std::shared_ptr<PixelTypeAndColor[]> _gate_wall_pixel_types;
 };
 
 struct TransistorNPN : InputElectricalStructure {
 	bool step(PixelWorld &world) noexcept;
 	int priority() const noexcept;
+	void saveState(StateWriter &out) const;
+	void loadState(StateReader &in);
 
 	TransistorNPN(int x, int y, FacingDirection dir);
 
@@ -165,6 +178,8 @@ private:
 struct TransistorPNP : InputElectricalStructure {
 	bool step(PixelWorld &world) noexcept;
 	int priority() const noexcept;
+	void saveState(StateWriter &out) const;
+	void loadState(StateReader &in);
 
 	TransistorPNP(int x, int y, FacingDirection dir);
 
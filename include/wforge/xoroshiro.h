@@ -64,12 +64,53 @@ public:
 	 */
 	Xoroshiro128PP jump_96() const noexcept;
 
+	/**
+	 * @brief The current state of the generator.
+	 * @return A seed, from which `Xoroshiro128PP(seed)` continues the same
+	 * sequence, e.g. to save it.
+	 */
+	Seed state() const noexcept;
+
+	/**
+	 * @brief The generator of the calling thread.
+	 * @return The generator bound by `bindThreadInstance()` on this thread,
+	 * or the process-wide generator if there is none.
+	 */
 	static Xoroshiro128PP &globalInstance() noexcept;
 
+	/**
+	 * @brief Makes `globalInstance()` return `rng` on the calling thread.
+	 * @param rng Generator owned by the caller, `nullptr` to unbind.
+	 * @return The generator bound before, to be bound again when done.
+	 * @note Worker threads bind their own stream, e.g. from `jump_64()`, so
+	 * that code running on them never touches the process-wide generator.
+	 * Levels and worlds bind theirs while they step, so that a run depends
+	 * on their seed only.
+	 */
+	static Xoroshiro128PP *bindThreadInstance(Xoroshiro128PP *rng) noexcept;
+
 private:
 	Seed seed;
 };
 
+// Binds a generator to the calling thread for the lifetime of the guard and
+// restores the one bound before, see Xoroshiro128PP::bindThreadInstance()
+class ScopedThreadRng {
+public:
+	explicit ScopedThreadRng(Xoroshiro128PP &rng) noexcept
+		: _outer(Xoroshiro128PP::bindThreadInstance(&rng)) {}
+
+	ScopedThreadRng(const ScopedThreadRng &) = delete;
+	ScopedThreadRng &operator=(const ScopedThreadRng &) = delete;
+
+	~ScopedThreadRng() noexcept {
+		Xoroshiro128PP::bindThreadInstance(_outer);
+	}
+
+private:
+	Xoroshiro128PP *_outer;
+};
+
 } // namespace wf
 
 #endif
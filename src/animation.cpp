@@ -1,4 +1,5 @@
 #include "wforge/assets.h"
+#include <SFML/Graphics/Sprite.hpp>
 #include <SFML/Graphics/Texture.hpp>
 #include <SFML/System/Vector2.hpp>
 #include <format>
@@ -64,4 +65,78 @@ void PixelAnimationFrames::render(
 	target.draw(sprite);
 }
 
+CheckpointSprite::CheckpointSprite(
+	sf::Image &checkpoint_1, sf::Image &checkpoint_2
+) {
+	if (checkpoint_1.getSize() != checkpoint_2.getSize()) {
+		throw std::invalid_argument(
+			std::format(
+				"CheckpointSprite: checkpoint_1 and checkpoint_2 have "
+				"different "
+				"sizes: ({}, {}) vs ({}, {})",
+				checkpoint_1.getSize().x, checkpoint_1.getSize().y,
+				checkpoint_2.getSize().x, checkpoint_2.getSize().y
+			)
+		);
+	}
+
+	if (!_ckeckpoint_1.loadFromImage(checkpoint_1)) {
+		throw std::runtime_error("Failed to load checkpoint_1 texture");
+	}
+
+	if (!_checkpoint_2.loadFromImage(checkpoint_2)) {
+		throw std::runtime_error("Failed to load checkpoint_2 texture");
+	}
+}
+
+int CheckpointSprite::width() const noexcept {
+	return _ckeckpoint_1.getSize().x;
+}
+
+int CheckpointSprite::height() const noexcept {
+	return _ckeckpoint_1.getSize().y;
+}
+
+void CheckpointSprite::render(
+	sf::RenderTarget &target, int x, int y, int progress, int scale
+) const {
+	// Top height - progress pixels from checkpoint_1
+	// Bottom progress pixels from checkpoint_2
+	auto height = this->height();
+	auto width = this->width();
+
+	if (progress > height || progress < 0) {
+		throw std::invalid_argument(
+			std::format(
+				"CheckpointSprite::render: invalid progress value: {} "
+				"(out of range 0-{})",
+				progress, height
+			)
+		);
+	}
+
+	if (progress > 0) {
+		sf::Sprite sprite_bottom(
+			_checkpoint_2,
+			sf::IntRect({0, height - progress}, {width, progress})
+		);
+
+		sprite_bottom.setPosition(
+			sf::Vector2f(x * scale, (y + height - progress) * scale)
+		);
+		sprite_bottom.setScale(sf::Vector2f(scale, scale));
+		target.draw(sprite_bottom);
+	}
+
+	if (progress < height) {
+		sf::Sprite sprite_top(
+			_ckeckpoint_1, sf::IntRect({0, 0}, {width, height - progress})
+		);
+
+		sprite_top.setPosition(sf::Vector2f(x * scale, y * scale));
+		sprite_top.setScale(sf::Vector2f(scale, scale));
+		target.draw(sprite_top);
+	}
+}
+
 } // namespace wf
@@ -0,0 +1,33 @@
+#include "wforge/assetcache.h"
+#include <format>
+#include <stdexcept>
+#include <string>
+
+namespace wf {
+
+AssetsManager &AssetsManager::instance() noexcept {
+	static AssetsManager mgr;
+	return mgr;
+}
+
+void *AssetsManager::_getAssetRaw(const std::string &id) {
+	auto it = _asset_cache.find(id);
+	if (it == _asset_cache.end()) {
+		throw std::invalid_argument(
+			std::format("AssetsManager: asset not found: {}", id)
+		);
+	}
+
+	return it->second;
+}
+
+void AssetsManager::_cacheAssetRaw(const std::string &id, void *asset) {
+	if (_asset_cache.find(id) != _asset_cache.end()) {
+		throw std::invalid_argument(
+			std::format("AssetsManager: asset ID '{}' is already cached", id)
+		);
+	}
+	_asset_cache[id] = asset;
+}
+
+} // namespace wf
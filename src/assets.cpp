@@ -12,6 +12,7 @@
 #include <format>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <nlohmann/json.hpp>
 #include <random>
 #include <stdexcept>
@@ -19,104 +20,15 @@
 #include <unordered_map>
 #include <utility>
 
-#ifndef NDEBUG
-#include <cpptrace/cpptrace.hpp>
-#endif
-
 namespace fs = std::filesystem;
 
 namespace wf {
 
-PixelTypeAndColor pixelTypeFromColor(const sf::Color &color) noexcept {
-	switch (color.toInteger()) {
-	case packColorByName("Air"):
-	case packColorByName("POIMarker"):
-		return {PixelType::Air, colorIndexOf("Air")};
-
-	case packColorByName("Stone1"):
-		return {PixelType::Stone, colorIndexOf("Stone1")};
-	case packColorByName("Stone2"):
-		return {PixelType::Stone, colorIndexOf("Stone2")};
-	case packColorByName("Stone3"):
-		return {PixelType::Stone, colorIndexOf("Stone3")};
-	case packColorByName("Stone4"):
-		return {PixelType::Stone, colorIndexOf("Stone4")};
-
-	case packColorByName("Wood1"):
-		return {PixelType::Wood, colorIndexOf("Wood1")};
-	case packColorByName("Wood2"):
-		return {PixelType::Wood, colorIndexOf("Wood2")};
-	case packColorByName("Wood3"):
-		return {PixelType::Wood, colorIndexOf("Wood3")};
-
-	case packColorByName("Copper1"):
-		return {PixelType::Copper, colorIndexOf("Copper1")};
-	case packColorByName("Copper2"):
-		return {PixelType::Copper, colorIndexOf("Copper2")};
-	case packColorByName("Copper3"):
-		return {PixelType::Copper, colorIndexOf("Copper3")};
-	case packColorByName("Copper4"):
-		return {PixelType::Copper, colorIndexOf("Copper4")};
-	case packColorByName("Copper5"):
-		return {PixelType::Copper, colorIndexOf("Copper5")};
-
-	case packColorByName("Sand1"):
-		return {PixelType::Sand, colorIndexOf("Sand1")};
-
-	case packColorByName("Sand2"):
-		return {PixelType::Sand, colorIndexOf("Sand2")};
-
-	case packColorByName("Water"):
-	case packColorByNameNoAlpha("Water"):
-		return {PixelType::Water, colorIndexOf("Water")};
-
-	case packColorByName("Oil"):
-	case packColorByNameNoAlpha("Oil"):
-		return {PixelType::Oil, colorIndexOf("Oil")};
-
-	default:
-		return {PixelType::Decoration, 255};
-	}
-}
-
-PixelShape::PixelShape(const sf::Image &img) noexcept
-	: _width(img.getSize().x)
-	, _height(img.getSize().y)
-	, _data(img.getPixelsPtr()) {}
-
-PixelShape::PixelShape() noexcept: _width(0), _height(0), _data(nullptr) {}
-
-bool PixelShape::hasPixel(int x, int y) const noexcept {
-	if (colorOf(x, y).a == 0) {
-		return false;
-	}
-
-	return !isPOIPixel(x, y);
-}
-
-sf::Color PixelShape::colorOf(int x, int y) const noexcept {
-#ifndef NDEBUG
-	if (x < 0 || x >= _width || y < 0 || y >= _height) {
-		std::cerr << std::format(
-			"PixelMap::colorOf: index out of bounds: x = {}, y = {}, width = "
-			"{}, height = {}\n",
-			x, y, _width, _height
-		);
-		cpptrace::generate_trace().print();
-		std::abort();
-	}
-#endif
-	// Data: size is _width * _height * 4, each pixel is 4 bytes (RGBA)
-	std::uint8_t r = _data[(y * _width + x) * 4 + 0];
-	std::uint8_t g = _data[(y * _width + x) * 4 + 1];
-	std::uint8_t b = _data[(y * _width + x) * 4 + 2];
-	std::uint8_t a = _data[(y * _width + x) * 4 + 3];
-	return sf::Color(r, g, b, a);
-}
-
-bool PixelShape::isPOIPixel(int x, int y) const noexcept {
-	// Almost transparent red indicates POI
-	return colorOf(x, y) == colorOfName("POIMarker");
+PixelShape pixelShapeOf(const sf::Image &img) noexcept {
+	return PixelShape(
+		static_cast<int>(img.getSize().x), static_cast<int>(img.getSize().y),
+		img.getPixelsPtr()
+	);
 }
 
 sf::Image trimImage(const sf::Image &img) {
@@ -219,38 +131,29 @@ sf::Music *MusicCollection::getRandomMusic() const {
 	return music[dist(rng)];
 }
 
-AssetsManager &AssetsManager::instance() noexcept {
-	static AssetsManager mgr;
-	return mgr;
-}
+MusicCollection &musicCollectionOf(const std::string &id) {
+	static std::map<std::string, MusicCollection> music_collections;
 
-void *AssetsManager::_getAssetRaw(const std::string &id) {
-	auto it = _asset_cache.find(id);
-	if (it == _asset_cache.end()) {
-		throw std::invalid_argument(
-			std::format("AssetsManager: asset not found: {}", id)
-		);
+	auto it = music_collections.find(id);
+	if (it == music_collections.end()) {
+		auto [it, _] = music_collections.insert({id, MusicCollection{id, {}}});
+		return it->second;
 	}
-
 	return it->second;
 }
 
-void AssetsManager::_cacheAssetRaw(const std::string &id, void *asset) {
-	if (_asset_cache.find(id) != _asset_cache.end()) {
-		throw std::invalid_argument(
-			std::format("AssetsManager: asset ID '{}' is already cached", id)
-		);
-	}
-	_asset_cache[id] = asset;
+Level Level::loadFromAsset(const std::string &level_id) {
+	auto &metadata = AssetsManager::instance().getAsset<LevelMetadata>(
+		level_id
+	);
+	return loadFromMetadata(metadata);
 }
 
-MusicCollection &AssetsManager::getMusicCollection(const std::string &id) {
-	auto it = _music_collections.find(id);
-	if (it == _music_collections.end()) {
-		auto [it, _] = _music_collections.insert({id, MusicCollection{id, {}}});
-		return it->second;
-	}
-	return it->second;
+Level Level::loadFromMetadata(LevelMetadata metadata) {
+	const auto &image = AssetsManager::instance().getAsset<sf::Image>(
+		metadata.map_id
+	);
+	return loadFromBitmap(std::move(metadata), pixelShapeOf(image));
 }
 
 namespace {
@@ -386,7 +289,7 @@ void fMusic(
 
 	if (entry.contains("collections")) {
 		for (const auto &collection_name : entry.at("collections")) {
-			auto &collection = mgr.getMusicCollection(
+			auto &collection = musicCollectionOf(
 				collection_name.get<std::string>()
 			);
 			collection.music.push_back(music);
@@ -448,7 +351,7 @@ void fPixelShape(
 	const std::string &input_id = entry.at("input");
 	auto &img = mgr.getAsset<sf::Image>(input_id);
 	const std::string &id = entry.at("id");
-	auto shape = new PixelShape(img);
+	auto shape = new PixelShape(pixelShapeOf(img));
 	mgr.cacheAsset(id, shape);
 }
 
@@ -461,7 +364,7 @@ void fPixelShapeAllRotated(
 
 	auto shapes = new PixelShape[4];
 	for (int i = 0; i < 4; ++i) {
-		shapes[i] = PixelShape(img[i]);
+		shapes[i] = pixelShapeOf(img[i]);
 	}
 
 	mgr.cacheAsset(id, shapes);
@@ -477,8 +380,9 @@ void fCheckpointSprite(
 	mgr.cacheAsset(id, checkpoint_sprite);
 }
 
-void fLevelMetadata(
-	const nlohmann::json &entry, const fs::path &assets_root, AssetsManager &mgr
+void loadLevelMetadata(
+	const nlohmann::json &entry, const fs::path &assets_root, AssetsManager &mgr,
+	bool with_minimap
 ) {
 	constexpr int current_levelmetadata_format = 1;
 
@@ -508,6 +412,16 @@ void fLevelMetadata(
 	}
 
 	const auto &metadata_json = json_data.at("metadata");
+	const auto passes_json = json_data.value(
+		"passes", nlohmann::json::object()
+	);
+
+	sf::Texture *minimap_texture = nullptr;
+	if (with_minimap) {
+		minimap_texture = &mgr.getAsset<sf::Texture>(
+			metadata_json.value("minimap_asset_id", "level/minimap/fallback")
+		);
+	}
 
 	LevelMetadata *metadata = new LevelMetadata{
 		.map_id = json_data.at("map"),
@@ -517,9 +431,9 @@ void fLevelMetadata(
 		.difficulty = LevelMetadata::parseDifficulty(
 			metadata_json.value("difficulty", "unkown")
 		),
-		.minimap_texture = &mgr.getAsset<sf::Texture>(
-			metadata_json.value("minimap_asset_id", "level/minimap/fallback")
-		)
+		.minimap_texture = minimap_texture,
+		.fluid_interval = passes_json.value("fluid_interval", 1),
+		.thermal_interval = passes_json.value("thermal_interval", 1),
 	};
 
 	for (const auto &item_entry : json_data.at("items")) {
@@ -531,6 +445,19 @@ void fLevelMetadata(
 	mgr.cacheAsset(id, metadata);
 }
 
+void fLevelMetadata(
+	const nlohmann::json &entry, const fs::path &assets_root, AssetsManager &mgr
+) {
+	loadLevelMetadata(entry, assets_root, mgr, true);
+}
+
+// Textures are not loaded without a display
+void fLevelMetadataWithoutMinimap(
+	const nlohmann::json &entry, const fs::path &assets_root, AssetsManager &mgr
+) {
+	loadLevelMetadata(entry, assets_root, mgr, false);
+}
+
 void fFont(
 	const nlohmann::json &entry, const fs::path &assets_root, AssetsManager &mgr
 ) {
@@ -579,9 +506,10 @@ void fLevelSequence(
 	mgr.cacheAsset(id, level_seq);
 }
 
-} // namespace
-
-void AssetsManager::loadAllAssets() {
+// Operations mapped to nullptr are skipped
+void executeManifest(
+	const std::unordered_map<std::string, operationFunc> &operations
+) {
 	auto assets_root = findAssetsRoot();
 	std::cerr << "AssetsManager: loading assets from " << assets_root << "\n";
 
@@ -597,23 +525,6 @@ void AssetsManager::loadAllAssets() {
 		);
 	}
 
-	std::unordered_map<std::string, operationFunc> operations = {
-		{"json", fJSON},
-		{"image", fImage},
-		{"create-texture", fTexture},
-		{"music", fMusic},
-		{"sound", fSound},
-		{"trim-image", fTrimImage},
-		{"create-image-of-all-facings", fImageAllRotated},
-		{"calculate-shape", fPixelShape},
-		{"create-pixel-shape-of-all-facings", fPixelShapeAllRotated},
-		{"create-checkpoint-sprite", fCheckpointSprite},
-		{"level-metadata", fLevelMetadata},
-		{"font", fFont},
-		{"animation", fAnimationFrames},
-		{"level-sequence", fLevelSequence},
-	};
-
 	nlohmann::json manifest = nlohmann::json::parse(manifest_file);
 	AssetsManager &mgr = AssetsManager::instance();
 
@@ -629,13 +540,11 @@ void AssetsManager::loadAllAssets() {
 	const auto &entries = manifest.at("sequence");
 	int total_entries = entries.size();
 	int current_entry = 0;
+	int executed_entries = 0;
 	for (const auto &entry : entries) {
 		const std::string &op_name = entry.at("type");
 		const std::string &description = entry.at("description");
 		current_entry += 1;
-		std::cerr << std::format(
-			"[{:02}/{:02}] {}...\n", current_entry, total_entries, description
-		);
 		auto it = operations.find(op_name);
 		if (it == operations.end()) {
 			throw std::runtime_error(
@@ -644,15 +553,64 @@ void AssetsManager::loadAllAssets() {
 		}
 
 		auto func = it->second;
+		if (!func) {
+			continue;
+		}
+
+		std::cerr << std::format(
+			"[{:02}/{:02}] {}...\n", current_entry, total_entries, description
+		);
 		func(entry, assets_root, mgr);
+		executed_entries += 1;
 	}
 
 	auto dur = std::chrono::steady_clock::now() - start_loading_time;
 	std::cerr << std::format(
 		"Successfully executed {} asset loading operations in {} ms.\n",
-		total_entries,
+		executed_entries,
 		std::chrono::duration_cast<std::chrono::milliseconds>(dur).count()
 	);
 }
 
+} // namespace
+
+void AssetsManager::loadAllAssets() {
+	executeManifest({
+		{"json", fJSON},
+		{"image", fImage},
+		{"create-texture", fTexture},
+		{"music", fMusic},
+		{"sound", fSound},
+		{"trim-image", fTrimImage},
+		{"create-image-of-all-facings", fImageAllRotated},
+		{"calculate-shape", fPixelShape},
+		{"create-pixel-shape-of-all-facings", fPixelShapeAllRotated},
+		{"create-checkpoint-sprite", fCheckpointSprite},
+		{"level-metadata", fLevelMetadata},
+		{"font", fFont},
+		{"animation", fAnimationFrames},
+		{"level-sequence", fLevelSequence},
+	});
+}
+
+void AssetsManager::loadSimulationAssets() {
+	// Images are decoded in memory, only textures and audio need a device
+	executeManifest({
+		{"json", fJSON},
+		{"image", fImage},
+		{"create-texture", nullptr},
+		{"music", nullptr},
+		{"sound", nullptr},
+		{"trim-image", fTrimImage},
+		{"create-image-of-all-facings", fImageAllRotated},
+		{"calculate-shape", fPixelShape},
+		{"create-pixel-shape-of-all-facings", fPixelShapeAllRotated},
+		{"create-checkpoint-sprite", nullptr},
+		{"level-metadata", fLevelMetadataWithoutMinimap},
+		{"font", nullptr},
+		{"animation", nullptr},
+		{"level-sequence", fLevelSequence},
+	});
+}
+
 } // namespace wf
@@ -65,7 +65,7 @@ void BGMManager::setCollection(const std::string &id) {
 		return; // already set
 	}
 
-	_collection = &AssetsManager::instance().getMusicCollection(id);
+	_collection = &musicCollectionOf(id);
 	if (_cur_bgm) {
 		_cur_bgm->stop();
 		_cur_bgm = nullptr;
@@ -1,11 +1,12 @@
-#include "wforge/assets.h"
+#include "wforge/assetcache.h"
 #include "wforge/level.h"
-#include <SFML/Graphics/Sprite.hpp>
-#include <SFML/Graphics/Texture.hpp>
-#include <SFML/System/Vector2.hpp>
+#include "wforge/pixelshape.h"
+#include "wforge/savestate.h"
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 #include <format>
+#include <stdexcept>
 
 namespace wf {
 
@@ -20,14 +21,13 @@ CheckpointArea::CheckpointArea(): CheckpointArea(0, 0) {}
 CheckpointArea::CheckpointArea(int x, int y)
 	: x(x)
 	, y(y)
-	, _progress(0)
-	, _sprite(
-		  AssetsManager::instance().getAsset<CheckpointSprite>(
-			  "checkpoint/sprite"
-		  )
-	  ) {
-	_width = _sprite.width();
-	_height = _sprite.height();
+	, _progress(0) {
+	// Same size as the checkpoint sprite rendered by the client
+	const auto &shape = AssetsManager::instance().getAsset<PixelShape>(
+		"checkpoint/shape"
+	);
+	_width = shape.width();
+	_height = shape.height();
 }
 
 void CheckpointArea::setPosition(int x, int y) noexcept {
@@ -55,10 +55,17 @@ bool CheckpointArea::isCompleted() const noexcept {
 	return _progress >= _height * _ticks_per_progress;
 }
 
-void CheckpointArea::render(
-	sf::RenderTarget &target, int scale
-) const noexcept {
-	_sprite.render(target, x, y, progress(), scale);
+void CheckpointArea::saveState(StateWriter &out) const {
+	out.write<std::int32_t>(_progress);
+}
+
+void CheckpointArea::loadState(StateReader &in) {
+	_progress = in.read<std::int32_t>();
+	if (_progress < 0 || _progress > _height * _ticks_per_progress) {
+		throw std::runtime_error(
+			std::format("Corrupt save state: checkpoint at {}", _progress)
+		);
+	}
 }
 
 bool CheckpointArea::_isDuckInside(const Level &level) const noexcept {
@@ -95,78 +102,4 @@ bool CheckpointArea::_isDuckInside(const Level &level) const noexcept {
 	return false;
 }
 
-CheckpointSprite::CheckpointSprite(
-	sf::Image &checkpoint_1, sf::Image &checkpoint_2
-) {
-	if (checkpoint_1.getSize() != checkpoint_2.getSize()) {
-		throw std::invalid_argument(
-			std::format(
-				"CheckpointSprite: checkpoint_1 and checkpoint_2 have "
-				"different "
-				"sizes: ({}, {}) vs ({}, {})",
-				checkpoint_1.getSize().x, checkpoint_1.getSize().y,
-				checkpoint_2.getSize().x, checkpoint_2.getSize().y
-			)
-		);
-	}
-
-	if (!_ckeckpoint_1.loadFromImage(checkpoint_1)) {
-		throw std::runtime_error("Failed to load checkpoint_1 texture");
-	}
-
-	if (!_checkpoint_2.loadFromImage(checkpoint_2)) {
-		throw std::runtime_error("Failed to load checkpoint_2 texture");
-	}
-}
-
-int CheckpointSprite::width() const noexcept {
-	return _ckeckpoint_1.getSize().x;
-}
-
-int CheckpointSprite::height() const noexcept {
-	return _ckeckpoint_1.getSize().y;
-}
-
-void CheckpointSprite::render(
-	sf::RenderTarget &target, int x, int y, int progress, int scale
-) const {
-	// Top height - progress pixels from checkpoint_1
-	// Bottom progress pixels from checkpoint_2
-	auto height = this->height();
-	auto width = this->width();
-
-	if (progress > height || progress < 0) {
-		throw std::invalid_argument(
-			std::format(
-				"CheckpointSprite::render: invalid progress value: {} "
-				"(out of range 0-{})",
-				progress, height
-			)
-		);
-	}
-
-	if (progress > 0) {
-		sf::Sprite sprite_bottom(
-			_checkpoint_2,
-			sf::IntRect({0, height - progress}, {width, progress})
-		);
-
-		sprite_bottom.setPosition(
-			sf::Vector2f(x * scale, (y + height - progress) * scale)
-		);
-		sprite_bottom.setScale(sf::Vector2f(scale, scale));
-		target.draw(sprite_bottom);
-	}
-
-	if (progress < height) {
-		sf::Sprite sprite_top(
-			_ckeckpoint_1, sf::IntRect({0, 0}, {width, height - progress})
-		);
-
-		sprite_top.setPosition(sf::Vector2f(x * scale, y * scale));
-		sprite_top.setScale(sf::Vector2f(scale, scale));
-		target.draw(sprite_top);
-	}
-}
-
 } // namespace wf
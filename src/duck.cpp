@@ -1,9 +1,8 @@
 #include "wforge/2d.h"
-#include "wforge/assets.h"
+#include "wforge/assetcache.h"
 #include "wforge/fallsand.h"
 #include "wforge/level.h"
 #include "wforge/xoroshiro.h"
-#include <SFML/Window/Joystick.hpp>
 #include <algorithm>
 #include <cmath>
 
@@ -31,10 +30,10 @@ struct RelatedPixel {
 
 } // namespace
 
-DuckEntity::DuckEntity(sf::Vector2f pos) noexcept
+DuckEntity::DuckEntity(Vec2f pos) noexcept
 	: shape(AssetsManager::instance().getAsset<PixelShape>("duck/shape"))
 	, position(pos)
-	, velocity(0.0f, 0.0f) {}
+	, velocity{0.0f, 0.0f} {}
 
 void DuckEntity::setPosition(float x, float y) noexcept {
 	position.x = x;
@@ -83,7 +82,7 @@ bool DuckEntity::willCollideAt(
 				continue;
 			}
 
-			auto tag = world.tagOf(wx, wy);
+			PixelTag tag = world.tagOf(wx, wy);
 			if (tag.pclass == PixelClass::Solid && !tag.is_free_falling) {
 				return true;
 			}
@@ -178,7 +177,7 @@ void DuckEntity::step(const Level &level) noexcept {
 	float total_flow = .0;
 	for (const auto &rp : related_pixels) {
 		if (world.classOfIs(rp.x, rp.y, PixelClass::Fluid)) {
-			const auto &tag = world.tagOf(rp.x, rp.y);
+			PixelTag tag = world.tagOf(rp.x, rp.y);
 			total_flow += tag.fluid_dir * rp.area;
 		}
 	}
@@ -190,7 +189,7 @@ void DuckEntity::step(const Level &level) noexcept {
 	// Apply steam jet
 	float total_steam_force = .0f;
 	for (const auto &rp : related_pixels) {
-		auto tag = world.tagOf(rp.x, rp.y);
+		PixelTag tag = world.tagOf(rp.x, rp.y);
 		if (tag.type == PixelType::Steam) {
 			total_steam_force += rp.area * duck_steam_jet_factor;
 		}
@@ -285,7 +284,7 @@ void DuckEntity::step(const Level &level) noexcept {
 	// Apply solid collision correction force
 	float in_solid_area = .0f;
 	for (const auto &rp : related_pixels) {
-		auto tag = world.tagOf(rp.x, rp.y);
+		PixelTag tag = world.tagOf(rp.x, rp.y);
 		if (tag.pclass == PixelClass::Solid && !tag.is_free_falling) {
 			in_solid_area += rp.area;
 		}
@@ -312,7 +311,7 @@ void DuckEntity::step(const Level &level) noexcept {
 	bool cur_colliding = currentlyColliding(level);
 	bool collision_allowed = cur_colliding;
 	bool forced_stop = false;
-	for (auto [tx, ty] : tilesOnSegment({cur_x, cur_y}, {target_x, target_y})) {
+	for (auto [tx, ty] : SegmentTiles({cur_x, cur_y}, {target_x, target_y})) {
 		if (tx == cur_x && ty == cur_y) {
 			continue;
 		}
@@ -391,7 +390,7 @@ void DuckEntity::commitEntityPresence(PixelWorld &world) noexcept {
 						continue;
 					}
 
-					auto &stag = world.staticTagOf(px, py);
+					auto stag = world.staticTagOf(px, py);
 					stag.external_entity_present = true;
 				}
 			}
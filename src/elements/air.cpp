@@ -13,7 +13,7 @@ PixelTag Air::newTag() const noexcept {
 }
 
 PixelElement Air::create() noexcept {
-	return pro::make_proxy_inplace<PixelFacade, Air>();
+	return sharedElement<Air>();
 }
 
 } // namespace wf::element
@@ -15,22 +15,23 @@ PixelTag Copper::newTag() const noexcept {
 }
 
 PixelElement Copper::create() noexcept {
-	return pro::make_proxy_inplace<PixelFacade, Copper>();
+	return sharedElement<Copper>();
 }
 
 void Copper::onCharge(PixelWorld &world, int x, int y) noexcept {
-	auto &tag = world.tagOf(x, y);
+	auto tag = world.tagOf(x, y);
 	if (tag.electric_power == 0) {
 		tag.electric_power = PixelTag::electric_power_max;
 	}
 }
 
 void Copper::step(PixelWorld &world, int x, int y) noexcept {
-	auto my_tag = world.tagOf(x, y);
+	PixelTag my_tag = world.tagOf(x, y);
 	if (my_tag.electric_power == PixelTag::electric_power_max - 1) {
-		std::array<int, 2> world_dim{world.width(), world.height()};
-		for (auto [nx, ny] : neighbors8({x, y}, world_dim)) {
-			world.chargeElement(nx, ny);
+		for (auto [dx, dy] : neighbor8_offsets) {
+			if (world.inBounds(x + dx, y + dy)) {
+				world.chargeElement(x + dx, y + dy);
+			}
 		}
 	}
 
@@ -14,7 +14,7 @@ PixelTag Decoration::newTag() const noexcept {
 }
 
 PixelElement Decoration::create() noexcept {
-	return pro::make_proxy_inplace<PixelFacade, Decoration>();
+	return sharedElement<Decoration>();
 }
 
 } // namespace wf::element
@@ -1,4 +1,7 @@
 #include "wforge/elements.h"
+#include <array>
+#include <cstddef>
+#include <type_traits>
 
 namespace wf {
 
@@ -28,9 +31,78 @@ PixelElement constructElementByType(PixelType type) noexcept {
 	case PixelType::Oil:
 		return element::Oil::create();
 
+	case PixelType::Steam:
+		return element::Steam::create();
+
+	case PixelType::Smoke:
+		return element::Smoke::create();
+
 	default:
 		return element::Decoration::create();
 	}
 }
 
+namespace {
+
+template<typename E>
+constexpr decltype(ElementDispatch::is_asleep) isAsleepOf() noexcept {
+	// Most elements never sleep, skip the call for them
+	if constexpr (std::is_same_v<
+					  decltype(&E::isAsleep),
+					  decltype(&element::EmptySubsElement::isAsleep)>) {
+		return nullptr;
+	} else {
+		return [](const PixelWorld &world, int x, int y, PixelTag tag
+		       ) noexcept {
+			return E{}.isAsleep(world, x, y, tag);
+		};
+	}
+}
+
+template<typename E>
+constexpr ElementDispatch dispatchOf() noexcept {
+	// Elements have no members, any instance will do
+	static_assert(std::is_empty_v<E>);
+	return {
+		.step = [](PixelWorld &world, int x, int y) noexcept {
+			E{}.step(world, x, y);
+		},
+		.on_charge = [](PixelWorld &world, int x, int y) noexcept {
+			E{}.onCharge(world, x, y);
+		},
+		.is_asleep = isAsleepOf<E>(),
+		.is_static = std::is_same_v<
+			decltype(&E::step), decltype(&element::EmptySubsElement::step)>,
+	};
+}
+
+constexpr auto element_dispatch = [] {
+	using namespace element;
+	std::array<ElementDispatch, static_cast<std::size_t>(PixelType::_count)>
+		table{};
+	auto set = [&table](PixelType type, ElementDispatch dispatch) {
+		table[static_cast<std::size_t>(type)] = dispatch;
+	};
+
+	set(PixelType::Smoke, dispatchOf<Smoke>());
+	set(PixelType::Steam, dispatchOf<Steam>());
+	set(PixelType::Air, dispatchOf<Air>());
+	set(PixelType::FluidParticle, dispatchOf<FluidParticle>());
+	set(PixelType::Oil, dispatchOf<Oil>());
+	set(PixelType::Water, dispatchOf<Water>());
+	set(PixelType::Decoration, dispatchOf<Decoration>());
+	set(PixelType::Stone, dispatchOf<Stone>());
+	set(PixelType::Wood, dispatchOf<Wood>());
+	set(PixelType::Copper, dispatchOf<Copper>());
+	set(PixelType::Sand, dispatchOf<Sand>());
+	set(PixelType::Void, dispatchOf<Void>());
+	return table;
+}();
+
+} // namespace
+
+const ElementDispatch &elementDispatchOf(PixelType type) noexcept {
+	return element_dispatch[static_cast<std::size_t>(type)];
+}
+
 } // namespace wf
@@ -2,6 +2,7 @@
 #include "wforge/elements.h"
 #include "wforge/fallsand.h"
 #include "wforge/xoroshiro.h"
+#include <algorithm>
 #include <cmath>
 #include <proxy/v4/proxy.h>
 #include <utility>
@@ -9,14 +10,13 @@
 namespace wf::element {
 
 void FluidElement::step(PixelWorld &world, int x, int y) noexcept {
-	if (y + 1 >= world.height()) {
+	PixelTag below_tag = world.tagOf(x, y + 1);
+	if (below_tag.type == PixelType::Void) {
 		world.replacePixelWithAir(x, y);
 		return;
 	}
 
-	auto &my_tag = world.tagOf(x, y);
-
-	auto below_tag = world.tagOf(x, y + 1);
+	auto my_tag = world.tagOf(x, y);
 	if (below_tag.pclass == PixelClass::Fluid
 	    && isDenser(my_tag.type, below_tag.type)) {
 		world.swapFluids(x, y, x, y + 1);
@@ -26,15 +26,7 @@ void FluidElement::step(PixelWorld &world, int x, int y) noexcept {
 	if (below_tag.pclass == PixelClass::Gas) {
 		if (my_tag.is_free_falling) {
 			// Falling too fast, become particle
-			auto particle = pro::make_proxy<
-				wf::PixelFacade, wf::element::FluidParticle>(
-				0.0f, 1.5f, std::move(world.elementOf(x, y))
-			);
-			auto particle_tag = particle->newTag();
-			particle_tag.color_index = my_tag.color_index;
-			particle_tag.heat = my_tag.heat;
-			particle_tag.thermal_conductivity = my_tag.thermal_conductivity;
-			world.replacePixel(x, y, std::move(particle), particle_tag);
+			FluidParticle::detach(world, x, y, 0.0f, 1.5f);
 		} else {
 			my_tag.is_free_falling = true;
 		}
@@ -52,12 +44,12 @@ void FluidElement::step(PixelWorld &world, int x, int y) noexcept {
 	bool tiny_water_flow = below_tag.pclass == PixelClass::Solid;
 	for (auto d : std::array<int, 2>{my_tag.fluid_dir, -my_tag.fluid_dir}) {
 		int new_x = x + d;
-		if (new_x < 0 || new_x >= world.width()) {
+		PixelTag diag_tag = world.tagOf(new_x, y + 1);
+		if (diag_tag.type == PixelType::Void) {
 			world.replacePixelWithAir(x, y);
 			return;
 		}
 
-		auto diag_tag = world.tagOf(new_x, y + 1);
 		if (diag_tag.pclass == PixelClass::Gas) {
 			my_tag.fluid_dir = d;
 			my_tag.is_free_falling = true;
@@ -72,7 +64,7 @@ void FluidElement::step(PixelWorld &world, int x, int y) noexcept {
 			return;
 		}
 
-		auto side_tag = world.tagOf(new_x, y);
+		PixelTag side_tag = world.tagOf(new_x, y);
 		if (side_tag.pclass == PixelClass::Gas) {
 			my_tag.fluid_dir = d;
 			world.swapPixels(x, y, new_x, y);
@@ -88,10 +80,39 @@ void FluidElement::step(PixelWorld &world, int x, int y) noexcept {
 	my_tag.fluid_dir = 0;
 }
 
-FluidParticle::FluidParticle(
-	float init_vx, float init_vy, PixelElement element
-) noexcept
-	: vx(init_vx), vy(init_vy), element(std::move(element)) {}
+bool FluidElement::isAsleep(
+	const PixelWorld &world, int x, int y, PixelTag tag
+) const noexcept {
+	// Heat turns water into steam and ignites oil. A fluid that moved or
+	// flowed in the last step looks around again.
+	if (tag.heat > 0 || tag.ignited || tag.is_free_falling
+	    || tag.fluid_dir != 0) {
+		return false;
+	}
+
+	// On solid ground it picks up the flow of the fluid next to it, which
+	// changes without waking it
+	const PixelTag below_tag = world.tagOf(x, y + 1);
+	if (below_tag.pclass != PixelClass::Fluid
+	    || isDenser(tag.type, below_tag.type)) {
+		return false;
+	}
+
+	for (int d : {-1, 1}) {
+		const PixelTag diag_tag = world.tagOf(x + d, y + 1);
+		if (diag_tag.type == PixelType::Void
+		    || diag_tag.pclass == PixelClass::Gas
+		    || (diag_tag.pclass == PixelClass::Fluid
+		        && isDenser(tag.type, diag_tag.type))) {
+			return false;
+		}
+
+		if (world.tagOf(x + d, y).pclass == PixelClass::Gas) {
+			return false;
+		}
+	}
+	return true;
+}
 
 PixelTag FluidParticle::newTag() const noexcept {
 	return PixelTag{
@@ -100,38 +121,77 @@ PixelTag FluidParticle::newTag() const noexcept {
 	};
 }
 
+PixelElement FluidParticle::create() noexcept {
+	return sharedElement<FluidParticle>();
+}
+
+void FluidParticle::detach(
+	PixelWorld &world, int x, int y, float init_vx, float init_vy
+) noexcept {
+	PixelTag fluid_tag = world.tagOf(x, y);
+	ElementState state = world.stateOf(x, y);
+	state.vx = init_vx;
+	state.vy = init_vy;
+	state.carried_type = fluid_tag.type;
+
+	auto particle_tag = FluidParticle{}.newTag();
+	particle_tag.color_index = fluid_tag.color_index;
+	particle_tag.heat = fluid_tag.heat;
+	particle_tag.thermal_conductivity = fluid_tag.thermal_conductivity;
+	world.replacePixel(x, y, FluidParticle::create(), particle_tag);
+	world.stateOf(x, y) = state;
+}
+
+namespace {
+
+// Put the fluid carried by a particle with state `carrier` to (x, y)
+void placeCarriedFluid(
+	PixelWorld &world, int x, int y, ElementState carrier
+) noexcept {
+	world.replacePixel(x, y, constructElementByType(carrier.carried_type));
+	world.stateOf(x, y).burn_time_left = carrier.burn_time_left;
+}
+
+} // namespace
+
 constexpr float air_drag = 0.95f;
 constexpr float bounce_back_y2x_factor = 0.2f;
 constexpr float bounce_back_decay = 0.6f;
 
 void FluidParticle::step(PixelWorld &world, int x, int y) noexcept {
-	if (y + 1 >= world.height()) {
+	if (world.typeOfIs(x, y + 1, PixelType::Void)) {
 		world.replacePixelWithAir(x, y);
 		return;
 	}
 
-	auto &my_tag = world.tagOf(x, y);
+	auto my_tag = world.tagOf(x, y);
+	auto &state = world.stateOf(x, y);
+
+	state.vy += PixelWorld::gAcceleration;
+	state.vx *= air_drag;
+	state.vy *= air_drag;
 
-	vy += PixelWorld::gAcceleration;
-	vx *= air_drag;
-	vy *= air_drag;
+	// Moving further would break PixelWorld::max_move_distance
+	constexpr float max_speed = PixelWorld::max_move_distance;
+	state.vx = std::clamp(state.vx, -max_speed, max_speed);
+	state.vy = std::clamp(state.vy, -max_speed, max_speed);
 
-	int target_x = x + std::round(vx);
-	int target_y = y + std::round(vy);
+	int target_x = x + std::round(state.vx);
+	int target_y = y + std::round(state.vy);
 	bool forced_stop = false;
 
 	int to_x = x, to_y = y;
-	for (auto [tx, ty] : tilesOnSegment({x, y}, {target_x, target_y})) {
+	for (auto [tx, ty] : SegmentTiles({x, y}, {target_x, target_y})) {
 		if (tx == x && ty == y) {
 			continue;
 		}
 
-		if (tx < 0 || tx >= world.width() || ty < 0 || ty >= world.height()) {
+		PixelTag tag = world.tagOf(tx, ty);
+		if (tag.type == PixelType::Void) {
 			world.replacePixelWithAir(x, y);
 			return;
 		}
 
-		auto tag = world.tagOf(tx, ty);
 		if (tag.pclass == PixelClass::Solid
 		    || tag.pclass == PixelClass::Fluid) {
 			forced_stop = true;
@@ -144,10 +204,10 @@ void FluidParticle::step(PixelWorld &world, int x, int y) noexcept {
 		}
 	}
 
-	if (vy > 0 && to_y + 1 < world.height()) {
+	if (state.vy > 0 && to_y + 1 < world.height()) {
 		forced_stop |= world.classOfIs(to_x, to_y + 1, PixelClass::Solid);
 		forced_stop |= world.classOfIs(to_x, to_y + 1, PixelClass::Fluid);
-	} else if (vy < 0 && to_y - 1 >= 0) {
+	} else if (state.vy < 0 && to_y - 1 >= 0) {
 		forced_stop |= world.classOfIs(to_x, to_y - 1, PixelClass::Solid);
 		forced_stop |= world.classOfIs(to_x, to_y - 1, PixelClass::Fluid);
 	}
@@ -160,63 +220,58 @@ void FluidParticle::step(PixelWorld &world, int x, int y) noexcept {
 
 		bool free_dir[2] = {false, false};
 		for (int d : {-1, 1}) {
-			int side_x = to_x + d;
-			if (side_x < 0 || side_x >= world.width()) {
-				free_dir[(d + 1) / 2] = true;
-				continue;
-			}
-
-			auto side_tag = world.tagOf(side_x, to_y);
-			free_dir[(d + 1) / 2]
-				= (side_tag.pclass != PixelClass::Solid
-			       && side_tag.pclass != PixelClass::Fluid);
+			PixelTag side_tag = world.tagOf(to_x + d, to_y);
+			free_dir[(d + 1) / 2] = side_tag.type == PixelType::Void
+				|| (side_tag.pclass != PixelClass::Solid
+			        && side_tag.pclass != PixelClass::Fluid);
 		}
 
-		vx *= bounce_back_decay;
-		if (std::abs(vx) < 0.01f) {
+		state.vx *= bounce_back_decay;
+		if (std::abs(state.vx) < 0.01f) {
 			int rand_dir = (Xoroshiro128PP::globalInstance().next() % 2 == 0)
 				? -1
 				: 1;
 			for (int d : {rand_dir, -rand_dir}) {
 				if (free_dir[(d + 1) / 2]) {
-					vx = d * std::abs(vy) * bounce_back_y2x_factor;
+					state.vx = d * std::abs(state.vy) * bounce_back_y2x_factor;
 					break;
 				}
 			}
-		} else if (vx < 0) {
-			vx -= vy * bounce_back_y2x_factor;
+		} else if (state.vx < 0) {
+			state.vx -= state.vy * bounce_back_y2x_factor;
 			if (!free_dir[0]) {
 				if (free_dir[1]) {
-					vx = -vx * bounce_back_decay;
+					state.vx = -state.vx * bounce_back_decay;
 				} else {
-					vx = 0;
+					state.vx = 0;
 				}
 			}
-		} else if (vx > 0) {
-			vx += vy * bounce_back_y2x_factor;
+		} else if (state.vx > 0) {
+			state.vx += state.vy * bounce_back_y2x_factor;
 			if (!free_dir[1]) {
 				if (free_dir[0]) {
-					vx = -vx * bounce_back_decay;
+					state.vx = -state.vx * bounce_back_decay;
 				} else {
-					vx = 0;
+					state.vx = 0;
 				}
 			}
 		}
 
-		vy *= -bounce_back_y2x_factor;
+		state.vy *= -bounce_back_y2x_factor;
 
-		if (std::abs(vy) > 1.0f && std::abs(vx) > 0.01f) {
-			auto &below_tag = world.tagOf(to_x, to_y + 1);
+		if (std::abs(state.vy) > 1.0f && std::abs(state.vx) > 0.01f) {
+			auto below_tag = world.tagOf(to_x, to_y + 1);
 			if (below_tag.pclass == PixelClass::Fluid
 			    && !below_tag.is_free_falling) {
 				my_tag.color_index = below_tag.color_index;
 				int kept_fdir = below_tag.fluid_dir;
-				PixelElement new_fluid = std::move(
-					world.elementOf(to_x, to_y + 1)
-				);
-				world.replacePixel(to_x, to_y + 1, std::move(element));
+				const auto &below_state = world.stateOf(to_x, to_y + 1);
+				PixelType new_carried_type = below_tag.type;
+				auto new_burn_time = below_state.burn_time_left;
+				placeCarriedFluid(world, to_x, to_y + 1, state);
 				below_tag.fluid_dir = kept_fdir;
-				element = std::move(new_fluid);
+				state.carried_type = new_carried_type;
+				state.burn_time_left = new_burn_time;
 			}
 		}
 	}
@@ -226,17 +281,17 @@ void FluidParticle::step(PixelWorld &world, int x, int y) noexcept {
 		return;
 	}
 
-	if (vx * vx + vy * vy < 2) {
+	if (state.vx * state.vx + state.vy * state.vy < 2) {
 		int dir = 0;
-		if (std::abs(vx) < 0.01) {
+		if (std::abs(state.vx) < 0.01) {
 			dir = 0;
-		} else if (vx < 0) {
+		} else if (state.vx < 0) {
 			dir = -1;
 		} else {
 			dir = 1;
 		}
 		int old_heat = my_tag.heat;
-		world.replacePixel(x, y, std::move(element));
+		placeCarriedFluid(world, x, y, state);
 		world.tagOf(x, y).fluid_dir = dir;
 		world.tagOf(x, y).heat = old_heat;
 		return;
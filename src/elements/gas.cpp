@@ -18,20 +18,20 @@ bool canSwapTag(PixelTag target, PixelTag self) {
 } // namespace
 
 void GasElement::step(PixelWorld &world, int x, int y) noexcept {
-	if (y == 0) {
+	PixelTag above_tag = world.tagOf(x, y - 1);
+	if (above_tag.type == PixelType::Void) {
 		world.replacePixelWithAir(x, y);
 		return;
 	}
 
 	auto &rng = Xoroshiro128PP::globalInstance();
-	auto &my_tag = world.tagOf(x, y);
+	auto my_tag = world.tagOf(x, y);
 
 	// Try to move diagonally up
 	int dir = (rng() % 2) * 2 - 1; // -1 or +1
 
-	if (x + dir >= 0 && x + dir < world.width()
-	    && (rng() % 100 < gas_go_diag_chance)) {
-		auto step1_diag_tag = world.tagOf(x + dir, y - 1);
+	if (rng() % 100 < gas_go_diag_chance) {
+		PixelTag step1_diag_tag = world.tagOf(x + dir, y - 1);
 		if (canSwapTag(step1_diag_tag, my_tag)) {
 			world.swapPixels(x, y, x + dir, y - 1);
 			return;
@@ -39,7 +39,6 @@ void GasElement::step(PixelWorld &world, int x, int y) noexcept {
 	}
 
 	// Try to move up
-	auto above_tag = world.tagOf(x, y - 1);
 	if (canSwapTag(above_tag, my_tag)) {
 		world.swapPixels(x, y, x, y - 1);
 		return;
@@ -48,13 +47,13 @@ void GasElement::step(PixelWorld &world, int x, int y) noexcept {
 	int to_x = x, to_y = y;
 	for (int i = 1; i <= gas_dispersion_rate; ++i) {
 		int dx = dir * i;
-		if (x + dx < 0 || x + dx >= world.width()) {
+		PixelTag side_tag = world.tagOf(x + dx, y);
+		if (side_tag.type == PixelType::Void) {
 			world.replacePixelWithAir(x, y);
 			return;
 		}
 
-		auto diag_tag = world.tagOf(x + dx, y - 1);
-		auto side_tag = world.tagOf(x + dx, y);
+		PixelTag diag_tag = world.tagOf(x + dx, y - 1);
 
 		if (side_tag.pclass == PixelClass::Solid) {
 			break;
@@ -8,13 +8,17 @@
 
 namespace wf::element {
 
-Oil::Oil() noexcept {
+ElementState Oil::newState() const noexcept {
 	constexpr unsigned int burn_duration = 48;
 	constexpr unsigned int burn_dur_variance = 12;
 
 	auto &rng = Xoroshiro128PP::globalInstance();
 	std::binomial_distribution<> burn_dur_dist(burn_dur_variance * 2, 0.5);
-	burn_time_left = burn_duration - burn_dur_variance + burn_dur_dist(rng);
+	return ElementState{
+		.burn_time_left = static_cast<std::int16_t>(
+			burn_duration - burn_dur_variance + burn_dur_dist(rng)
+		),
+	};
 }
 
 PixelTag Oil::newTag() const noexcept {
@@ -34,7 +38,7 @@ void Oil::step(PixelWorld &world, int x, int y) noexcept {
 	constexpr unsigned int die_smoke_chance = 25;   // %
 	constexpr unsigned int random_smoke_chance = 3; // %
 
-	auto &my_tag = world.tagOf(x, y);
+	auto my_tag = world.tagOf(x, y);
 	if (my_tag.heat >= ignite_heat_threshold) {
 		my_tag.ignited = true;
 	}
@@ -44,14 +48,18 @@ void Oil::step(PixelWorld &world, int x, int y) noexcept {
 	}
 
 	if (my_tag.ignited) {
+		auto &burn_time_left = world.stateOf(x, y).burn_time_left;
 		burn_time_left -= 1;
 		int next_heat = std::min(
 			PixelTag::heat_max, my_tag.heat + produced_fire_heat
 		);
 
-		for (auto [nx, ny] :
-		     neighbors4({x, y}, {world.width(), world.height()})) {
-			auto &neighbor_tag = world.tagOf(nx, ny);
+		for (auto [dx, dy] : neighbor4_offsets) {
+			if (!world.inBounds(x + dx, y + dy)) {
+				continue;
+			}
+
+			auto neighbor_tag = world.tagOf(x + dx, y + dy);
 			neighbor_tag.heat = std::min(
 				PixelTag::heat_max,
 				neighbor_tag.heat + produced_fire_heat_to_neighbors
@@ -61,7 +69,7 @@ void Oil::step(PixelWorld &world, int x, int y) noexcept {
 		auto &rng = Xoroshiro128PP::globalInstance();
 		if (burn_time_left <= 0) {
 			if (rng.next() % 100 < die_smoke_chance) {
-				world.replacePixel(x, y, pro::make_proxy<PixelFacade, Smoke>());
+				world.replacePixel(x, y, Smoke::create());
 			} else {
 				world.replacePixelWithAir(x, y);
 			}
@@ -71,12 +79,10 @@ void Oil::step(PixelWorld &world, int x, int y) noexcept {
 		my_tag.heat = next_heat;
 
 		if (y > 0) {
-			auto &above_tag = world.tagOf(x, y - 1);
+			auto above_tag = world.tagOf(x, y - 1);
 			if (above_tag.type == PixelType::Air) {
 				if (rng.next() % 100 < random_smoke_chance) {
-					world.replacePixel(
-						x, y - 1, pro::make_proxy<PixelFacade, Smoke>()
-					);
+					world.replacePixel(x, y - 1, Smoke::create());
 					above_tag.heat = smoke_heat;
 				}
 			}
@@ -86,7 +92,7 @@ void Oil::step(PixelWorld &world, int x, int y) noexcept {
 }
 
 PixelElement Oil::create() noexcept {
-	return pro::make_proxy<PixelFacade, Oil>();
+	return sharedElement<Oil>();
 }
 
 } // namespace wf::element
@@ -3,6 +3,7 @@
 #include "wforge/elements.h"
 #include "wforge/fallsand.h"
 #include "wforge/xoroshiro.h"
+#include <algorithm>
 #include <cmath>
 #include <random>
 
@@ -38,35 +39,41 @@ constexpr float sand_mass = 3.0f;
 } // namespace
 
 void Sand::step(PixelWorld &world, int x, int y) noexcept {
-	if (y + 1 >= world.height()) {
+	PixelTag below_tag = world.tagOf(x, y + 1);
+	if (below_tag.type == PixelType::Void) {
 		// at bottom edge, remove sand
 		world.replacePixelWithAir(x, y);
 		return;
 	}
 
-	auto &my_tag = world.tagOf(x, y);
+	auto my_tag = world.tagOf(x, y);
+	auto &state = world.stateOf(x, y);
 
-	vy += PixelWorld::gAcceleration;
+	state.vy += PixelWorld::gAcceleration;
 
-	auto below_tag = world.tagOf(x, y + 1);
 	if (below_tag.pclass == PixelClass::Solid) {
 		// Is on ground. Apply friction
-		vx *= sandFriction;
-		vy = std::min(0.0f, vy);
+		state.vx *= sandFriction;
+		state.vy = std::min(0.0f, state.vy);
 	} else if (below_tag.pclass == PixelClass::Fluid) {
-		vx *= waterDrag;
-		vy *= waterDrag;
+		state.vx *= waterDrag;
+		state.vy *= waterDrag;
 		my_tag.is_free_falling = true;
 	} else {
-		vx *= airDrag;
-		vy *= airDrag;
+		state.vx *= airDrag;
+		state.vy *= airDrag;
 		my_tag.is_free_falling = true;
 	}
 
+	// Moving further would break PixelWorld::max_move_distance
+	constexpr float max_speed = PixelWorld::max_move_distance;
+	state.vx = std::clamp(state.vx, -max_speed, max_speed);
+	state.vy = std::clamp(state.vy, -max_speed, max_speed);
+
 	auto rng = Xoroshiro128PP::globalInstance();
 
-	int target_x = x + std::round(vx);
-	int target_y = y + std::round(vy);
+	int target_x = x + std::round(state.vx);
+	int target_y = y + std::round(state.vy);
 	if (target_x == x && target_y == y && my_tag.is_free_falling) {
 		// Consider diagonal swap
 		if (below_tag.pclass != PixelClass::Solid) {
@@ -75,33 +82,35 @@ void Sand::step(PixelWorld &world, int x, int y) noexcept {
 		int rand_dir = (rng.next() % 2 == 0) ? -1 : 1;
 		for (int d : {rand_dir, -rand_dir}) {
 			int new_x = x + d;
-			if (new_x < 0 || new_x >= world.width()) {
+			PixelTag diag_tag = world.tagOf(new_x, y + 1);
+			if (diag_tag.type == PixelType::Void) {
 				world.replacePixelWithAir(x, y);
 				return;
 			}
 
-			auto diag_tag = world.tagOf(new_x, y + 1);
 			if (isSwappaleTag(diag_tag)) {
 				world.swapPixels(x, y, new_x, y + 1);
 				return;
 			}
 		}
+		// At rest, what is left of the velocity would only decay
 		my_tag.is_free_falling = false;
+		state.vx = 0;
+		state.vy = 0;
 		return;
 	}
 
 	auto to_x = x, to_y = y;
 	bool forced_stop = false;
-	const std::array<int, 2> world_dim = {world.width(), world.height()};
 	std::uniform_int_distribution<int> inertial_dist(0, inertialResistance - 1);
-	for (auto [tx, ty] : tilesOnSegment({x, y}, {target_x, target_y})) {
-		if (tx < 0 || tx >= world.width() || ty < 0 || ty >= world.height()) {
+	for (auto [tx, ty] : SegmentTiles({x, y}, {target_x, target_y})) {
+		PixelTag target_tag = world.tagOf(tx, ty);
+		if (target_tag.type == PixelType::Void) {
 			// Out of bounds
 			world.replacePixelWithAir(x, y);
 			return;
 		}
 
-		auto target_tag = world.tagOf(tx, ty);
 		if ((tx != x || ty != y) && !isSwappaleTag(target_tag)) {
 			// Can't move further? Stop here
 			forced_stop = true;
@@ -111,23 +120,26 @@ void Sand::step(PixelWorld &world, int x, int y) noexcept {
 		to_x = tx;
 		to_y = ty;
 		if (my_tag.is_free_falling) {
-			for (auto [nx, ny] : neighbors4({tx, ty}, world_dim)) {
-				if (inertial_dist(rng) == 0) {
+			for (auto [dx, dy] : neighbor4_offsets) {
+				int nx = tx + dx;
+				int ny = ty + dy;
+				if (!world.inBounds(nx, ny) || inertial_dist(rng) == 0) {
 					continue;
 				}
 				world.tagOf(nx, ny).is_free_falling = true;
+				world.markActive(nx, ny);
 			}
 		}
 	}
 
-	if (vy > 0 && to_y + 1 < world.height()) {
-		auto below_tag_after = world.tagOf(to_x, to_y + 1);
+	if (state.vy > 0 && to_y + 1 < world.height()) {
+		PixelTag below_tag_after = world.tagOf(to_x, to_y + 1);
 		if (below_tag_after.pclass == PixelClass::Solid
 		    && !below_tag_after.is_free_falling) {
 			forced_stop = true;
 		}
-	} else if (vy < 0 && to_y - 1 >= 0) {
-		auto above_tag = world.tagOf(to_x, to_y - 1);
+	} else if (state.vy < 0 && to_y - 1 >= 0) {
+		PixelTag above_tag = world.tagOf(to_x, to_y - 1);
 		if (above_tag.pclass == PixelClass::Solid) {
 			forced_stop = true;
 		}
@@ -136,44 +148,39 @@ void Sand::step(PixelWorld &world, int x, int y) noexcept {
 	if (forced_stop) {
 		bool freeDir[2] = {false, false};
 		for (int d : {-1, 1}) {
-			int side_x = to_x + d;
-			if (side_x < 0 || side_x >= world.width()) {
-				freeDir[(d + 1) / 2] = true;
-				continue;
-			}
-
-			auto side_tag = world.tagOf(side_x, to_y);
-			freeDir[(d + 1) / 2] = (side_tag.pclass != PixelClass::Solid);
+			PixelTag side_tag = world.tagOf(to_x + d, to_y);
+			freeDir[(d + 1) / 2] = side_tag.type == PixelType::Void
+				|| side_tag.pclass != PixelClass::Solid;
 		}
 
-		if (std::abs(vx) < 0.01f) {
+		if (std::abs(state.vx) < 0.01f) {
 			int rand_dir = (rng.next() % 2 == 0) ? -1 : 1;
 			for (int d : {rand_dir, -rand_dir}) {
 				if (freeDir[(d + 1) / 2]) {
-					vx = d * std::abs(vy) * bounceBackXFactor;
+					state.vx = d * std::abs(state.vy) * bounceBackXFactor;
 					break;
 				}
 			}
-		} else if (vx < 0) {
-			vx -= vy * bounceBackXFactor;
+		} else if (state.vx < 0) {
+			state.vx -= state.vy * bounceBackXFactor;
 			if (!freeDir[0]) {
 				if (freeDir[1]) {
-					vx = -vx * bounceBackXFactor;
+					state.vx = -state.vx * bounceBackXFactor;
 				} else {
-					vx = 0;
+					state.vx = 0;
 				}
 			}
-		} else if (vx > 0) {
-			vx += vy * bounceBackXFactor;
+		} else if (state.vx > 0) {
+			state.vx += state.vy * bounceBackXFactor;
 			if (!freeDir[1]) {
 				if (freeDir[0]) {
-					vx = -vx * bounceBackXFactor;
+					state.vx = -state.vx * bounceBackXFactor;
 				} else {
-					vx = 0;
+					state.vx = 0;
 				}
 			}
 		}
-		vy *= -bounceBackYFactor;
+		state.vy *= -bounceBackYFactor;
 	}
 
 	if (to_x != x || to_y != y) {
@@ -184,8 +191,18 @@ void Sand::step(PixelWorld &world, int x, int y) noexcept {
 	SolidElement::step(world, x, y);
 }
 
+bool Sand::isAsleep(
+	const PixelWorld &world, int x, int y, PixelTag tag
+) const noexcept {
+	// Its velocity was cleared when it came to rest, so step() would only
+	// check the ground below it
+	const PixelTag below_tag = world.tagOf(x, y + 1);
+	return !tag.is_free_falling && below_tag.pclass == PixelClass::Solid
+		&& below_tag.type != PixelType::Void;
+}
+
 PixelElement Sand::create() noexcept {
-	return pro::make_proxy<PixelFacade, Sand>();
+	return sharedElement<Sand>();
 }
 
 } // namespace wf::element
@@ -19,7 +19,7 @@ PixelTag Smoke::newTag() const noexcept {
 void Smoke::step(PixelWorld &world, int x, int y) noexcept {
 	constexpr unsigned int smoke_disappear_heat_threshold = 6;
 
-	auto &my_tag = world.tagOf(x, y);
+	auto my_tag = world.tagOf(x, y);
 	if (my_tag.heat <= smoke_disappear_heat_threshold) {
 		int old_heat = my_tag.heat;
 		world.replacePixelWithAir(x, y);
@@ -29,4 +29,8 @@ void Smoke::step(PixelWorld &world, int x, int y) noexcept {
 	GasElement::step(world, x, y);
 }
 
+PixelElement Smoke::create() noexcept {
+	return sharedElement<Smoke>();
+}
+
 } // namespace wf::element
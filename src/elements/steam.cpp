@@ -19,14 +19,18 @@ PixelTag Steam::newTag() const noexcept {
 void Steam::step(PixelWorld &world, int x, int y) noexcept {
 	constexpr unsigned int steam_condensation_heat_threshold = 10;
 
-	auto &my_tag = world.tagOf(x, y);
+	auto my_tag = world.tagOf(x, y);
 	if (my_tag.heat <= steam_condensation_heat_threshold) {
 		int old_heat = my_tag.heat;
-		world.replacePixel(x, y, pro::make_proxy<PixelFacade, Water>());
+		world.replacePixel(x, y, Water::create());
 		my_tag.heat = old_heat;
 		return;
 	}
 	GasElement::step(world, x, y);
 }
 
+PixelElement Steam::create() noexcept {
+	return sharedElement<Steam>();
+}
+
 } // namespace wf::element
@@ -15,7 +15,7 @@ PixelTag Stone::newTag() const noexcept {
 }
 
 PixelElement Stone::create() noexcept {
-	return pro::make_proxy_inplace<PixelFacade, Stone>();
+	return sharedElement<Stone>();
 }
 
 } // namespace wf::element
\ No newline at end of file
@@ -0,0 +1,19 @@
+#include "wforge/elements.h"
+#include "wforge/fallsand.h"
+
+namespace wf::element {
+
+PixelTag Void::newTag() const noexcept {
+	// Never rendered, and no heat flows into it
+	return PixelTag{
+		.type = PixelType::Void,
+		.pclass = PixelClass::Solid,
+		.thermal_conductivity = 0,
+	};
+}
+
+PixelElement Void::create() noexcept {
+	return sharedElement<Void>();
+}
+
+} // namespace wf::element
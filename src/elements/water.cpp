@@ -16,10 +16,10 @@ PixelTag Water::newTag() const noexcept {
 void Water::step(PixelWorld &world, int x, int y) noexcept {
 	constexpr int water_vaporization_heat_threshold = 30;
 
-	auto &my_tag = world.tagOf(x, y);
+	auto my_tag = world.tagOf(x, y);
 	if (my_tag.heat >= water_vaporization_heat_threshold) {
 		int old_heat = my_tag.heat;
-		world.replacePixel(x, y, pro::make_proxy<PixelFacade, Steam>());
+		world.replacePixel(x, y, Steam::create());
 		my_tag.heat = old_heat;
 		return;
 	}
@@ -28,7 +28,7 @@ void Water::step(PixelWorld &world, int x, int y) noexcept {
 }
 
 PixelElement Water::create() noexcept {
-	return pro::make_proxy<PixelFacade, Water>();
+	return sharedElement<Water>();
 }
 
 } // namespace wf::element
@@ -7,13 +7,17 @@
 
 namespace wf::element {
 
-Wood::Wood() noexcept {
+ElementState Wood::newState() const noexcept {
 	constexpr unsigned int burn_duration = 96;
 	constexpr unsigned int burn_dur_variance = 24;
 
 	auto &rng = Xoroshiro128PP::globalInstance();
 	std::binomial_distribution<> burn_dur_dist(burn_dur_variance * 2, 0.5);
-	burn_time_left = burn_duration - burn_dur_variance + burn_dur_dist(rng);
+	return ElementState{
+		.burn_time_left = static_cast<std::int16_t>(
+			burn_duration - burn_dur_variance + burn_dur_dist(rng)
+		),
+	};
 }
 
 PixelTag Wood::newTag() const noexcept {
@@ -27,7 +31,7 @@ PixelTag Wood::newTag() const noexcept {
 }
 
 PixelElement Wood::create() noexcept {
-	return pro::make_proxy_inplace<PixelFacade, Wood>();
+	return sharedElement<Wood>();
 }
 
 void Wood::step(PixelWorld &world, int x, int y) noexcept {
@@ -40,7 +44,7 @@ void Wood::step(PixelWorld &world, int x, int y) noexcept {
 	constexpr unsigned int ignition_chance = 10;    // %
 
 	auto &rng = Xoroshiro128PP::globalInstance();
-	auto &my_tag = world.tagOf(x, y);
+	auto my_tag = world.tagOf(x, y);
 	if (!my_tag.ignited && my_tag.heat >= ignition_heat_threshold) {
 		if (rng.next() % 100 < ignition_chance) {
 			my_tag.ignited = true;
@@ -48,14 +52,18 @@ void Wood::step(PixelWorld &world, int x, int y) noexcept {
 	}
 
 	if (my_tag.ignited) {
+		auto &burn_time_left = world.stateOf(x, y).burn_time_left;
 		burn_time_left -= 1;
 		my_tag.heat = std::min(
 			PixelTag::heat_max, my_tag.heat + produced_fire_heat
 		);
 
-		for (auto [nx, ny] :
-		     neighbors4({x, y}, {world.width(), world.height()})) {
-			auto &neighbor_tag = world.tagOf(nx, ny);
+		for (auto [dx, dy] : neighbor4_offsets) {
+			if (!world.inBounds(x + dx, y + dy)) {
+				continue;
+			}
+
+			auto neighbor_tag = world.tagOf(x + dx, y + dy);
 			neighbor_tag.heat = std::min(
 				PixelTag::heat_max,
 				neighbor_tag.heat + produced_fire_heat_to_neighbors
@@ -64,7 +72,7 @@ void Wood::step(PixelWorld &world, int x, int y) noexcept {
 
 		if (burn_time_left <= 0) {
 			if (rng.next() % 100 < die_smoke_chance) {
-				world.replacePixel(x, y, pro::make_proxy<PixelFacade, Smoke>());
+				world.replacePixel(x, y, Smoke::create());
 			} else {
 				world.replacePixelWithAir(x, y);
 			}
@@ -72,12 +80,10 @@ void Wood::step(PixelWorld &world, int x, int y) noexcept {
 		}
 
 		if (y > 0) {
-			auto &above_tag = world.tagOf(x, y - 1);
+			auto above_tag = world.tagOf(x, y - 1);
 			if (above_tag.type == PixelType::Air) {
 				if (rng.next() % 100 < random_smoke_chance) {
-					world.replacePixel(
-						x, y - 1, pro::make_proxy<PixelFacade, Smoke>()
-					);
+					world.replacePixel(x, y - 1, Smoke::create());
 					above_tag.heat = smoke_heat;
 				}
 			}
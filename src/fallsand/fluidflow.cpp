@@ -6,6 +6,7 @@
 #include <iterator>
 #include <limits>
 #include <map>
+#include <memory>
 #include <queue>
 #include <utility>
 #include <vector>
@@ -42,7 +43,7 @@ struct CachedPixel {
 	PixelType type : 8;
 	unsigned int color_index : 8;
 	bool ignited : 1;
-	PixelElement element;
+	ElementState state;
 };
 
 struct Vertex {
@@ -59,14 +60,65 @@ struct ConnectedComponent {
 	FrameVector<int> vertices;
 };
 
+constexpr int tile_size = PixelTile::size;
+
 struct AnalysisContext {
 	FrameVector<Vertex> vertices;
 	FrameMap<std::pair<int, int>, int> edge_idx_map;
-	FrameVector<int> pixel_vid;
 	FrameVector<ConnectedComponent> components;
 
-	AnalysisContext(int width, int height) noexcept
-		: pixel_vid(width * height, -1) {}
+	// Columns of the tiles holding any fluid, per row of tiles. Fluids are
+	// only moved around by the passes before applyFlowResults(), so the
+	// list holds until then.
+	FrameVector<FrameVector<int>> fluid_tiles;
+
+	// Vertex of the pixels of each tile, allocated for tiles holding fluid
+	int tiles_x;
+	FrameVector<std::unique_ptr<std::array<int, PixelTile::area>>> tile_vids;
+
+	AnalysisContext(const PixelWorld &world) noexcept
+		: fluid_tiles(world.tilesY())
+		, tiles_x(world.tilesX())
+		, tile_vids(world.tilesX() * world.tilesY()) {
+		for (int ty = 0; ty < world.tilesY(); ++ty) {
+			for (int tx = 0; tx < world.tilesX(); ++tx) {
+				if (!world.isTileUniform(tx, ty) && !world.isTilePaged(tx, ty)
+				    && world.tileAt(tx, ty).hasClass(PixelClass::Fluid)) {
+					fluid_tiles[ty].push_back(tx);
+				}
+			}
+		}
+	}
+
+	// -1 for pixels of no vertex, (x, y) must be in the world
+	int vidOf(int x, int y) const noexcept {
+		const auto &vids = tile_vids[(y / tile_size) * tiles_x + x / tile_size];
+		if (!vids) {
+			return -1;
+		}
+		return (*vids)[PixelTile::indexOf(x % tile_size, y % tile_size)];
+	}
+
+	void setVid(int x, int y, int vid) {
+		auto &vids = tile_vids[(y / tile_size) * tiles_x + x / tile_size];
+		if (!vids) {
+			vids = std::make_unique<std::array<int, PixelTile::area>>();
+			vids->fill(-1);
+		}
+		(*vids)[PixelTile::indexOf(x % tile_size, y % tile_size)] = vid;
+	}
+
+	// Calls f(x) for the pixels of row y within the tiles holding fluid,
+	// left to right
+	template<typename F>
+	void forFluidPixelsOfRow(const PixelWorld &world, int y, F &&f) const {
+		for (int tx : fluid_tiles[y / tile_size]) {
+			const int x1 = std::min((tx + 1) * tile_size, world.width());
+			for (int x = tx * tile_size; x < x1; ++x) {
+				f(x);
+			}
+		}
+	}
 
 	int touchEdge(int u, int v) {
 		auto it = edge_idx_map.find({u, v});
@@ -118,25 +170,44 @@ constexpr float surface_adjust_factor = 0.7;
 constexpr int source_vid = 0;
 constexpr int sink_vid = 1;
 
-void densityAnalysisStep(PixelWorld &world) noexcept {
+void densityAnalysisStep(PixelWorld &world, AnalysisContext &ctx) noexcept {
 	const int effective_infinity_of_x = world.width() + 10;
 
+	// Reads go through view, so that the tiles around the fluids stay
+	// shared
+	const PixelWorld &view = world;
 	for (int y = world.height() - 2; y >= 0; --y) {
 		std::vector<std::pair<int, int>> active_intervals; // [l, r]
 
-		for (int l = 0, r = 0; r < world.width(); ++r) {
-			auto tag = world.tagOf(r, y);
-
-			if (tag.pclass == PixelClass::Fluid && r + 1 < world.width()) {
-				continue;
+		// Runs of fluid never leave the spans of adjacent fluid tiles
+		const auto &fluid_tiles = ctx.fluid_tiles[y / tile_size];
+		for (std::size_t k = 0; k < fluid_tiles.size();) {
+			std::size_t span_end = k + 1;
+			while (span_end < fluid_tiles.size()
+			       && fluid_tiles[span_end] == fluid_tiles[span_end - 1] + 1) {
+				span_end += 1;
 			}
 
-			if (r > l) {
-				active_intervals.emplace_back(
-					l, tag.pclass == PixelClass::Fluid ? r : r - 1
-				);
+			const int x0 = fluid_tiles[k] * tile_size;
+			const int x1 = std::min(
+				fluid_tiles[span_end - 1] * tile_size + tile_size, world.width()
+			);
+			k = span_end;
+
+			for (int l = x0, r = x0; r < x1; ++r) {
+				PixelTag tag = view.tagOf(r, y);
+
+				if (tag.pclass == PixelClass::Fluid && r + 1 < x1) {
+					continue;
+				}
+
+				if (r > l) {
+					active_intervals.emplace_back(
+						l, tag.pclass == PixelClass::Fluid ? r : r - 1
+					);
+				}
+				l = r + 1;
 			}
-			l = r + 1;
 		}
 
 		for (auto [l, r] : active_intervals) {
@@ -147,7 +218,7 @@ void densityAnalysisStep(PixelWorld &world) noexcept {
 			std::vector<int> fill_pos;
 			PixelType fill_type = PixelType::Air;
 			for (int x = l; x <= r; ++x) {
-				auto tag = world.tagOf(x, y + 1);
+				PixelTag tag = view.tagOf(x, y + 1);
 				if (tag.pclass != PixelClass::Fluid) {
 					continue;
 				}
@@ -180,7 +251,7 @@ void densityAnalysisStep(PixelWorld &world) noexcept {
 					left_pos.push_back(x);
 				}
 
-				if (isDenserOrEqual(fill_type, world.tagOf(x, y).type)) {
+				if (isDenserOrEqual(fill_type, view.tagOf(x, y).type)) {
 					continue;
 				}
 
@@ -222,38 +293,31 @@ void densityAnalysisStep(PixelWorld &world) noexcept {
 }
 
 void searchConnected(
-	PixelWorld &world, AnalysisContext &ctx, int vid, int sx, int sy,
+	const PixelWorld &world, AnalysisContext &ctx, int vid, int sx, int sy,
 	PixelType ptype
 ) noexcept {
 	constexpr int dx[] = {-1, 1, 0, 0};
 	constexpr int dy[] = {0, 0, -1, 1};
 
-	auto &vtx = ctx.vertices[vid];
-	int width = world.width();
-
 	FrameVector<Coord> stack;
 	stack.push_back({sx, sy});
 	while (!stack.empty()) {
 		auto [x, y] = stack.back();
 		stack.pop_back();
 
-		auto &tag = world.tagOf(x, y);
-		if (tag.dirty) {
+		if (ctx.vidOf(x, y) != -1) {
 			continue;
 		}
 
-		tag.dirty = true;
-		ctx.pixel_vid[y * width + x] = vid;
+		ctx.setVid(x, y, vid);
 
 		for (int i = 0; i < 4; ++i) {
 			int nx = x + dx[i];
 			int ny = y + dy[i];
-			if (!world.inBounds(nx, ny)) {
-				continue;
-			}
 
-			auto ntag = world.tagOf(nx, ny);
-			if (ntag.type != ptype || ntag.dirty) {
+			// Never Void, so the search stays inside the world
+			PixelTag ntag = world.tagOf(nx, ny);
+			if (ntag.type != ptype || ctx.vidOf(nx, ny) != -1) {
 				continue;
 			}
 
@@ -262,7 +326,7 @@ void searchConnected(
 	}
 }
 
-void buildNetwork(PixelWorld &world, AnalysisContext &ctx) noexcept {
+void buildNetwork(const PixelWorld &world, AnalysisContext &ctx) noexcept {
 	// Reserve 2 vertices for source and sink
 	ctx.vertices.push_back({
 		.id = 0,
@@ -274,11 +338,13 @@ void buildNetwork(PixelWorld &world, AnalysisContext &ctx) noexcept {
 		.type = PixelType::Air,
 	});
 
+	// Only the tiles holding fluid have vertices, in the same row-major
+	// order as a scan of the whole world
 	for (int y = 0; y < world.height(); ++y) {
-		for (int x = 0; x < world.width(); ++x) {
-			auto tag = world.tagOf(x, y);
-			if (tag.pclass != PixelClass::Fluid || tag.dirty) {
-				continue;
+		ctx.forFluidPixelsOfRow(world, y, [&](int x) {
+			PixelTag tag = world.tagOf(x, y);
+			if (tag.pclass != PixelClass::Fluid || ctx.vidOf(x, y) != -1) {
+				return;
 			}
 
 			int vid = ctx.vertices.size();
@@ -288,34 +354,34 @@ void buildNetwork(PixelWorld &world, AnalysisContext &ctx) noexcept {
 			});
 
 			searchConnected(world, ctx, vid, x, y, tag.type);
-		}
+		});
 	}
 
 	for (int y = 0; y < world.height() - 1; ++y) {
-		for (int x = 0; x < world.width(); ++x) {
-			int u = ctx.pixel_vid[y * world.width() + x];
-			int v = ctx.pixel_vid[(y + 1) * world.width() + x];
+		ctx.forFluidPixelsOfRow(world, y, [&](int x) {
+			int u = ctx.vidOf(x, y);
+			int v = ctx.vidOf(x, y + 1);
 			if (u == -1 || v == -1 || u == v) {
-				continue;
+				return;
 			}
 
 			ctx.touchEdge(u, v);
 			ctx.incFlow(u, v, x, y);
-		}
+		});
 	}
 
 	// Compute air surfaces
 	for (int y = 0; y < world.height(); ++y) {
-		for (int x = 0; x < world.width(); ++x) {
-			int vid = ctx.pixel_vid[y * world.width() + x];
+		ctx.forFluidPixelsOfRow(world, y, [&](int x) {
+			int vid = ctx.vidOf(x, y);
 			if (vid == -1) {
-				continue;
+				return;
 			}
 
 			if (y == 0 || world.typeOfIs(x, y - 1, PixelType::Air)) {
 				ctx.vertices[vid].air_surface.push_back({x, y});
 			}
-		}
+		});
 	}
 }
 
@@ -358,7 +424,6 @@ void calculateGraphConnectedComponents(AnalysisContext &ctx) noexcept {
 bool prepareFlowNetworkOfComponent(
 	const PixelWorld &world, AnalysisContext &ctx, int cid
 ) noexcept {
-	int width = world.width(), height = world.height();
 	FrameVector<Coord> merged_air_surface;
 	for (int vid : ctx.components[cid].vertices) {
 		auto &v = ctx.vertices[vid];
@@ -422,7 +487,7 @@ bool prepareFlowNetworkOfComponent(
 	// Connect source
 	for (int i = 0; i < source_cnt; ++i) {
 		auto [sx, sy] = merged_air_surface[i];
-		auto v = ctx.pixel_vid[sy * width + sx];
+		auto v = ctx.vidOf(sx, sy);
 
 		// not using incFlow(), since we need one side connected to source
 		int eid = ctx.touchEdge(source_vid, v);
@@ -434,7 +499,7 @@ bool prepareFlowNetworkOfComponent(
 	// Connect sink
 	for (int i = n - source_cnt; i < n; ++i) {
 		auto [sx, sy] = merged_air_surface[i];
-		auto v = ctx.pixel_vid[sy * width + sx];
+		auto v = ctx.vidOf(sx, sy);
 
 		// not using incFlow(), since we need one side connected to sink
 		int eid = ctx.touchEdge(v, sink_vid);
@@ -545,12 +610,12 @@ void applyFlowResults(
 			std::shuffle(e.y_surface.begin(), e.y_surface.end(), rng);
 			for (int f = 0; f < e.flow; ++f) {
 				auto [x, y] = e.y_surface[f];
-				auto &tag = world.tagOf(x, y);
+				auto tag = world.tagOf(x, y);
 				to_v.cache.push_back({
 					.type = tag.type,
 					.color_index = tag.color_index,
 					.ignited = tag.ignited,
-					.element = std::move(world.elementOf(x, y)),
+					.state = world.stateOf(x, y),
 				});
 
 				if (u == source_vid) {
@@ -561,7 +626,8 @@ void applyFlowResults(
 					tag.type = cp.type;
 					tag.color_index = cp.color_index;
 					tag.ignited = cp.ignited;
-					world.elementOf(x, y) = std::move(cp.element);
+					world.stateOf(x, y) = cp.state;
+					world.markActive(x, y);
 					v.cache.pop_back();
 				}
 			}
@@ -593,11 +659,10 @@ void analysisFlow(PixelWorld &world, AnalysisContext &ctx) noexcept {
 } // namespace
 
 void PixelWorld::fluidAnalysisStep() noexcept {
-	AnalysisContext ctx(_width, _height);
-	densityAnalysisStep(*this);
+	AnalysisContext ctx(*this);
+	densityAnalysisStep(*this, ctx);
 
 	buildNetwork(*this, ctx);
-	resetDirtyFlags();
 
 	calculateGraphConnectedComponents(ctx);
 	analysisFlow(*this, ctx);
@@ -0,0 +1,237 @@
+#include "wforge/pagefile.h"
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace wf {
+
+namespace {
+
+// Segments are mapped at offsets of this alignment, the allocation
+// granularity of Windows and a multiple of the page size elsewhere
+constexpr std::size_t mapping_alignment = 65536;
+
+constexpr std::size_t segment_bytes =
+	(TilePageFile::segment_tiles * sizeof(PixelTile) + mapping_alignment - 1)
+	/ mapping_alignment * mapping_alignment;
+
+} // namespace
+
+#ifdef _WIN32
+
+struct TilePageFile::Handle {
+	HANDLE file;
+	std::vector<HANDLE> mappings; // one per segment
+
+	~Handle() noexcept {
+		for (HANDLE mapping : mappings) {
+			CloseHandle(mapping);
+		}
+		CloseHandle(file); // deletes the file
+	}
+};
+
+std::shared_ptr<TilePageFile> TilePageFile::create(
+	const std::filesystem::path &path
+) {
+	HANDLE file = CreateFileW(
+		path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_NEW,
+		FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr
+	);
+	if (file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error(
+			std::format(
+				"Failed to create tile page file '{}': error {}",
+				path.string(), GetLastError()
+			)
+		);
+	}
+
+	auto handle = std::make_unique<Handle>(file);
+	return std::shared_ptr<TilePageFile>(new TilePageFile(std::move(handle)));
+}
+
+TilePageFile::~TilePageFile() noexcept {
+	for (PixelTile *segment : _segments) {
+		UnmapViewOfFile(segment);
+	}
+}
+
+bool TilePageFile::addSegment() noexcept {
+	const std::uint64_t offset = _segments.size() * segment_bytes;
+	const std::uint64_t size = offset + segment_bytes;
+
+	try {
+		_handle->mappings.reserve(_segments.size() + 1);
+		_segments.reserve(_segments.size() + 1);
+	} catch (...) {
+		return false;
+	}
+
+	// A mapping object larger than the file grows it
+	HANDLE mapping = CreateFileMappingW(
+		_handle->file, nullptr, PAGE_READWRITE,
+		static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), nullptr
+	);
+	if (!mapping) {
+		return false;
+	}
+
+	void *view = MapViewOfFile(
+		mapping, FILE_MAP_ALL_ACCESS, static_cast<DWORD>(offset >> 32),
+		static_cast<DWORD>(offset), segment_bytes
+	);
+	if (!view) {
+		CloseHandle(mapping);
+		return false;
+	}
+
+	_handle->mappings.push_back(mapping);
+	_segments.push_back(static_cast<PixelTile *>(view));
+	return true;
+}
+
+#else
+
+struct TilePageFile::Handle {
+	int fd;
+
+	~Handle() noexcept {
+		close(fd);
+	}
+};
+
+std::shared_ptr<TilePageFile> TilePageFile::create(
+	const std::filesystem::path &path
+) {
+	const int fd = open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd < 0) {
+		throw std::runtime_error(
+			std::format(
+				"Failed to create tile page file '{}': {}", path.string(),
+				std::strerror(errno)
+			)
+		);
+	}
+
+	// Gone with the last descriptor, even if the game crashes
+	unlink(path.c_str());
+
+	auto handle = std::make_unique<Handle>(fd);
+	return std::shared_ptr<TilePageFile>(new TilePageFile(std::move(handle)));
+}
+
+TilePageFile::~TilePageFile() noexcept {
+	for (PixelTile *segment : _segments) {
+		munmap(segment, segment_bytes);
+	}
+}
+
+bool TilePageFile::addSegment() noexcept {
+	try {
+		_segments.reserve(_segments.size() + 1);
+	} catch (...) {
+		return false;
+	}
+
+	const off_t offset = _segments.size() * segment_bytes;
+	if (ftruncate(_handle->fd, offset + segment_bytes) != 0) {
+		return false;
+	}
+
+	void *view = mmap(
+		nullptr, segment_bytes, PROT_READ | PROT_WRITE, MAP_SHARED,
+		_handle->fd, offset
+	);
+	if (view == MAP_FAILED) {
+		return false;
+	}
+
+	_segments.push_back(static_cast<PixelTile *>(view));
+	return true;
+}
+
+#endif
+
+std::shared_ptr<TilePageFile> TilePageFile::createTemporary() {
+	std::random_device device;
+	const std::uint64_t id = (std::uint64_t{device()} << 32) | device();
+	return create(
+		std::filesystem::temp_directory_path()
+		/ std::format("waveforge-{:016x}.tiles", id)
+	);
+}
+
+TilePageFile::TilePageFile(std::unique_ptr<Handle> handle) noexcept
+	: _handle(std::move(handle)) {}
+
+std::shared_ptr<PixelTile> TilePageFile::store(const PixelTile &tile
+) noexcept {
+	PixelTile *slot;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_free_tiles.empty()) {
+			// Reserved up front, so that release() never allocates
+			try {
+				_free_tiles.reserve(
+					(_segments.size() + 1) * segment_tiles
+				);
+			} catch (...) {
+				return nullptr;
+			}
+
+			if (!addSegment()) {
+				return nullptr;
+			}
+
+			// Lowest addresses first
+			PixelTile *segment = _segments.back();
+			for (int i = segment_tiles - 1; i >= 0; --i) {
+				_free_tiles.push_back(segment + i);
+			}
+		}
+		slot = _free_tiles.back();
+		_free_tiles.pop_back();
+	}
+
+	PixelTile *stored = new (slot) PixelTile(tile);
+	try {
+		return std::shared_ptr<PixelTile>(
+			stored,
+			[file = shared_from_this()](PixelTile *tile) {
+			file->release(tile);
+		}
+		);
+	} catch (...) {
+		// The deleter has already given the slot back
+		return nullptr;
+	}
+}
+
+int TilePageFile::storedTileCount() const noexcept {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _segments.size() * segment_tiles - _free_tiles.size();
+}
+
+void TilePageFile::release(PixelTile *tile) noexcept {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_free_tiles.push_back(tile);
+}
+
+} // namespace wf
@@ -0,0 +1,331 @@
+#include "wforge/counterrng.h"
+#include "wforge/fallsand.h"
+#include "wforge/xoroshiro.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace wf {
+
+namespace {
+
+// A step reaches at most max_move_distance pixels plus the neighbors of the
+// moved pixel
+constexpr int step_reach = PixelWorld::max_move_distance + 2;
+
+// Chunks of the same phase are one chunk apart, so two of them never reach
+// the same pixel as long as this holds
+static_assert(2 * step_reach < PixelWorld::chunk_size);
+
+// Chunks (cx, cy) with the same (cx % 2, cy % 2) form a phase
+constexpr int num_chunk_phases = 4;
+
+// More workers than this hardly pays off, a standard world only has 64
+// chunks per phase
+constexpr int max_chunk_workers = 16;
+
+// Called with the worker id and the index of the chunk to step
+using ChunkJob = std::function<void(int worker_id, int chunk_index)>;
+
+// Element pass worker thread
+class ChunkWorker {
+public:
+	ChunkWorker(int worker_id, int num_workers)
+		: _worker_id(worker_id), _num_workers(num_workers) {
+		_thread = std::jthread([this](std::stop_token stoken) {
+			workerLoop(stoken);
+		});
+	}
+
+	// Non-copyable and non-movable
+	ChunkWorker(const ChunkWorker &) = delete;
+	ChunkWorker &operator=(const ChunkWorker &) = delete;
+
+	void startWork(std::span<const int> chunks, const ChunkJob *job) {
+		{
+			std::lock_guard<std::mutex> lock(_work_mutex);
+			_chunks = chunks;
+			_job = job;
+			_work_ready = true;
+		}
+		_cv.notify_one();
+	}
+
+	void waitForCompletion() {
+		std::unique_lock<std::mutex> lock(_work_mutex);
+		_cv_done.wait(lock, [this] {
+			return !_work_ready;
+		});
+	}
+
+	~ChunkWorker() noexcept {
+		_thread.request_stop();
+		_cv.notify_one();
+		_thread.join();
+	}
+
+private:
+	void workerLoop(std::stop_token stoken) {
+		while (!stoken.stop_requested()) {
+			try {
+				std::unique_lock<std::mutex> lock(_work_mutex);
+				_cv.wait(lock, [this, &stoken] {
+					return _work_ready || stoken.stop_requested();
+				});
+
+				if (stoken.stop_requested()) {
+					break;
+				}
+				lock.unlock();
+
+				// Chunks are dealt out round-robin, so that the same world
+				// state always leads to the same worker doing the same chunks
+				for (std::size_t i = _worker_id; i < _chunks.size();
+				     i += _num_workers) {
+					(*_job)(_worker_id, _chunks[i]);
+				}
+
+				lock.lock();
+				_work_ready = false;
+				lock.unlock();
+				_cv_done.notify_one();
+			} catch (const std::exception &e) {
+				std::cerr << "Fatal error in chunk worker " << _worker_id
+						  << ": " << e.what() << std::endl;
+				std::abort();
+			} catch (...) {
+				std::cerr << "Fatal unknown error in chunk worker "
+						  << _worker_id << std::endl;
+				std::abort();
+			}
+		}
+	}
+
+	int _worker_id;
+	int _num_workers;
+	std::jthread _thread;
+	std::mutex _work_mutex;
+	std::condition_variable _cv;
+	std::condition_variable _cv_done;
+	bool _work_ready = false;
+
+	// Work parameters
+	std::span<const int> _chunks;
+	const ChunkJob *_job = nullptr;
+};
+
+// Thread pool manager. Without workers the chunks are stepped on the
+// calling thread, as worker 0.
+class ChunkWorkerPool {
+public:
+	explicit ChunkWorkerPool(int num_workers) {
+		for (int i = 0; i < num_workers; ++i) {
+			_workers.emplace_back(
+				std::make_unique<ChunkWorker>(i, num_workers)
+			);
+		}
+		_worker_next_rects.resize(std::max(num_workers, 1));
+		_worker_charged_pixels.resize(std::max(num_workers, 1));
+	}
+
+	// Clear the next active rects and charged pixels of all workers
+	void prepare(int num_chunks) {
+		for (auto &rects : _worker_next_rects) {
+			rects.assign(num_chunks, DirtyRect{});
+		}
+
+		for (auto &pixels : _worker_charged_pixels) {
+			pixels.clear();
+		}
+	}
+
+	void execute(std::span<const int> chunks, const ChunkJob &job) {
+		if (_workers.empty()) {
+			for (int chunk_index : chunks) {
+				job(0, chunk_index);
+			}
+			return;
+		}
+
+		for (auto &worker : _workers) {
+			worker->startWork(chunks, &job);
+		}
+
+		for (auto &worker : _workers) {
+			worker->waitForCompletion();
+		}
+	}
+
+	DirtyRect *nextRectsOf(int worker_id) {
+		return _worker_next_rects[worker_id].data();
+	}
+
+	const auto &allNextRects() const {
+		return _worker_next_rects;
+	}
+
+	std::vector<int> *chargedPixelsOf(int worker_id) {
+		return &_worker_charged_pixels[worker_id];
+	}
+
+	const auto &allChargedPixels() const {
+		return _worker_charged_pixels;
+	}
+
+private:
+	std::vector<std::unique_ptr<ChunkWorker>> _workers;
+
+	// Chunks next to a chunk in work may be marked by two workers at once,
+	// so each worker collects its marks on its own
+	std::vector<std::vector<DirtyRect>> _worker_next_rects;
+	std::vector<std::vector<int>> _worker_charged_pixels;
+};
+
+// The workers of the process go to one stepping world at a time. Threads
+// finding them busy step their chunks themselves meanwhile, so forks
+// stepping side by side never start more threads than there are cores.
+// Chunks step the same way on any number of workers.
+class ChunkPoolLease {
+public:
+	ChunkPoolLease() : _lock(sharedMutex(), std::try_to_lock) {}
+
+	ChunkWorkerPool &pool() {
+		if (_lock.owns_lock()) {
+			static ChunkWorkerPool shared_pool(
+				std::clamp<int>(
+					std::thread::hardware_concurrency(), 1, max_chunk_workers
+				)
+			);
+			return shared_pool;
+		}
+
+		thread_local ChunkWorkerPool own_pool(0);
+		return own_pool;
+	}
+
+private:
+	static std::mutex &sharedMutex() {
+		static std::mutex mutex;
+		return mutex;
+	}
+
+	std::unique_lock<std::mutex> _lock;
+};
+
+Seed chunkSeedOf(CounterRng chunk_seeds, int chunk_index) noexcept {
+	return Seed{
+		chunk_seeds.at(2ull * chunk_index),
+		chunk_seeds.at(2ull * chunk_index + 1),
+	};
+}
+
+} // namespace
+
+void PixelWorld::parallelElementStep() noexcept {
+	ChunkPoolLease lease;
+	auto &pool = lease.pool();
+	const int num_chunks = _chunks_x * _chunks_y;
+	pool.prepare(num_chunks);
+
+	// Every chunk steps with its own generator, seeded by the chunk index, so
+	// the result does not depend on which worker steps it or how many there
+	// are
+	const auto chunk_seeds = nextCounterRng();
+	const ChunkJob job = [&](int worker_id, int chunk_index) {
+		Xoroshiro128PP rng(chunkSeedOf(chunk_seeds, chunk_index));
+		ScopedThreadRng bind_rng(rng);
+		_thread_next_active_rects = pool.nextRectsOf(worker_id);
+		_thread_charged_pixels = pool.chargedPixelsOf(worker_id);
+		stepChunk(chunk_index);
+		_thread_next_active_rects = nullptr;
+		_thread_charged_pixels = nullptr;
+	};
+
+	// Uniform chunks hold nothing to step
+	std::vector<char> in_work(num_chunks, false);
+	for (int i = 0; i < num_chunks; ++i) {
+		in_work[i] = !_active_rects[i].empty()
+			&& !isTileUniform(i % _chunks_x, i / _chunks_x);
+	}
+
+	// Tiles within step_reach of the active rect of a chunk, the ones its
+	// worker may read or write
+	auto for_each_reached_tile = [&](int chunk_index, auto &&visit) {
+		const auto &rect = _active_rects[chunk_index];
+		const int x0 = std::max(rect.x_min - step_reach, 0);
+		const int y0 = std::max(rect.y_min - step_reach, 0);
+		const int x1 = std::min(rect.x_max + step_reach, _width - 1);
+		const int y1 = std::min(rect.y_max + step_reach, _height - 1);
+		for (int ty = y0 / chunk_size; ty <= y1 / chunk_size; ++ty) {
+			for (int tx = x0 / chunk_size; tx <= x1 / chunk_size; ++tx) {
+				visit(tileIndexOf(tx * chunk_size, ty * chunk_size));
+			}
+		}
+	};
+
+	// Chunks of a phase reaching each tile, see below
+	std::vector<std::uint8_t> reach_counts(_tiles.size(), 0);
+
+	// Bottom chunk rows first, like elementStep()
+	std::vector<int> chunks;
+	chunks.reserve((num_chunks + num_chunk_phases - 1) / num_chunk_phases);
+	for (int phase = 0; phase < num_chunk_phases; ++phase) {
+		chunks.clear();
+		for (int cy = _chunks_y - 1 - phase / 2; cy >= 0; cy -= 2) {
+			for (int cx = phase % 2; cx < _chunks_x; cx += 2) {
+				if (in_work[cy * _chunks_x + cx]) {
+					chunks.push_back(cy * _chunks_x + cx);
+				}
+			}
+		}
+
+		// A worker copies a shared tile itself when it first writes to it,
+		// so that tiles only read stay shared with forks, e.g. the one of the
+		// rewind buffer. Tiles two chunks of the phase reach get their copy
+		// beforehand instead, as their workers would copy them at once.
+		for (int chunk_index : chunks) {
+			for_each_reached_tile(chunk_index, [&](int tile_index) {
+				if (++reach_counts[tile_index] == 2) {
+					mutableTile(tile_index);
+				}
+			});
+		}
+		for (int chunk_index : chunks) {
+			for_each_reached_tile(chunk_index, [&](int tile_index) {
+				reach_counts[tile_index] = 0;
+			});
+		}
+
+		if (!chunks.empty()) {
+			pool.execute(chunks, job);
+		}
+	}
+
+	for (const auto &rects : pool.allNextRects()) {
+		for (int i = 0; i < num_chunks; ++i) {
+			const auto &rect = rects[i];
+			if (!rect.empty()) {
+				_next_active_rects[i].expand(
+					rect.x_min, rect.y_min, rect.x_max, rect.y_max
+				);
+			}
+		}
+	}
+
+	for (const auto &pixels : pool.allChargedPixels()) {
+		_charged_pixels.insert(
+			_charged_pixels.end(), pixels.begin(), pixels.end()
+		);
+	}
+}
+
+} // namespace wf
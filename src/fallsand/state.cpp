@@ -0,0 +1,392 @@
+#include "wforge/elements.h"
+#include "wforge/fallsand.h"
+#include "wforge/savestate.h"
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <format>
+#include <memory>
+#include <stdexcept>
+
+namespace wf {
+
+namespace {
+
+// How a tile of the world is stored
+enum class TileEncoding : std::uint8_t {
+	Uniform, // the kind, color and conductivity of all its pixels
+	Planes,  // every plane of the tile, packed
+};
+
+template<typename T>
+std::span<const std::uint8_t> bytesOf(std::span<const T> values) noexcept {
+	const auto *data = reinterpret_cast<const std::uint8_t *>(values.data());
+	return {data, values.size_bytes()};
+}
+
+template<typename T>
+std::span<std::uint8_t> bytesOf(std::span<T> values) noexcept {
+	auto *data = reinterpret_cast<std::uint8_t *>(values.data());
+	return {data, values.size_bytes()};
+}
+
+// A field of the element states has a plane of its own, so that the zeros
+// of pixels at rest form runs
+template<typename T>
+void writeStateField(
+	StateWriter &out, const PixelTile &tile, T ElementState::*field
+) {
+	std::array<T, PixelTile::area> plane;
+	for (int i = 0; i < PixelTile::area; ++i) {
+		plane[i] = tile.states[i].*field;
+	}
+	out.writePacked(bytesOf(std::span<const T>(plane)));
+}
+
+template<typename T>
+void readStateField(StateReader &in, PixelTile &tile, T ElementState::*field) {
+	std::array<T, PixelTile::area> plane;
+	in.readPacked(bytesOf(std::span<T>(plane)));
+	for (int i = 0; i < PixelTile::area; ++i) {
+		tile.states[i].*field = plane[i];
+	}
+}
+
+void writeTile(StateWriter &out, const PixelTile &tile) {
+	for (const auto *plane :
+	     {&tile.kinds, &tile.colors, &tile.dirty, &tile.flags, &tile.heat,
+	      &tile.conductivity, &tile.electric_power}) {
+		out.writePacked(*plane);
+	}
+
+	writeStateField(out, tile, &ElementState::vx);
+	writeStateField(out, tile, &ElementState::vy);
+	writeStateField(out, tile, &ElementState::burn_time_left);
+	writeStateField(out, tile, &ElementState::carried_type);
+
+	for (const auto *plane :
+	     {&tile.laser_active, &tile.laser_stroke,
+	      &tile.external_entity_present, &tile.is_reflective_surface}) {
+		out.writePacked(bytesOf(plane->words()));
+	}
+}
+
+void readTile(StateReader &in, PixelTile &tile) {
+	for (auto *plane :
+	     {&tile.kinds, &tile.colors, &tile.dirty, &tile.flags, &tile.heat,
+	      &tile.conductivity, &tile.electric_power}) {
+		in.readPacked(*plane);
+	}
+
+	readStateField(in, tile, &ElementState::vx);
+	readStateField(in, tile, &ElementState::vy);
+	readStateField(in, tile, &ElementState::burn_time_left);
+	readStateField(in, tile, &ElementState::carried_type);
+
+	for (auto *plane :
+	     {&tile.laser_active, &tile.laser_stroke,
+	      &tile.external_entity_present, &tile.is_reflective_surface}) {
+		in.readPacked(bytesOf(plane->words()));
+	}
+}
+
+constexpr auto type_count = static_cast<std::uint8_t>(PixelType::_count);
+
+// Types past PixelType::_count would index past the dispatch table of the
+// elements
+bool hasValidTypes(const PixelTile &tile) noexcept {
+	for (int i = 0; i < PixelTile::area; ++i) {
+		const auto type = tile.kinds[i] & _plane::Type::byte_mask;
+		const auto carried_type = static_cast<std::uint8_t>(
+			tile.states[i].carried_type
+		);
+		if (type >= type_count || carried_type >= type_count) {
+			return false;
+		}
+	}
+	return true;
+}
+
+template<typename T>
+using BytesOf = std::array<std::uint8_t, sizeof(T)>;
+
+// Bitwise, unlike == on floats
+template<typename T>
+bool isSame(const T &a, const T &b) noexcept {
+	return std::bit_cast<BytesOf<T>>(a) == std::bit_cast<BytesOf<T>>(b);
+}
+
+template<typename T>
+void xorInto(T &dst, const T &src) noexcept {
+	using Bytes = BytesOf<T>;
+	auto bytes = std::bit_cast<Bytes>(dst);
+	const auto src_bytes = std::bit_cast<Bytes>(src);
+	for (std::size_t i = 0; i < bytes.size(); ++i) {
+		bytes[i] ^= src_bytes[i];
+	}
+	dst = std::bit_cast<T>(bytes);
+}
+
+// XOR every plane of src into dst. The padding of the element states is
+// left out, so the XOR of two equal tiles is all zeros.
+void xorTile(PixelTile &dst, const PixelTile &src) noexcept {
+	xorInto(dst.kinds, src.kinds);
+	xorInto(dst.colors, src.colors);
+	xorInto(dst.dirty, src.dirty);
+	xorInto(dst.flags, src.flags);
+	xorInto(dst.heat, src.heat);
+	xorInto(dst.conductivity, src.conductivity);
+	xorInto(dst.electric_power, src.electric_power);
+	for (int i = 0; i < PixelTile::area; ++i) {
+		xorInto(dst.states[i].vx, src.states[i].vx);
+		xorInto(dst.states[i].vy, src.states[i].vy);
+		xorInto(dst.states[i].burn_time_left, src.states[i].burn_time_left);
+		xorInto(dst.states[i].carried_type, src.states[i].carried_type);
+	}
+	xorInto(dst.laser_active, src.laser_active);
+	xorInto(dst.laser_stroke, src.laser_stroke);
+	xorInto(dst.external_entity_present, src.external_entity_present);
+	xorInto(dst.is_reflective_surface, src.is_reflective_surface);
+}
+
+// Whether the planes of the tiles are equal, so that their XOR is all zeros
+bool isSameTile(const PixelTile &a, const PixelTile &b) noexcept {
+	if (a.kinds != b.kinds || a.colors != b.colors || a.dirty != b.dirty
+	    || a.flags != b.flags || a.heat != b.heat
+	    || a.conductivity != b.conductivity
+	    || a.electric_power != b.electric_power) {
+		return false;
+	}
+
+	for (int i = 0; i < PixelTile::area; ++i) {
+		const auto &state = a.states[i];
+		const auto &other = b.states[i];
+		if (!isSame(state.vx, other.vx) || !isSame(state.vy, other.vy)
+		    || state.burn_time_left != other.burn_time_left
+		    || state.carried_type != other.carried_type) {
+			return false;
+		}
+	}
+
+	return isSame(a.laser_active, b.laser_active)
+		&& isSame(a.laser_stroke, b.laser_stroke)
+		&& isSame(a.external_entity_present, b.external_entity_present)
+		&& isSame(a.is_reflective_surface, b.is_reflective_surface);
+}
+
+} // namespace
+
+void PixelWorld::saveTileDelta(StateWriter &out, const PixelWorld &from) const {
+	auto diff = std::make_unique<PixelTile>();
+	for (int ty = 0; ty < _chunks_y; ++ty) {
+		for (int tx = 0; tx < _chunks_x; ++tx) {
+			// Tiles neither world wrote to since the fork are still shared
+			const int tile_index = (ty + 1) * (_chunks_x + 2) + tx + 1;
+			const auto &tile = _tiles[tile_index].tile;
+			const auto &from_tile = from._tiles[tile_index].tile;
+			if (tile == from_tile) {
+				continue;
+			}
+
+			// Copied for a write that put back what was there, or paged
+			if (isSameTile(*tile, *from_tile)) {
+				continue;
+			}
+
+			*diff = *tile;
+			xorTile(*diff, *from_tile);
+
+			out.write<std::int32_t>(tile_index);
+			writeTile(out, *diff);
+		}
+	}
+	out.write<std::int32_t>(-1);
+}
+
+void PixelWorld::applyTileDelta(StateReader &in) {
+	auto diff = std::make_unique<PixelTile>();
+	for (auto tile_index = in.read<std::int32_t>(); tile_index != -1;
+	     tile_index = in.read<std::int32_t>()) {
+		const int tile_x = tile_index % (_chunks_x + 2) - 1;
+		const int tile_y = tile_index / (_chunks_x + 2) - 1;
+		if (tile_x < 0 || tile_x >= _chunks_x || tile_y < 0
+		    || tile_y >= _chunks_y) {
+			throw std::runtime_error(
+				"Corrupt tile delta: tile outside of the world"
+			);
+		}
+
+		// Checked before it is applied, so that a corrupt delta leaves the
+		// tile as it was
+		readTile(in, *diff);
+		xorTile(*diff, *_tiles[tile_index].tile);
+		if (!hasValidTypes(*diff)) {
+			throw std::runtime_error("Corrupt tile delta: unknown pixel type");
+		}
+		mutableTile(tile_index) = *diff;
+	}
+}
+
+void PixelWorld::saveState(StateWriter &out, bool with_tiles) const {
+	out.write<std::int32_t>(_width);
+	out.write<std::int32_t>(_height);
+	out.write(_steps);
+	out.write(_rng.state());
+
+	// The ghost border never changes
+	for (int ty = 0; with_tiles && ty < _chunks_y; ++ty) {
+		for (int tx = 0; tx < _chunks_x; ++tx) {
+			const PixelTile &tile = tileAt(tx, ty);
+			if (!isTileUniform(tx, ty)) {
+				out.write(TileEncoding::Planes);
+				writeTile(out, tile);
+				continue;
+			}
+
+			out.write(TileEncoding::Uniform);
+			out.write(tile.kinds[0]);
+			out.write(tile.colors[0]);
+			out.write(tile.conductivity[0]);
+		}
+	}
+
+	// Between two steps only the rects of the next one are in use
+	const int num_chunks = _chunks_x * _chunks_y;
+	int num_active = 0;
+	for (const auto &rect : _next_active_rects) {
+		num_active += !rect.empty();
+	}
+	out.write<std::int32_t>(num_active);
+	for (int i = 0; i < num_chunks; ++i) {
+		if (!_next_active_rects[i].empty()) {
+			out.write<std::int32_t>(i);
+			out.write(_next_active_rects[i]);
+		}
+	}
+
+	out.write<std::int32_t>(_charged_pixels.size());
+	for (int index : _charged_pixels) {
+		out.write<std::int32_t>(index);
+	}
+
+	out.write<std::int32_t>(_structures.size());
+	for (const auto &structure : _structures) {
+		structure->saveState(out);
+	}
+}
+
+void PixelWorld::loadState(StateReader &in, bool with_tiles) {
+	const auto width = in.read<std::int32_t>();
+	const auto height = in.read<std::int32_t>();
+	if (width != _width || height != _height) {
+		throw std::runtime_error(
+			std::format(
+				"Save state of a {}x{} world does not fit a {}x{} world",
+				width, height, _width, _height
+			)
+		);
+	}
+
+	_steps = in.read<std::uint64_t>();
+	_rng = Xoroshiro128PP(in.read<Seed>());
+
+	for (int ty = 0; with_tiles && ty < _chunks_y; ++ty) {
+		for (int tx = 0; tx < _chunks_x; ++tx) {
+			const int tile_index = (ty + 1) * (_chunks_x + 2) + tx + 1;
+			const auto encoding = in.read<TileEncoding>();
+			if (encoding == TileEncoding::Planes) {
+				// Every plane is read, so tiles of the world's own are reused
+				auto &slot = _tiles[tile_index];
+				if (slot.shared) {
+					slot = {.tile = std::make_shared<PixelTile>()};
+				}
+				readTile(in, *slot.tile);
+				slot.touched = true;
+				if (!hasValidTypes(*slot.tile)) {
+					throw std::runtime_error(
+						"Corrupt save state: unknown pixel type"
+					);
+				}
+				continue;
+			}
+
+			if (encoding != TileEncoding::Uniform) {
+				throw std::runtime_error(
+					"Corrupt save state: unknown tile encoding"
+				);
+			}
+
+			std::uint8_t kind = in.read<std::uint8_t>();
+			std::uint8_t color = in.read<std::uint8_t>();
+			std::uint8_t conductivity = in.read<std::uint8_t>();
+			// Only tiles of a static pixel are shared as constants
+			const auto type = kind & _plane::Type::byte_mask;
+			if (type >= type_count
+			    || !elementDispatchOf(static_cast<PixelType>(type)).is_static) {
+				throw std::runtime_error(
+					"Corrupt save state: uniform tile of a non-static pixel"
+				);
+			}
+			std::uint8_t zero[4] = {};
+			const PixelTag tag = PixelTagRef(
+				&kind, &color, &zero[0], &zero[1], &zero[2], &conductivity,
+				&zero[3]
+			);
+			setUniformTile(tile_index, tag);
+		}
+	}
+
+	const int num_chunks = _chunks_x * _chunks_y;
+	std::ranges::fill(_active_rects, DirtyRect{});
+	std::ranges::fill(_next_active_rects, DirtyRect{});
+	const auto num_active = in.read<std::int32_t>();
+	for (int i = 0; i < num_active; ++i) {
+		const auto chunk_index = in.read<std::int32_t>();
+		if (chunk_index < 0 || chunk_index >= num_chunks) {
+			throw std::runtime_error(
+				"Corrupt save state: active chunk outside of the world"
+			);
+		}
+
+		// Steps only ever mark the pixels of a chunk within the world
+		const auto rect = in.read<DirtyRect>();
+		const int x0 = chunk_index % _chunks_x * chunk_size;
+		const int y0 = chunk_index / _chunks_x * chunk_size;
+		if (rect.empty() || rect.x_min < x0 || rect.y_min < y0
+		    || rect.x_max >= std::min(x0 + chunk_size, _width)
+		    || rect.y_max >= std::min(y0 + chunk_size, _height)) {
+			throw std::runtime_error(
+				"Corrupt save state: active rect outside of its chunk"
+			);
+		}
+		_next_active_rects[chunk_index] = rect;
+	}
+
+	_charged_pixels.clear();
+	const auto num_charged = in.read<std::int32_t>();
+	for (int i = 0; i < num_charged; ++i) {
+		const auto index = in.read<std::int32_t>();
+		if (index < 0 || index >= _width * _height) {
+			throw std::runtime_error(
+				"Corrupt save state: charged pixel outside of the world"
+			);
+		}
+		_charged_pixels.push_back(index);
+	}
+
+	const auto num_structures = in.read<std::int32_t>();
+	if (num_structures != static_cast<int>(_structures.size())) {
+		throw std::runtime_error(
+			std::format(
+				"Save state of a world with {} structures does not fit a "
+				"world with {}",
+				num_structures, _structures.size()
+			)
+		);
+	}
+	for (auto &structure : _structures) {
+		structure->loadState(in);
+	}
+}
+
+} // namespace wf
@@ -1,45 +1,108 @@
+#include "wforge/counterrng.h"
 #include "wforge/fallsand.h"
-#include "wforge/xoroshiro.h"
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cmath>
 #include <condition_variable>
 #include <cstdlib>
+#include <cstring>
 #include <exception>
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <thread>
 #include <vector>
 
+#if defined(__x86_64__) || defined(_M_X64)
+#define WFORGE_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang only emit the instructions of the target a function is
+// compiled for, MSVC emits any of them anywhere
+#if defined(__GNUC__) || defined(__clang__)
+#define WFORGE_TARGET(isa) __attribute__((target(isa)))
+#else
+#define WFORGE_TARGET(isa)
+#endif
+
 namespace wf {
 
 namespace {
 
 constexpr float heat_transfer_factor = 0.15f;
 constexpr float heat_decay_factor = 0.005f;
-constexpr std::uint64_t rng_max = Xoroshiro128PP::max();
-
-// Why 4 instead of std::thread::hardware_concurrency()?
-// After all threads done their work, the main thread needs to merge
-// the results. If there are too many threads, the merging step becomes
-// a bottleneck. 2-6 seems to be a good compromise for most systems.
-// This value can be adjusted later based on profiling results.
-constexpr int num_thermal_analysis_workers = 4;
-
-// Work phase enumeration
-enum class WorkPhase {
-	Idle,
-	HeatTransfer,
-	HeatDecay
+constexpr std::uint64_t rng_max = CounterRng::max();
+
+constexpr int conductivity_max = PixelTag::thermal_conductivity_max;
+
+// The factors of a thermal step covering interval steps. Heat spreads and
+// decays that many times as fast, the fixed point kernels take the weight
+// of the heat a pixel keeps in 1/256 and the decay in 1/65536.
+struct HeatFactors {
+	float transfer;
+	float decay;
+	int self_weight;
+	int decay_weight;
 };
 
+HeatFactors heatFactorsOf(int interval) noexcept {
+	const float transfer = heat_transfer_factor * interval;
+	const float decay = heat_decay_factor * interval;
+	return {
+		.transfer = transfer,
+		.decay = decay,
+		.self_weight = static_cast<int>(256 / transfer + 0.5f),
+		.decay_weight = static_cast<int>(65536 * decay + 0.5f),
+	};
+}
+
+// Workers share nothing but the world they read, so they scale like the
+// chunk workers of parallel.cpp
+constexpr int max_thermal_workers = 16;
+
+constexpr int tile_size = PixelTile::size;
+
+// A tile and two rings of pixels around it. What the pixels of the inner
+// ring give to the tile depends on their own neighbors.
+constexpr int frame_size = tile_size + 4;
+constexpr int frame_area = frame_size * frame_size;
+
+constexpr int frameIndexOf(int local_x, int local_y) noexcept {
+	return (local_y + 2) * frame_size + local_x + 2;
+}
+
+// A tile and the inner ring, the pixels whose heat flows are needed
+constexpr int flow_size = tile_size + 2;
+constexpr int flow_area = flow_size * flow_size;
+
+constexpr int flowIndexOf(int local_x, int local_y) noexcept {
+	return (local_y + 1) * flow_size + local_x + 1;
+}
+
+// Left, right, up and down, the opposite of direction k is k ^ 1
+constexpr int frame_offsets[] = {-1, 1, -frame_size, frame_size};
+constexpr int flow_offsets[] = {-1, 1, -flow_size, flow_size};
+
+// What a pixel keeps of its heat and what it gives to each neighbor
+struct HeatFlow {
+	int kept = 0;
+	std::array<int, 4> given{};
+};
+
+// Called with the index of the tile to work on in the current list
+using ThermalJob = std::function<void(int index)>;
+
 // Thermal analysis worker thread
 class ThermalWorker {
 public:
-	ThermalWorker(int worker_id)
-		: _worker_id(worker_id)
-		, _rng(Seed::device_random())
-		, _phase(WorkPhase::Idle) {
+	ThermalWorker(int worker_id, int num_workers)
+		: _worker_id(worker_id), _num_workers(num_workers) {
 		_thread = std::jthread([this](std::stop_token stoken) {
 			workerLoop(stoken);
 		});
@@ -49,17 +112,11 @@ public:
 	ThermalWorker(const ThermalWorker &) = delete;
 	ThermalWorker &operator=(const ThermalWorker &) = delete;
 
-	void startWork(
-		WorkPhase phase, const PixelWorld *world, int y_start, int y_end,
-		std::vector<int> heat_maps[]
-	) {
+	void startWork(int count, const ThermalJob *job) {
 		{
 			std::lock_guard<std::mutex> lock(_work_mutex);
-			_phase = phase;
-			_world = world;
-			_y_start = y_start;
-			_y_end = y_end;
-			_heat_maps = heat_maps;
+			_count = count;
+			_job = job;
 			_work_ready = true;
 		}
 		_cv.notify_one();
@@ -90,15 +147,11 @@ private:
 				if (stoken.stop_requested()) {
 					break;
 				}
-
-				WorkPhase current_phase = _phase;
 				lock.unlock();
 
-				// Execute actual work
-				if (current_phase == WorkPhase::HeatTransfer) {
-					doHeatTransfer();
-				} else if (current_phase == WorkPhase::HeatDecay) {
-					doHeatDecay();
+				// Round-robin, like the chunk workers of parallel.cpp
+				for (int i = _worker_id; i < _count; i += _num_workers) {
+					(*_job)(i);
 				}
 
 				lock.lock();
@@ -117,230 +170,954 @@ private:
 		}
 	}
 
-	void doHeatTransfer() {
-		constexpr int dx[] = {-1, 1, 0, 0};
-		constexpr int dy[] = {0, 0, -1, 1};
-		const int width = _world->width();
-		const int height = _world->height();
+	int _worker_id;
+	int _num_workers;
+	std::jthread _thread;
+	std::mutex _work_mutex;
+	std::condition_variable _cv;
+	std::condition_variable _cv_done;
+	bool _work_ready = false;
+
+	// Work parameters
+	int _count = 0;
+	const ThermalJob *_job = nullptr;
+};
+
+// Thread pool manager. Without workers the tiles are worked out on the
+// calling thread.
+class ThermalWorkerPool {
+public:
+	explicit ThermalWorkerPool(int num_workers) {
+		for (int i = 0; i < num_workers; ++i) {
+			_workers.emplace_back(
+				std::make_unique<ThermalWorker>(i, num_workers)
+			);
+		}
+	}
 
-		int conductivity_weights[4];
+	void prepare(int num_warm_tiles) {
+		_next_heat.resize(num_warm_tiles);
+	}
 
-		for (int y = _y_start; y < _y_end; ++y) {
-			for (int x = 0; x < width; ++x) {
-				auto tag = _world->tagOf(x, y);
+	void execute(int count, const ThermalJob &job) {
+		if (_workers.empty()) {
+			for (int i = 0; i < count; ++i) {
+				job(i);
+			}
+			return;
+		}
 
-				if (tag.heat == 0 || tag.thermal_conductivity == 0) {
-					_heat_maps[_worker_id][y * width + x] += tag.heat;
-					continue;
-				}
+		for (auto &worker : _workers) {
+			worker->startWork(count, &job);
+		}
 
-				float total_transfer_amount = 0;
-
-				int total_thermal_conductivity = std::round(
-					tag.heat
-					* (PixelTag::thermal_conductivity_max
-				       - tag.thermal_conductivity)
-					/ heat_transfer_factor
-				);
-
-				for (int i = 0; i < 4; ++i) {
-					int nx = x + dx[i];
-					int ny = y + dy[i];
-					if (nx < 0 || nx >= width || ny < 0 || ny >= height) {
-						conductivity_weights[i] = 0;
-						continue;
-					}
-
-					auto ntag = _world->tagOf(nx, ny);
-					auto delta_heat = std::max<int>(0, tag.heat - ntag.heat);
-					auto relative_conductivity = std::min(
-						tag.thermal_conductivity, ntag.thermal_conductivity
-					);
-
-					conductivity_weights[i] = delta_heat
-						* relative_conductivity;
-					total_thermal_conductivity += conductivity_weights[i];
-				}
+		for (auto &worker : _workers) {
+			worker->waitForCompletion();
+		}
+	}
 
-				for (int i = 0; i < 4; ++i) {
-					int nx = x + dx[i];
-					int ny = y + dy[i];
-					if (conductivity_weights[i] == 0) {
-						continue;
-					}
+	std::array<std::uint8_t, PixelTile::area> &nextHeatOf(int warm_index) {
+		return _next_heat[warm_index];
+	}
 
-					auto ntag = _world->tagOf(nx, ny);
-					int conductivity = conductivity_weights[i];
+private:
+	std::vector<std::unique_ptr<ThermalWorker>> _workers;
 
-					float transfer_amount = 1.f * tag.heat * conductivity
-						/ total_thermal_conductivity;
+	// One per tile rather than per worker, each tile is worked on by a
+	// single worker
+	std::vector<std::array<std::uint8_t, PixelTile::area>> _next_heat;
+};
 
-					int received_heat = std::floor(transfer_amount);
-					float frac = (transfer_amount - received_heat) / 2;
-					if (_rng()
-					    < std::round(frac * static_cast<double>(rng_max))) {
-						received_heat += 1;
-					}
+// One stepping world at a time gets the workers of the process, like the
+// chunk workers of parallel.cpp
+class ThermalPoolLease {
+public:
+	ThermalPoolLease() : _lock(sharedMutex(), std::try_to_lock) {}
 
-					total_transfer_amount += transfer_amount;
-					_heat_maps[_worker_id][ny * width + nx] += received_heat;
-				}
-				_heat_maps[_worker_id][y * width + x] += tag.heat
-					- std::round(total_transfer_amount);
-			}
+	ThermalWorkerPool &pool() {
+		if (_lock.owns_lock()) {
+			static ThermalWorkerPool shared_pool(
+				std::clamp<int>(
+					std::thread::hardware_concurrency(), 1,
+					max_thermal_workers
+				)
+			);
+			return shared_pool;
 		}
+
+		thread_local ThermalWorkerPool own_pool(0);
+		return own_pool;
 	}
 
-	void doHeatDecay() {
-		const int width = _world->width();
-		const int height = _world->height();
-		const int left = _y_start * width;
-		const int right = _y_end * width;
+private:
+	static std::mutex &sharedMutex() {
+		static std::mutex mutex;
+		return mutex;
+	}
+
+	std::unique_lock<std::mutex> _lock;
+};
+
+// Heat and conductivity of the pixels of a frame
+struct HeatFrame {
+	std::array<std::uint8_t, frame_area> heat;
+	std::array<std::uint8_t, frame_area> conductivity;
+};
 
-		// Merge all worker heat maps into the first worker's heat map
-		for (int worker_id = 1; worker_id < num_thermal_analysis_workers;
-		     ++worker_id) {
-			for (int i = left; i < right; ++i) {
-				_heat_maps[0][i] += _heat_maps[worker_id][i];
+// Straight from the planes of the 3x3 tiles around. Void pixels of the ghost
+// border have no conductivity, so no heat flows out of the world.
+void loadFrame(
+	const PixelWorld &world, int tile_x, int tile_y, HeatFrame &frame
+) noexcept {
+	for (int ly = -2; ly < tile_size + 2; ++ly) {
+		const int dy = (ly >= 0) + (ly >= tile_size) - 1;
+		const int src_y = ly - dy * tile_size;
+		for (int dx = -1; dx <= 1; ++dx) {
+			const PixelTile &tile = world.tileAt(tile_x + dx, tile_y + dy);
+			const int lx0 = std::max(-2, dx * tile_size);
+			const int lx1 = std::min(tile_size + 2, (dx + 1) * tile_size);
+			for (int lx = lx0; lx < lx1; ++lx) {
+				const int src = PixelTile::indexOf(lx - dx * tile_size, src_y);
+				frame.heat[frameIndexOf(lx, ly)] = tile.heat[src]
+					& _plane::Heat::byte_mask;
+				frame.conductivity[frameIndexOf(lx, ly)] =
+					tile.conductivity[src]
+					& _plane::ThermalConductivity::byte_mask;
 			}
 		}
+	}
+}
+
+// How a pixel of a hot tile spreads its heat over its neighbors. Coin flips
+// are drawn from rng by pixel index, so the result does not depend on the
+// workers or on which tile it is worked out for.
+HeatFlow heatFlowOf(
+	const HeatFrame &frame, int i, std::uint64_t pixel_index, CounterRng rng,
+	float transfer_factor
+) noexcept {
+	const int my_heat = frame.heat[i];
+	const int my_conductivity = frame.conductivity[i];
+
+	HeatFlow flow;
+	if (my_heat == 0 || my_conductivity == 0) {
+		flow.kept = my_heat;
+		return flow;
+	}
+
+	float total_transfer_amount = 0;
+
+	int total_thermal_conductivity = std::round(
+		my_heat * (PixelTag::thermal_conductivity_max - my_conductivity)
+		/ transfer_factor
+	);
+
+	int conductivity_weights[4];
+	for (int k = 0; k < 4; ++k) {
+		const int ni = i + frame_offsets[k];
+		auto delta_heat = std::max<int>(0, my_heat - frame.heat[ni]);
+		auto relative_conductivity = std::min<int>(
+			my_conductivity, frame.conductivity[ni]
+		);
+
+		conductivity_weights[k] = delta_heat * relative_conductivity;
+		total_thermal_conductivity += conductivity_weights[k];
+	}
+
+	for (int k = 0; k < 4; ++k) {
+		if (conductivity_weights[k] == 0) {
+			continue;
+		}
+
+		int weight = conductivity_weights[k];
 
-		for (int i = left; i < right; ++i) {
-			auto &next_heat = _heat_maps[0][i];
-			if (next_heat <= 0) {
+		float transfer_amount = 1.f * my_heat * weight
+			/ total_thermal_conductivity;
+
+		int received_heat = std::floor(transfer_amount);
+		float frac = (transfer_amount - received_heat) / 2;
+		if (rng.at(4 * pixel_index + k)
+		    < std::round(frac * static_cast<double>(rng_max))) {
+			received_heat += 1;
+		}
+
+		total_transfer_amount += transfer_amount;
+		flow.given[k] = received_heat;
+	}
+	flow.kept = my_heat - std::round(total_transfer_amount);
+	return flow;
+}
+
+// Gather the heat the pixels of a tile keep and get from their neighbors,
+// then let it decay. The flows of the pixels around the tile are worked out
+// again rather than shared, so that nothing is written but out. is_hot
+// tells which of the 3x3 tiles around the tile hold heat, row by row.
+void stepHeatFloat(
+	const PixelWorld &world, int tile_x, int tile_y,
+	const std::array<bool, 9> &is_hot,
+	std::array<std::uint8_t, PixelTile::area> &out, CounterRng transfer_rng,
+	CounterRng decay_rng, const HeatFactors &factors
+) {
+	const int x0 = tile_x * tile_size;
+	const int y0 = tile_y * tile_size;
+
+	HeatFrame frame;
+	loadFrame(world, tile_x, tile_y, frame);
+
+	// Only pixels of hot tiles give heat away or keep it
+	std::array<HeatFlow, flow_area> flows;
+	for (int ly = -1; ly <= tile_size; ++ly) {
+		const int dy = (ly >= 0) + (ly >= tile_size);
+		for (int lx = -1; lx <= tile_size; ++lx) {
+			const int dx = (lx >= 0) + (lx >= tile_size);
+			auto &flow = flows[flowIndexOf(lx, ly)];
+			if (!is_hot[dy * 3 + dx]) {
+				flow = {};
 				continue;
 			}
 
-			float delta = next_heat * heat_decay_factor;
-			int nat = std::floor(delta);
-			float frac = delta - nat;
-			next_heat -= nat;
-			if (next_heat > 0
-			    && _rng() < std::round(frac * static_cast<double>(rng_max))) {
-				next_heat -= 1;
+			const std::uint64_t pixel_index = 1ull * (y0 + ly) * world.width()
+				+ x0 + lx;
+			flow = heatFlowOf(
+				frame, frameIndexOf(lx, ly), pixel_index, transfer_rng,
+				factors.transfer
+			);
+		}
+	}
+
+	for (int ly = 0; ly < tile_size; ++ly) {
+		for (int lx = 0; lx < tile_size; ++lx) {
+			const int i = flowIndexOf(lx, ly);
+			int next_heat = flows[i].kept;
+			for (int k = 0; k < 4; ++k) {
+				next_heat += flows[i + flow_offsets[k]].given[k ^ 1];
+			}
+
+			if (next_heat > 0 && world.inBounds(x0 + lx, y0 + ly)) {
+				const std::uint64_t pixel_index = 1ull * (y0 + ly)
+					* world.width() + x0 + lx;
+				float delta = next_heat * factors.decay;
+				int nat = std::floor(delta);
+				float frac = delta - nat;
+				next_heat -= nat;
+				if (next_heat > 0
+				    && decay_rng.at(pixel_index)
+				        < std::round(frac * static_cast<double>(rng_max))) {
+					next_heat -= 1;
+				}
 			}
 
 			// Clamp to valid range
-			next_heat = std::clamp<int>(next_heat, 0, PixelTag::heat_max);
+			out[PixelTile::indexOf(lx, ly)] = std::clamp<int>(
+				next_heat, 0, PixelTag::heat_max
+			);
 		}
 	}
+}
 
-	int _worker_id;
-	Xoroshiro128PP _rng;
-	std::jthread _thread;
-	std::mutex _work_mutex;
-	std::condition_variable _cv;
-	std::condition_variable _cv_done;
-	bool _work_ready = false;
-
-	// Work parameters
-	WorkPhase _phase;
-	const PixelWorld *_world = nullptr;
-	int _y_start = 0;
-	int _y_end = 0;
-	std::vector<int> *_heat_maps = nullptr;
+// The flows of the pixels of a flow frame, plane by plane, so that SIMD
+// kernels read and write them a row at a time
+struct FlowPlanes {
+	std::array<std::int32_t, flow_area> kept;
+	std::array<std::array<std::int32_t, flow_area>, 4> given;
 };
 
-// Thread pool manager
-class ThermalWorkerPool {
-public:
-	ThermalWorkerPool() {
-		for (int i = 0; i < num_thermal_analysis_workers; ++i) {
-			_workers.emplace_back(std::make_unique<ThermalWorker>(i));
+// Runs of count pixels of a row, from frame index i, flow index fi and
+// pixel index pixel_index on. SIMD runs take a multiple of their width.
+using FlowsOfRun = void (*)(
+	const HeatFrame &frame, int i, int fi, int count,
+	std::uint32_t pixel_index, CounterRng rng, int self_weight,
+	FlowPlanes &flows
+);
+using GatherRun = void (*)(
+	const FlowPlanes &flows, int fi, int count, std::uint32_t pixel_index,
+	CounterRng rng, int decay_weight, std::uint8_t *out
+);
+
+// heatFlowOf() in fixed point. Transfers are rounded up with a probability
+// of half their fraction as well, by the top 14 bits of at32(). With an
+// exact integer division, the SIMD kernels get the same results.
+void fixedHeatFlowsOf(
+	const HeatFrame &frame, int i, int fi, int count,
+	std::uint32_t pixel_index, CounterRng rng, int self_weight,
+	FlowPlanes &flows
+) {
+	for (int j = 0; j < count; ++j, ++i, ++fi, ++pixel_index) {
+		const int my_heat = frame.heat[i];
+		const int my_conductivity = frame.conductivity[i];
+
+		int total = (my_heat * (conductivity_max - my_conductivity)
+		                 * self_weight
+		             + 128)
+			>> 8;
+		int weights[4];
+		for (int k = 0; k < 4; ++k) {
+			const int ni = i + frame_offsets[k];
+			weights[k] = std::max(0, my_heat - frame.heat[ni])
+				* std::min<int>(my_conductivity, frame.conductivity[ni]);
+			total += weights[k];
 		}
+
+		// Pixels without heat or conductivity have no weights and keep
+		// their heat
+		const int divisor = std::max(total, 1);
+		int kept = my_heat;
+		int remainders = 0;
+		for (int k = 0; k < 4; ++k) {
+			const int amount = my_heat * weights[k];
+			int given = amount / divisor;
+			const int remainder = amount % divisor;
+			kept -= given;
+			remainders += remainder;
+
+			const int bits = rng.at32(4 * pixel_index + k) >> 18;
+			if (bits * divisor < remainder << 13) {
+				given += 1;
+			}
+			flows.given[k][fi] = given;
+		}
+
+		// Less the sum of the transfers, rounded
+		for (int n = 1; n < 8; n += 2) {
+			kept -= 2 * remainders >= n * divisor;
+		}
+		flows.kept[fi] = kept;
+	}
+}
+
+// The decay of the gathered heat in fixed point, by the top 16 bits of
+// at32(). Pixels outside of the world have neither heat nor conductivity,
+// so they never get any heat to decay.
+void fixedGatherRun(
+	const FlowPlanes &flows, int fi, int count, std::uint32_t pixel_index,
+	CounterRng rng, int decay_weight, std::uint8_t *out
+) {
+	for (int j = 0; j < count; ++j, ++fi, ++pixel_index) {
+		int next_heat = flows.kept[fi];
+		for (int k = 0; k < 4; ++k) {
+			next_heat += flows.given[k ^ 1][fi + flow_offsets[k]];
+		}
+
+		const int delta = next_heat * decay_weight;
+		next_heat -= delta >> 16;
+		const int bits = rng.at32(pixel_index) >> 16;
+		if (next_heat > 0 && bits < (delta & 0xffff)) {
+			next_heat -= 1;
+		}
+
+		out[j] = std::clamp<int>(next_heat, 0, PixelTag::heat_max);
 	}
+}
 
-	void executeHeatTransfer(const PixelWorld *world) {
-		const int height = world->height();
-		const int width = world->width();
+#ifdef WFORGE_X86
 
-		const int rows_per_worker = (height + num_thermal_analysis_workers - 1)
-			/ num_thermal_analysis_workers;
+WFORGE_TARGET("sse4.1")
+__m128i mix32Sse41(__m128i z) {
+	z = _mm_xor_si128(z, _mm_srli_epi32(z, 16));
+	z = _mm_mullo_epi32(z, _mm_set1_epi32(0x7feb352d));
+	z = _mm_xor_si128(z, _mm_srli_epi32(z, 15));
+	z = _mm_mullo_epi32(z, _mm_set1_epi32(0x846ca68b));
+	return _mm_xor_si128(z, _mm_srli_epi32(z, 16));
+}
+
+// Lane j draws at32() of counter + j * stride
+WFORGE_TARGET("sse4.1")
+__m128i at32Sse41(
+	CounterRng rng, std::uint32_t counter, std::uint32_t stride
+) {
+	const std::uint32_t gamma = CounterRng::golden_gamma32;
+	const std::uint32_t step = stride * gamma;
+	const __m128i z = _mm_add_epi32(
+		_mm_set1_epi32(rng.key32() + (counter + 1) * gamma),
+		_mm_setr_epi32(0, step, 2 * step, 3 * step)
+	);
+	return mix32Sse41(z);
+}
+
+WFORGE_TARGET("sse4.1")
+__m128i loadBytesSse41(const std::uint8_t *bytes) {
+	std::int32_t word;
+	std::memcpy(&word, bytes, sizeof(word));
+	return _mm_cvtepu8_epi32(_mm_cvtsi32_si128(word));
+}
+
+// Exact amount / divisor and amount % divisor for amounts below 2^24, by a
+// float reciprocal that is at most one off
+WFORGE_TARGET("sse4.1")
+__m128i divideSse41(
+	__m128i amount, __m128i divisor, __m128 reciprocal, __m128i &remainder
+) {
+	__m128i quotient = _mm_cvttps_epi32(
+		_mm_mul_ps(_mm_cvtepi32_ps(amount), reciprocal)
+	);
+	remainder = _mm_sub_epi32(amount, _mm_mullo_epi32(quotient, divisor));
 
-		// Reset and resize heat maps
-		for (auto &heat_map : _worker_heat_maps) {
-			heat_map.assign(width * height, 0);
+	const __m128i under = _mm_cmplt_epi32(remainder, _mm_setzero_si128());
+	quotient = _mm_add_epi32(quotient, under);
+	remainder = _mm_add_epi32(remainder, _mm_and_si128(under, divisor));
+
+	const __m128i over = _mm_cmpgt_epi32(
+		remainder, _mm_sub_epi32(divisor, _mm_set1_epi32(1))
+	);
+	quotient = _mm_sub_epi32(quotient, over);
+	remainder = _mm_sub_epi32(remainder, _mm_and_si128(over, divisor));
+	return quotient;
+}
+
+WFORGE_TARGET("sse4.1")
+void fixedHeatFlowsSse41(
+	const HeatFrame &frame, int i, int fi, int count,
+	std::uint32_t pixel_index, CounterRng rng, int self_weight,
+	FlowPlanes &flows
+) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i one = _mm_set1_epi32(1);
+	for (int j = 0; j < count; j += 4, i += 4, fi += 4, pixel_index += 4) {
+		const __m128i heat = loadBytesSse41(&frame.heat[i]);
+		const __m128i conductivity = loadBytesSse41(&frame.conductivity[i]);
+
+		__m128i total = _mm_mullo_epi32(
+			heat, _mm_sub_epi32(_mm_set1_epi32(conductivity_max), conductivity)
+		);
+		total = _mm_srai_epi32(
+			_mm_add_epi32(
+				_mm_mullo_epi32(total, _mm_set1_epi32(self_weight)),
+				_mm_set1_epi32(128)
+			),
+			8
+		);
+		__m128i weights[4];
+		for (int k = 0; k < 4; ++k) {
+			const int ni = i + frame_offsets[k];
+			const __m128i delta = _mm_max_epi32(
+				zero, _mm_sub_epi32(heat, loadBytesSse41(&frame.heat[ni]))
+			);
+			weights[k] = _mm_mullo_epi32(
+				delta,
+				_mm_min_epi32(
+					conductivity, loadBytesSse41(&frame.conductivity[ni])
+				)
+			);
+			total = _mm_add_epi32(total, weights[k]);
 		}
 
-		// Distribute tasks
-		for (int i = 0; i < num_thermal_analysis_workers; ++i) {
-			int y_start = i * rows_per_worker;
-			int y_end = std::min(y_start + rows_per_worker, height);
-			_workers[i]->startWork(
-				WorkPhase::HeatTransfer, world, y_start, y_end,
-				_worker_heat_maps.data()
+		const __m128i divisor = _mm_max_epi32(total, one);
+		const __m128 reciprocal = _mm_div_ps(
+			_mm_set1_ps(1.f), _mm_cvtepi32_ps(divisor)
+		);
+		__m128i kept = heat;
+		__m128i remainders = zero;
+		for (int k = 0; k < 4; ++k) {
+			__m128i remainder;
+			__m128i given = divideSse41(
+				_mm_mullo_epi32(heat, weights[k]), divisor, reciprocal,
+				remainder
+			);
+			kept = _mm_sub_epi32(kept, given);
+			remainders = _mm_add_epi32(remainders, remainder);
+
+			const __m128i bits = _mm_srli_epi32(
+				at32Sse41(rng, 4 * pixel_index + k, 4), 18
+			);
+			given = _mm_sub_epi32(
+				given,
+				_mm_cmplt_epi32(
+					_mm_mullo_epi32(bits, divisor),
+					_mm_slli_epi32(remainder, 13)
+				)
+			);
+			_mm_storeu_si128(
+				reinterpret_cast<__m128i *>(&flows.given[k][fi]), given
 			);
 		}
 
-		// Wait for completion
-		for (auto &worker : _workers) {
-			worker->waitForCompletion();
+		const __m128i twice = _mm_add_epi32(remainders, remainders);
+		for (int n = 1; n < 8; n += 2) {
+			const __m128i below = _mm_cmplt_epi32(
+				twice, _mm_mullo_epi32(divisor, _mm_set1_epi32(n))
+			);
+			kept = _mm_sub_epi32(kept, _mm_andnot_si128(below, one));
+		}
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(&flows.kept[fi]), kept);
+	}
+}
+
+WFORGE_TARGET("sse4.1")
+void fixedGatherRunSse41(
+	const FlowPlanes &flows, int fi, int count, std::uint32_t pixel_index,
+	CounterRng rng, int decay_weight, std::uint8_t *out
+) {
+	for (int j = 0; j < count; j += 4, fi += 4, pixel_index += 4) {
+		__m128i next_heat = _mm_loadu_si128(
+			reinterpret_cast<const __m128i *>(&flows.kept[fi])
+		);
+		for (int k = 0; k < 4; ++k) {
+			const int ni = fi + flow_offsets[k];
+			next_heat = _mm_add_epi32(
+				next_heat,
+				_mm_loadu_si128(
+					reinterpret_cast<const __m128i *>(&flows.given[k ^ 1][ni])
+				)
+			);
 		}
+
+		const __m128i delta = _mm_mullo_epi32(
+			next_heat, _mm_set1_epi32(decay_weight)
+		);
+		next_heat = _mm_sub_epi32(next_heat, _mm_srai_epi32(delta, 16));
+		const __m128i bits = _mm_srli_epi32(at32Sse41(rng, pixel_index, 1), 16);
+		const __m128i decays = _mm_and_si128(
+			_mm_cmpgt_epi32(next_heat, _mm_setzero_si128()),
+			_mm_cmplt_epi32(bits, _mm_and_si128(delta, _mm_set1_epi32(0xffff)))
+		);
+		next_heat = _mm_add_epi32(next_heat, decays);
+
+		next_heat = _mm_packus_epi32(next_heat, next_heat);
+		next_heat = _mm_min_epu16(
+			next_heat, _mm_set1_epi16(PixelTag::heat_max)
+		);
+		next_heat = _mm_packus_epi16(next_heat, next_heat);
+		const std::int32_t word = _mm_cvtsi128_si32(next_heat);
+		std::memcpy(out + j, &word, sizeof(word));
 	}
+}
+
+WFORGE_TARGET("avx2")
+__m256i mix32Avx2(__m256i z) {
+	z = _mm256_xor_si256(z, _mm256_srli_epi32(z, 16));
+	z = _mm256_mullo_epi32(z, _mm256_set1_epi32(0x7feb352d));
+	z = _mm256_xor_si256(z, _mm256_srli_epi32(z, 15));
+	z = _mm256_mullo_epi32(z, _mm256_set1_epi32(0x846ca68b));
+	return _mm256_xor_si256(z, _mm256_srli_epi32(z, 16));
+}
 
-	void executeHeatDecay(const PixelWorld *world) {
-		const int height = world->height();
-		const int width = world->width();
+WFORGE_TARGET("avx2")
+__m256i at32Avx2(CounterRng rng, std::uint32_t counter, std::uint32_t stride) {
+	const std::uint32_t gamma = CounterRng::golden_gamma32;
+	const std::uint32_t step = stride * gamma;
+	const __m256i z = _mm256_add_epi32(
+		_mm256_set1_epi32(rng.key32() + (counter + 1) * gamma),
+		_mm256_mullo_epi32(
+			_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(step)
+		)
+	);
+	return mix32Avx2(z);
+}
+
+WFORGE_TARGET("avx2")
+__m256i loadBytesAvx2(const std::uint8_t *bytes) {
+	return _mm256_cvtepu8_epi32(
+		_mm_loadl_epi64(reinterpret_cast<const __m128i *>(bytes))
+	);
+}
+
+WFORGE_TARGET("avx2")
+__m256i divideAvx2(
+	__m256i amount, __m256i divisor, __m256 reciprocal, __m256i &remainder
+) {
+	__m256i quotient = _mm256_cvttps_epi32(
+		_mm256_mul_ps(_mm256_cvtepi32_ps(amount), reciprocal)
+	);
+	remainder = _mm256_sub_epi32(
+		amount, _mm256_mullo_epi32(quotient, divisor)
+	);
 
-		const int rows_per_worker = (height + num_thermal_analysis_workers - 1)
-			/ num_thermal_analysis_workers;
+	const __m256i under = _mm256_cmpgt_epi32(
+		_mm256_setzero_si256(), remainder
+	);
+	quotient = _mm256_add_epi32(quotient, under);
+	remainder = _mm256_add_epi32(remainder, _mm256_and_si256(under, divisor));
 
-		// Distribute tasks
-		for (int i = 0; i < num_thermal_analysis_workers; ++i) {
-			int y_start = i * rows_per_worker;
-			int y_end = std::min(y_start + rows_per_worker, height);
-			_workers[i]->startWork(
-				WorkPhase::HeatDecay, world, y_start, y_end,
-				_worker_heat_maps.data()
+	const __m256i over = _mm256_cmpgt_epi32(
+		remainder, _mm256_sub_epi32(divisor, _mm256_set1_epi32(1))
+	);
+	quotient = _mm256_sub_epi32(quotient, over);
+	remainder = _mm256_sub_epi32(remainder, _mm256_and_si256(over, divisor));
+	return quotient;
+}
+
+WFORGE_TARGET("avx2")
+void fixedHeatFlowsAvx2(
+	const HeatFrame &frame, int i, int fi, int count,
+	std::uint32_t pixel_index, CounterRng rng, int self_weight,
+	FlowPlanes &flows
+) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i one = _mm256_set1_epi32(1);
+	for (int j = 0; j < count; j += 8, i += 8, fi += 8, pixel_index += 8) {
+		const __m256i heat = loadBytesAvx2(&frame.heat[i]);
+		const __m256i conductivity = loadBytesAvx2(&frame.conductivity[i]);
+
+		__m256i total = _mm256_mullo_epi32(
+			heat,
+			_mm256_sub_epi32(_mm256_set1_epi32(conductivity_max), conductivity)
+		);
+		total = _mm256_srai_epi32(
+			_mm256_add_epi32(
+				_mm256_mullo_epi32(total, _mm256_set1_epi32(self_weight)),
+				_mm256_set1_epi32(128)
+			),
+			8
+		);
+		__m256i weights[4];
+		for (int k = 0; k < 4; ++k) {
+			const int ni = i + frame_offsets[k];
+			const __m256i delta = _mm256_max_epi32(
+				zero, _mm256_sub_epi32(heat, loadBytesAvx2(&frame.heat[ni]))
+			);
+			weights[k] = _mm256_mullo_epi32(
+				delta,
+				_mm256_min_epi32(
+					conductivity, loadBytesAvx2(&frame.conductivity[ni])
+				)
 			);
+			total = _mm256_add_epi32(total, weights[k]);
 		}
 
-		// Wait for completion
-		for (auto &worker : _workers) {
-			worker->waitForCompletion();
+		const __m256i divisor = _mm256_max_epi32(total, one);
+		const __m256 reciprocal = _mm256_div_ps(
+			_mm256_set1_ps(1.f), _mm256_cvtepi32_ps(divisor)
+		);
+		__m256i kept = heat;
+		__m256i remainders = zero;
+		for (int k = 0; k < 4; ++k) {
+			__m256i remainder;
+			__m256i given = divideAvx2(
+				_mm256_mullo_epi32(heat, weights[k]), divisor, reciprocal,
+				remainder
+			);
+			kept = _mm256_sub_epi32(kept, given);
+			remainders = _mm256_add_epi32(remainders, remainder);
+
+			const __m256i bits = _mm256_srli_epi32(
+				at32Avx2(rng, 4 * pixel_index + k, 4), 18
+			);
+			given = _mm256_sub_epi32(
+				given,
+				_mm256_cmpgt_epi32(
+					_mm256_slli_epi32(remainder, 13),
+					_mm256_mullo_epi32(bits, divisor)
+				)
+			);
+			_mm256_storeu_si256(
+				reinterpret_cast<__m256i *>(&flows.given[k][fi]), given
+			);
 		}
+
+		const __m256i twice = _mm256_add_epi32(remainders, remainders);
+		for (int n = 1; n < 8; n += 2) {
+			const __m256i below = _mm256_cmpgt_epi32(
+				_mm256_mullo_epi32(divisor, _mm256_set1_epi32(n)), twice
+			);
+			kept = _mm256_sub_epi32(kept, _mm256_andnot_si256(below, one));
+		}
+		_mm256_storeu_si256(
+			reinterpret_cast<__m256i *>(&flows.kept[fi]), kept
+		);
 	}
+}
+
+WFORGE_TARGET("avx2")
+void fixedGatherRunAvx2(
+	const FlowPlanes &flows, int fi, int count, std::uint32_t pixel_index,
+	CounterRng rng, int decay_weight, std::uint8_t *out
+) {
+	for (int j = 0; j < count; j += 8, fi += 8, pixel_index += 8) {
+		__m256i next_heat = _mm256_loadu_si256(
+			reinterpret_cast<const __m256i *>(&flows.kept[fi])
+		);
+		for (int k = 0; k < 4; ++k) {
+			const int ni = fi + flow_offsets[k];
+			next_heat = _mm256_add_epi32(
+				next_heat,
+				_mm256_loadu_si256(
+					reinterpret_cast<const __m256i *>(&flows.given[k ^ 1][ni])
+				)
+			);
+		}
 
-	const std::vector<int> &getResults() const {
-		return _worker_heat_maps[0];
+		const __m256i delta = _mm256_mullo_epi32(
+			next_heat, _mm256_set1_epi32(decay_weight)
+		);
+		next_heat = _mm256_sub_epi32(next_heat, _mm256_srai_epi32(delta, 16));
+		const __m256i bits = _mm256_srli_epi32(
+			at32Avx2(rng, pixel_index, 1), 16
+		);
+		const __m256i decays = _mm256_and_si256(
+			_mm256_cmpgt_epi32(next_heat, _mm256_setzero_si256()),
+			_mm256_cmpgt_epi32(
+				_mm256_and_si256(delta, _mm256_set1_epi32(0xffff)), bits
+			)
+		);
+		next_heat = _mm256_add_epi32(next_heat, decays);
+
+		// Packs work within 128-bit lanes
+		__m128i packed = _mm_packus_epi32(
+			_mm256_castsi256_si128(next_heat),
+			_mm256_extracti128_si256(next_heat, 1)
+		);
+		packed = _mm_min_epu16(packed, _mm_set1_epi16(PixelTag::heat_max));
+		packed = _mm_packus_epi16(packed, packed);
+		_mm_storel_epi64(reinterpret_cast<__m128i *>(out + j), packed);
 	}
+}
 
-private:
-	std::vector<std::unique_ptr<ThermalWorker>> _workers;
+#endif // WFORGE_X86
 
-	// It seems that there is no data-race for heat maps since each worker
-	// only writes to its own rows. Why not just allocate a single heat map
-	// instead of having one per worker?
-	// Well, having one per worker avoids false sharing and cache
-	// contention, which, although consumes more memory, can significantly
-	// improve performance. The memory usage is not that large anyway. Only
-	// ~200KB per worker for a standard world. Closing a chrome tab frees much
-	// more memory than that :)
-	std::array<std::vector<int>, num_thermal_analysis_workers>
-		_worker_heat_maps;
+// The runs of a fixed point kernel
+struct FixedHeatKernel {
+	FlowsOfRun flows;
+	GatherRun gather;
+	int width; // of the runs
 };
 
-// Global thread pool instance
-ThermalWorkerPool &getThermalWorkerPool() {
-	static ThermalWorkerPool pool;
-	return pool;
+FixedHeatKernel fixedHeatKernelOf(HeatKernel kernel) noexcept {
+	switch (kernel) {
+#ifdef WFORGE_X86
+	case HeatKernel::SSE41:
+		return {fixedHeatFlowsSse41, fixedGatherRunSse41, 4};
+
+	case HeatKernel::AVX2:
+		return {fixedHeatFlowsAvx2, fixedGatherRunAvx2, 8};
+#endif
+
+	default:
+		return {fixedHeatFlowsOf, fixedGatherRun, 1};
+	}
+}
+
+// stepHeatFloat() in fixed point. The runs of kernel cover the rows of the
+// tile, the ring around it is left to the scalar kernel.
+void stepHeatFixed(
+	const PixelWorld &world, int tile_x, int tile_y,
+	const std::array<bool, 9> &is_hot,
+	std::array<std::uint8_t, PixelTile::area> &out, CounterRng transfer_rng,
+	CounterRng decay_rng, const HeatFactors &factors,
+	const FixedHeatKernel &kernel
+) {
+	static_assert(tile_size % 8 == 0);
+	const int x0 = tile_x * tile_size;
+	const int y0 = tile_y * tile_size;
+
+	HeatFrame frame;
+	loadFrame(world, tile_x, tile_y, frame);
+
+	// Only pixels of hot tiles give heat away or keep it
+	FlowPlanes flows;
+	for (int ly = -1; ly <= tile_size; ++ly) {
+		const int dy = (ly >= 0) + (ly >= tile_size);
+		const std::uint32_t row_index = (y0 + ly) * world.width() + x0;
+		const std::array<std::array<int, 3>, 3> runs = {{
+			{0, -1, 1},
+			{1, 0, tile_size},
+			{2, tile_size, 1},
+		}};
+		for (const auto &[dx, lx, count] : runs) {
+			const int fi = flowIndexOf(lx, ly);
+			if (!is_hot[dy * 3 + dx]) {
+				std::fill_n(&flows.kept[fi], count, 0);
+				for (auto &given : flows.given) {
+					std::fill_n(&given[fi], count, 0);
+				}
+				continue;
+			}
+
+			const auto flows_of = count % kernel.width == 0 ? kernel.flows
+			                                                : fixedHeatFlowsOf;
+			flows_of(
+				frame, frameIndexOf(lx, ly), fi, count, row_index + lx,
+				transfer_rng, factors.self_weight, flows
+			);
+		}
+	}
+
+	for (int ly = 0; ly < tile_size; ++ly) {
+		const std::uint32_t row_index = (y0 + ly) * world.width() + x0;
+		kernel.gather(
+			flows, flowIndexOf(0, ly), tile_size, row_index, decay_rng,
+			factors.decay_weight, &out[PixelTile::indexOf(0, ly)]
+		);
+	}
 }
 
+bool isSupportedByCpu(HeatKernel kernel) noexcept {
+#ifdef WFORGE_X86
+#if defined(__GNUC__) || defined(__clang__)
+	__builtin_cpu_init();
+	switch (kernel) {
+	case HeatKernel::SSE41:
+		return __builtin_cpu_supports("sse4.1");
+
+	case HeatKernel::AVX2:
+		return __builtin_cpu_supports("avx2");
+
+	default:
+		return true;
+	}
+#else
+	int info[4];
+	__cpuid(info, 1);
+	const bool has_sse41 = info[2] & (1 << 19);
+	// The OS has to save the upper halves of the registers as well
+	const bool has_avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28))
+		&& (_xgetbv(0) & 6) == 6;
+	__cpuidex(info, 7, 0);
+	const bool has_avx2 = has_avx && (info[1] & (1 << 5));
+	switch (kernel) {
+	case HeatKernel::SSE41:
+		return has_sse41;
+
+	case HeatKernel::AVX2:
+		return has_avx2;
+
+	default:
+		return true;
+	}
+#endif
+#else
+	return kernel == HeatKernel::Float || kernel == HeatKernel::Scalar;
+#endif
+}
+
+HeatKernel widestHeatKernel() noexcept {
+	for (auto kernel : {HeatKernel::AVX2, HeatKernel::SSE41}) {
+		if (isSupportedByCpu(kernel)) {
+			return kernel;
+		}
+	}
+	return HeatKernel::Scalar;
+}
+
+std::atomic<HeatKernel> heat_kernel = widestHeatKernel();
 } // namespace
 
+void PixelWorld::setHeatKernel(HeatKernel kernel) noexcept {
+	if (!isHeatKernelSupported(kernel)) {
+		kernel = HeatKernel::Scalar;
+	}
+	heat_kernel.store(kernel, std::memory_order_relaxed);
+}
+
+HeatKernel PixelWorld::heatKernel() noexcept {
+	return heat_kernel.load(std::memory_order_relaxed);
+}
+
+bool PixelWorld::isHeatKernelSupported(HeatKernel kernel) noexcept {
+	return isSupportedByCpu(kernel);
+}
+
 void PixelWorld::thermalAnalysisStep() noexcept {
-	auto &pool = getThermalWorkerPool();
+	// Only tiles holding heat give any away, so only they and their
+	// neighbors can change. Heat is only looked for in the tiles that held
+	// some last time and the ones written to since.
+	std::vector<int> hot_tiles;
+	std::vector<char> is_hot(_chunks_x * _chunks_y, false);
+	for (int t : _hot_tiles) {
+		is_hot[t] = true;
+	}
+	for (int ty = 0; ty < _chunks_y; ++ty) {
+		for (int tx = 0; tx < _chunks_x; ++tx) {
+			const int t = ty * _chunks_x + tx;
+			auto &slot = _tiles[(ty + 1) * (_chunks_x + 2) + tx + 1];
+			if (!slot.touched && !is_hot[t]) {
+				continue;
+			}
 
-	// Heat transfer - parallel computation using thread pool
-	pool.executeHeatTransfer(this);
+			slot.touched = false;
+			is_hot[t] = !slot.uniform && !slot.paged && slot.tile->hasHeat();
+			if (is_hot[t]) {
+				hot_tiles.push_back(t);
+			}
+		}
+	}
+	_hot_tiles = hot_tiles;
+
+	// Drawn even if nothing is hot, so that the generator does not depend on
+	// the heat in the world
+	const auto rng = nextCounterRng();
+	if (hot_tiles.empty()) {
+		return;
+	}
 
-	// Heat decay - parallel computation using thread pool
-	pool.executeHeatDecay(this);
+	std::vector<int> warm_tiles;
+	std::vector<char> is_warm(_chunks_x * _chunks_y, false);
+	for (int t : hot_tiles) {
+		const int tx = t % _chunks_x;
+		const int ty = t / _chunks_x;
+		for (int y = std::max(ty - 1, 0); y <= std::min(ty + 1, _chunks_y - 1);
+		     ++y) {
+			for (int x = std::max(tx - 1, 0);
+			     x <= std::min(tx + 1, _chunks_x - 1); ++x) {
+				if (!is_warm[y * _chunks_x + x]) {
+					is_warm[y * _chunks_x + x] = true;
+					warm_tiles.push_back(y * _chunks_x + x);
+				}
+			}
+		}
+	}
 
-	// Apply final results
-	const auto &next_heat = pool.getResults();
-	for (int i = 0; i < _width * _height; ++i) {
-		_tags[i].heat = next_heat[i];
+	ThermalPoolLease lease;
+	auto &pool = lease.pool();
+	pool.prepare(warm_tiles.size());
+
+	// Heat transfer and decay in one go, each warm tile gathers what flows
+	// into it, so workers only write their own output
+	const auto transfer_rng = rng.substream(0);
+	const auto decay_rng = rng.substream(1);
+	const auto kernel = heatKernel();
+	const auto fixed_kernel = fixedHeatKernelOf(kernel);
+	const auto factors = heatFactorsOf(_thermal_interval);
+	pool.execute(warm_tiles.size(), [&](int i) {
+		const int tx = warm_tiles[i] % _chunks_x;
+		const int ty = warm_tiles[i] / _chunks_x;
+		std::array<bool, 9> is_hot_around{};
+		for (int dy = -1; dy <= 1; ++dy) {
+			for (int dx = -1; dx <= 1; ++dx) {
+				const int x = tx + dx;
+				const int y = ty + dy;
+				is_hot_around[(dy + 1) * 3 + dx + 1] = x >= 0 && x < _chunks_x
+					&& y >= 0 && y < _chunks_y && is_hot[y * _chunks_x + x];
+			}
+		}
+
+		if (kernel == HeatKernel::Float) {
+			stepHeatFloat(
+				*this, tx, ty, is_hot_around, pool.nextHeatOf(i),
+				transfer_rng, decay_rng, factors
+			);
+		} else {
+			stepHeatFixed(
+				*this, tx, ty, is_hot_around, pool.nextHeatOf(i),
+				transfer_rng, decay_rng, factors, fixed_kernel
+			);
+		}
+	});
+
+	// Apply final results. Tiles whose heat stays the same are not written,
+	// so that they stay shared with forks and out of the next search.
+	constexpr auto heat_mask = _plane::Heat::byte_mask;
+	for (std::size_t i = 0; i < warm_tiles.size(); ++i) {
+		const int x0 = warm_tiles[i] % _chunks_x * chunk_size;
+		const int y0 = warm_tiles[i] / _chunks_x * chunk_size;
+		const auto &next_heat = pool.nextHeatOf(i);
+		const auto &heat = tileOf(x0, y0).heat;
+		bool changed = false;
+		for (int j = 0; j < PixelTile::area; ++j) {
+			changed |= (heat[j] & heat_mask) != next_heat[j];
+		}
+		if (!changed) {
+			continue;
+		}
+
+		auto &tile = mutableTileOf(x0, y0);
+		for (int y = y0; y < std::min(y0 + chunk_size, _height); ++y) {
+			for (int x = x0; x < std::min(x0 + chunk_size, _width); ++x) {
+				const int j = localIndexOf(x, y);
+				if ((tile.heat[j] & heat_mask) != next_heat[j]) {
+					tile.heat[j] = (tile.heat[j] & ~heat_mask) | next_heat[j];
+					markActive(x, y);
+				}
+			}
+		}
 	}
 }
 
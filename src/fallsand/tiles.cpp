@@ -0,0 +1,295 @@
+#include "wforge/elements.h"
+#include "wforge/fallsand.h"
+#include "wforge/pagefile.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace wf {
+
+bool PixelTile::hasClass(PixelClass pclass) const noexcept {
+	return std::ranges::any_of(kinds, [pclass](std::uint8_t kind) {
+		return ((kind & _plane::Class::byte_mask) >> 6)
+			== static_cast<std::uint8_t>(pclass);
+	});
+}
+
+bool PixelTile::hasHeat() const noexcept {
+	return std::ranges::any_of(heat, [](std::uint8_t h) {
+		return h != 0;
+	});
+}
+
+void PixelTile::fill(PixelTag tag) noexcept {
+	for (int i = 0; i < area; ++i) {
+		tagAt(i) = tag;
+	}
+	states.fill(ElementState{});
+	laser_active.clear();
+	laser_stroke.clear();
+	external_entity_present.clear();
+	is_reflective_surface.clear();
+}
+
+namespace {
+
+// A tile can be shared as a constant if nothing would ever write to it: all
+// its pixels are the same static pixel, cold, uncharged and unflagged
+bool isUniform(const PixelTile &tile) noexcept {
+	const PixelTag tag = tile.tagAt(0);
+	if (!elementDispatchOf(tag.type).is_static) {
+		return false;
+	}
+
+	auto all_of = [](const auto &plane, auto value) {
+		return std::ranges::all_of(plane, [value](auto v) {
+			return v == value;
+		});
+	};
+
+	return all_of(tile.kinds, tile.kinds[0])
+		&& all_of(tile.colors, tile.colors[0])
+		&& all_of(tile.conductivity, tile.conductivity[0])
+		&& all_of(tile.dirty, 0) && all_of(tile.flags, 0)
+		&& all_of(tile.heat, 0) && all_of(tile.electric_power, 0)
+		&& all_of(tile.states, ElementState{}) && !tile.laser_active.any()
+		&& !tile.laser_stroke.any() && !tile.external_entity_present.any()
+		&& !tile.is_reflective_surface.any();
+}
+
+// The shared constant tile of a static pixel at rest. Never freed, there
+// are only as many of them as pixel kinds and colors in the levels.
+std::shared_ptr<PixelTile> uniformTileOf(PixelTag tag) noexcept {
+	static std::mutex mutex;
+	static std::map<std::uint32_t, std::shared_ptr<PixelTile>> tiles;
+
+	const std::uint32_t key = static_cast<std::uint32_t>(tag.type)
+		| (static_cast<std::uint32_t>(tag.pclass) << 6)
+		| (tag.color_index << 8) | (tag.thermal_conductivity << 16);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	auto &tile = tiles[key];
+	if (!tile) {
+		tile = std::make_shared<PixelTile>();
+		tile->fill(tag);
+	}
+	return tile;
+}
+
+} // namespace
+
+void PixelWorld::initTiles() noexcept {
+	const PixelTag air_tag = element::Air().newTag();
+	const PixelTag void_tag = element::Void().newTag();
+	const auto air_tile = uniformTileOf(air_tag);
+	const auto void_tile = uniformTileOf(void_tag);
+
+	_tiles.resize((_chunks_x + 2) * (_chunks_y + 2));
+	for (int ty = -1; ty <= _chunks_y; ++ty) {
+		for (int tx = -1; tx <= _chunks_x; ++tx) {
+			auto &slot = _tiles[(ty + 1) * (_chunks_x + 2) + tx + 1];
+			const int x0 = tx * PixelTile::size;
+			const int y0 = ty * PixelTile::size;
+
+			// Nobody writes the ghost border, so its tiles need no copy
+			if (tx < 0 || ty < 0 || tx >= _chunks_x || ty >= _chunks_y) {
+				slot = {.tile = void_tile, .shared = false, .uniform = true};
+				continue;
+			}
+
+			if (x0 + PixelTile::size <= _width
+			    && y0 + PixelTile::size <= _height) {
+				slot = {.tile = air_tile, .shared = true, .uniform = true};
+				continue;
+			}
+
+			// Partly outside of the world
+			auto tile = std::make_shared<PixelTile>();
+			tile->fill(void_tag);
+			for (int y = y0; y < std::min(y0 + PixelTile::size, _height); ++y) {
+				for (int x = x0; x < std::min(x0 + PixelTile::size, _width);
+				     ++x) {
+					tile->tagAt(localIndexOf(x, y)) = air_tag;
+				}
+			}
+			slot = {.tile = std::move(tile)};
+		}
+	}
+}
+
+void PixelWorld::unshareTile(int tile_index) noexcept {
+	auto &slot = _tiles[tile_index];
+
+	// The other holders, e.g. a fork, are gone. Nobody else can take the
+	// tile from this world in the meantime, so the count cannot go back up.
+	// The fence orders the writes after whatever the last holder read.
+	if (!slot.uniform && !slot.paged && slot.tile.use_count() == 1) {
+		std::atomic_thread_fence(std::memory_order_acquire);
+		slot.shared = false;
+		return;
+	}
+
+	slot.tile = std::make_shared<PixelTile>(*slot.tile);
+	slot.shared = false;
+	slot.uniform = false;
+	slot.paged = false;
+	slot.colors.reset();
+}
+
+PixelWorld PixelWorld::fork() {
+	// The ghost border is never written, all other tiles are copied by
+	// whichever world writes to them first
+	for (int ty = 0; ty < _chunks_y; ++ty) {
+		for (int tx = 0; tx < _chunks_x; ++tx) {
+			_tiles[(ty + 1) * (_chunks_x + 2) + tx + 1].shared = true;
+		}
+	}
+	return PixelWorld(*this);
+}
+
+int PixelWorld::ownedTileCount() const noexcept {
+	int count = 0;
+	for (int ty = 0; ty < _chunks_y; ++ty) {
+		for (int tx = 0; tx < _chunks_x; ++tx) {
+			count += !_tiles[(ty + 1) * (_chunks_x + 2) + tx + 1].shared;
+		}
+	}
+	return count;
+}
+
+void PixelWorld::compactTile(int tile_x, int tile_y) noexcept {
+	const int tile_index = (tile_y + 1) * (_chunks_x + 2) + tile_x + 1;
+	const auto &slot = _tiles[tile_index];
+	// Paged tiles were not uniform and have not changed since
+	if (slot.uniform || slot.paged || !isUniform(*slot.tile)) {
+		return;
+	}
+
+	setUniformTile(tile_index, slot.tile->tagAt(0));
+}
+
+void PixelWorld::setUniformTile(int tile_index, PixelTag tag) noexcept {
+	_tiles[tile_index] = {
+		.tile = uniformTileOf(tag),
+		.shared = true,
+		.uniform = true,
+	};
+}
+
+void PixelWorld::compactTiles() noexcept {
+	for (int ty = 0; ty < _chunks_y; ++ty) {
+		for (int tx = 0; tx < _chunks_x; ++tx) {
+			compactTile(tx, ty);
+		}
+	}
+}
+
+bool PixelWorld::isTileAtRest(int tile_x, int tile_y) const noexcept {
+	// Pixels next to an active chunk read into it
+	for (int y = std::max(tile_y - 1, 0);
+	     y <= std::min(tile_y + 1, _chunks_y - 1); ++y) {
+		for (int x = std::max(tile_x - 1, 0);
+		     x <= std::min(tile_x + 1, _chunks_x - 1); ++x) {
+			if (!_active_rects[y * _chunks_x + x].empty()
+			    || !_next_active_rects[y * _chunks_x + x].empty()) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+void PixelWorld::compactRestingTiles() noexcept {
+	// A tile compacted next to activity would just be copied again
+	for (int ty = 0; ty < _chunks_y; ++ty) {
+		for (int tx = 0; tx < _chunks_x; ++tx) {
+			if (isTileAtRest(tx, ty)) {
+				compactTile(tx, ty);
+			}
+		}
+	}
+}
+
+void PixelWorld::setPageFile(std::shared_ptr<TilePageFile> page_file
+) noexcept {
+	_page_file = std::move(page_file);
+}
+
+int PixelWorld::pageOutTiles(
+	int focus_x, int focus_y, int keep_distance
+) noexcept {
+	if (!_page_file) {
+		return 0;
+	}
+
+	// Passes and renderToBuffer() skip paged tiles rather than read them,
+	// which only holds for tiles they would find nothing in
+	auto is_quiet = [](const PixelTile &tile) {
+		auto all_zero = [](const auto &plane) {
+			return std::ranges::all_of(plane, [](std::uint8_t v) {
+				return v == 0;
+			});
+		};
+
+		const bool burning = std::ranges::any_of(tile.flags, [](auto f) {
+			return (f & _plane::Ignited::byte_mask) != 0;
+		});
+
+		return !burning && !tile.hasClass(PixelClass::Fluid)
+			&& all_zero(tile.heat) && all_zero(tile.electric_power)
+			&& !tile.laser_active.any() && !tile.laser_stroke.any()
+			&& !tile.external_entity_present.any();
+	};
+
+	int paged = 0;
+	for (int ty = 0; ty < _chunks_y; ++ty) {
+		for (int tx = 0; tx < _chunks_x; ++tx) {
+			auto &slot = _tiles[(ty + 1) * (_chunks_x + 2) + tx + 1];
+			// A tile shared with a fork goes as well, its memory is freed
+			// once the fork lets go of it
+			if (slot.uniform || slot.paged) {
+				continue;
+			}
+
+			// Distance from the focus to the nearest pixel of the tile
+			const int x0 = tx * PixelTile::size;
+			const int y0 = ty * PixelTile::size;
+			const int dx = std::max(
+				{x0 - focus_x, focus_x - (x0 + PixelTile::size - 1), 0}
+			);
+			const int dy = std::max(
+				{y0 - focus_y, focus_y - (y0 + PixelTile::size - 1), 0}
+			);
+			if (std::max(dx, dy) <= keep_distance || !isTileAtRest(tx, ty)) {
+				continue;
+			}
+
+			compactTile(tx, ty);
+			if (slot.uniform || !is_quiet(*slot.tile)) {
+				continue;
+			}
+
+			auto stored = _page_file->store(*slot.tile);
+			if (!stored) {
+				return paged; // the file is full
+			}
+
+			auto colors = std::make_shared<decltype(PixelTile::colors)>(
+				slot.tile->colors
+			);
+			slot = {
+				.tile = std::move(stored),
+				.shared = true,
+				.paged = true,
+				.colors = std::move(colors),
+			};
+			++paged;
+		}
+	}
+	return paged;
+}
+
+} // namespace wf
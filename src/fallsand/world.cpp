@@ -3,7 +3,6 @@
 #include "wforge/elements.h"
 #include "wforge/fallsand.h"
 #include "wforge/xoroshiro.h"
-#include <SFML/Graphics/BlendMode.hpp>
 #include <algorithm>
 #include <memory>
 #include <proxy/proxy.h>
@@ -27,56 +26,78 @@ bool isDenserOrEqual(PixelType a, PixelType b) noexcept {
 	return static_cast<std::uint8_t>(a) >= static_cast<std::uint8_t>(b);
 }
 
-PixelWorld::PixelWorld() noexcept: _width(0), _height(0) {}
+namespace {
+
+// Pixels that may change on their own even if nothing around them changed
+bool isRestless(const PixelWorld &world, int x, int y, PixelTag tag) noexcept {
+	if (tag.ignited || tag.heat > 0 || tag.electric_power > 0) {
+		return true;
+	}
+
+	// Sand is the only movable solid, sleeping fluids only wake up when
+	// something next to them changes
+	const auto &dispatch = elementDispatchOf(tag.type);
+	if (dispatch.is_asleep) {
+		return !dispatch.is_asleep(world, x, y, tag);
+	}
+
+	return tag.pclass != PixelClass::Solid && tag.type != PixelType::Air;
+}
+
+} // namespace
+
+thread_local DirtyRect *PixelWorld::_thread_next_active_rects = nullptr;
+thread_local std::vector<int> *PixelWorld::_thread_charged_pixels = nullptr;
+
+PixelWorld::PixelWorld() noexcept
+	: _width(0)
+	, _height(0)
+	, _chunks_x(0)
+	, _chunks_y(0)
+	, _rng(Seed::from_string("PixelWorld")) {}
 
 PixelWorld::PixelWorld(int width, int height) noexcept
 	: _width(width)
 	, _height(height)
-	, _tags(std::make_unique<PixelTag[]>(width * height))
-	, _elements(std::make_unique<PixelElement[]>(width * height))
-	, _static_tags(std::make_unique<StaticPixelTag[]>(width * height)) {
-	PixelTag airTag = element::Air().newTag();
-	for (int i = 0; i < width * height; ++i) {
-		_tags[i] = airTag;
-		_elements[i] = element::Air::create();
+	, _chunks_x((width + chunk_size - 1) / chunk_size)
+	, _chunks_y((height + chunk_size - 1) / chunk_size)
+	, _active_rects(_chunks_x * _chunks_y)
+	, _next_active_rects(_chunks_x * _chunks_y)
+	, _rng(Seed::from_string("PixelWorld")) {
+	initTiles();
+
+	// Everything is active in the first step
+	for (int cy = 0; cy < _chunks_y; ++cy) {
+		for (int cx = 0; cx < _chunks_x; ++cx) {
+			_next_active_rects[cy * _chunks_x + cx].expand(
+				cx * chunk_size, cy * chunk_size,
+				std::min((cx + 1) * chunk_size, width) - 1,
+				std::min((cy + 1) * chunk_size, height) - 1
+			);
+		}
 	}
 }
 
-PixelTag PixelWorld::tagOf(int x, int y) const noexcept {
 #ifndef NDEBUG
-	if (x < 0 || x >= _width || y < 0 || y >= _height) {
+void PixelWorld::_checkBounds(const char *func, int x, int y) const noexcept {
+	if (x < -ghost_border || x >= _width + ghost_border || y < -ghost_border
+	    || y >= _height + ghost_border) {
 		std::cerr << std::format(
-			"PixelWorld::tagOf: index out of bounds: x = {}, y = {}, width = "
-			"{}, height = {}\n",
-			x, y, _width, _height
+			"PixelWorld::{}: index out of bounds: x = {}, y = {}, width = {}, "
+			"height = {}\n",
+			func, x, y, _width, _height
 		);
 		cpptrace::generate_trace().print();
 		std::abort();
 	}
-#endif
-	return _tags[y * _width + x];
 }
-
-PixelTag &PixelWorld::tagOf(int x, int y) noexcept {
-#ifndef NDEBUG
-	if (x < 0 || x >= _width || y < 0 || y >= _height) {
-		std::cerr << std::format(
-			"PixelWorld::tagOf: index out of bounds: x = {}, y = {}, width = "
-			"{}, height = {}\n",
-			x, y, _width, _height
-		);
-		cpptrace::generate_trace().print();
-		std::abort();
-	}
 #endif
-	return _tags[y * _width + x];
-}
 
-PixelElement &PixelWorld::elementOf(int x, int y) noexcept {
+ElementState &PixelWorld::stateOf(int x, int y) noexcept {
 #ifndef NDEBUG
 	if (x < 0 || x >= _width || y < 0 || y >= _height) {
 		std::cerr << std::format(
-			"PixelWorld::elementOf: index out of bounds: x = {}, y = {}, width "
+			"PixelWorld::stateOf: index out of bounds: x = {}, y = {}, width "
 			"= "
 			"{}, height = {}\n",
 			x, y, _width, _height
@@ -85,7 +106,7 @@ PixelElement &PixelWorld::elementOf(int x, int y) noexcept {
 		std::abort();
 	}
 #endif
-	return _elements[y * _width + x];
+	return uncheckedStateOf(x, y);
 }
 
 StaticPixelTag PixelWorld::staticTagOf(int x, int y) const noexcept {
@@ -100,10 +121,10 @@ StaticPixelTag PixelWorld::staticTagOf(int x, int y) const noexcept {
 		std::abort();
 	}
 #endif
-	return _static_tags[y * _width + x];
+	return tileOf(x, y).staticTagAt(localIndexOf(x, y));
 }
 
-StaticPixelTag &PixelWorld::staticTagOf(int x, int y) noexcept {
+StaticPixelTagRef PixelWorld::staticTagOf(int x, int y) noexcept {
 #ifndef NDEBUG
 	if (x < 0 || x >= _width || y < 0 || y >= _height) {
 		std::cerr << std::format(
@@ -115,15 +136,15 @@ StaticPixelTag &PixelWorld::staticTagOf(int x, int y) noexcept {
 		std::abort();
 	}
 #endif
-	return _static_tags[y * _width + x];
+	return mutableTileOf(x, y).staticTagAt(localIndexOf(x, y));
 }
 
 void PixelWorld::activateLaserAt(int x, int y) noexcept {
-	auto &stag = staticTagOf(x, y);
-	stag.laser_active = true;
-	for (auto [nx, ny] : neighbors4({x, y}, {_width, _height})) {
-		auto &nstag = staticTagOf(nx, ny);
-		nstag.laser_stroke = true;
+	staticTagOf(x, y).laser_active = true;
+	for (auto [dx, dy] : neighbor4_offsets) {
+		if (inBounds(x + dx, y + dy)) {
+			staticTagOf(x + dx, y + dy).laser_stroke = true;
+		}
 	}
 }
 
@@ -134,32 +155,37 @@ bool PixelWorld::isExternalEntityPresent(int x, int y) const noexcept {
 void PixelWorld::swapPixels(int x1, int y1, int x2, int y2) noexcept {
 	using std::swap; // ADL two steps
 	swap(tagOf(x1, y1), tagOf(x2, y2));
-	swap(elementOf(x1, y1), elementOf(x2, y2));
+	swap(stateOf(x1, y1), stateOf(x2, y2));
+	markActive(x1, y1);
+	markActive(x2, y2);
 }
 
 void PixelWorld::swapFluids(int x1, int y1, int x2, int y2) noexcept {
 	// std::swap doesn't work for bitfields
-	auto &tag1 = tagOf(x1, y1);
-	auto &tag2 = tagOf(x2, y2);
+	auto tag1 = tagOf(x1, y1);
+	auto tag2 = tagOf(x2, y2);
 	int t = tag1.fluid_dir;
 	tag1.fluid_dir = tag2.fluid_dir;
 	tag2.fluid_dir = t;
 
 	using std::swap; // ADL two steps
 	swap(tag1, tag2);
-	swap(elementOf(x1, y1), elementOf(x2, y2));
+	swap(stateOf(x1, y1), stateOf(x2, y2));
+	markActive(x1, y1);
+	markActive(x2, y2);
 }
 
 void PixelWorld::replacePixel(int x, int y, PixelElement new_pixel) noexcept {
-	tagOf(x, y) = new_pixel->newTag();
-	elementOf(x, y) = std::move(new_pixel);
+	PixelTag new_tag = new_pixel->newTag();
+	replacePixel(x, y, std::move(new_pixel), new_tag);
 }
 
 void PixelWorld::replacePixel(
 	int x, int y, PixelElement new_pixel, PixelTag new_tag
 ) noexcept {
 	tagOf(x, y) = new_tag;
-	elementOf(x, y) = std::move(new_pixel);
+	stateOf(x, y) = new_pixel->newState();
+	markActive(x, y);
 }
 
 void PixelWorld::replacePixelWithAir(int x, int y) noexcept {
@@ -167,7 +193,70 @@ void PixelWorld::replacePixelWithAir(int x, int y) noexcept {
 }
 
 void PixelWorld::chargeElement(int x, int y) noexcept {
-	elementOf(x, y)->onCharge(*this, x, y);
+	bool was_charged = tagOf(x, y).electric_power > 0;
+	elementDispatchOf(tagOf(x, y).type).on_charge(*this, x, y);
+	if (!was_charged && tagOf(x, y).electric_power > 0) {
+		auto &charged = _thread_charged_pixels ? *_thread_charged_pixels
+		                                       : _charged_pixels;
+		charged.push_back(y * _width + x);
+	}
+	markActive(x, y);
+}
+
+void PixelWorld::placePixel(
+	int x, int y, PixelTypeAndColor pixel, bool keep_heat
+) noexcept {
+	auto element = constructElementByType(pixel.type);
+	auto tag = uncheckedTagOf(x, y);
+	const unsigned int heat = tag.heat;
+	tag = element->newTag();
+	if (pixel.color_index != 255) {
+		tag.color_index = pixel.color_index;
+	}
+	if (keep_heat) {
+		tag.heat = heat;
+	}
+	uncheckedStateOf(x, y) = element->newState();
+}
+
+void PixelWorld::markActive(int x, int y) noexcept {
+	markRectActive(x, y, x, y);
+}
+
+void PixelWorld::markRectActive(int x0, int y0, int x1, int y1) noexcept {
+	x0 = std::max(x0 - 1, 0);
+	y0 = std::max(y0 - 1, 0);
+	x1 = std::min(x1 + 1, _width - 1);
+	y1 = std::min(y1 + 1, _height - 1);
+	auto *next_rects = _thread_next_active_rects
+		? _thread_next_active_rects
+		: _next_active_rects.data();
+
+	// The neighborhood may spill over into adjacent chunks
+	for (int cy = y0 / chunk_size; cy <= y1 / chunk_size; ++cy) {
+		for (int cx = x0 / chunk_size; cx <= x1 / chunk_size; ++cx) {
+			int left = cx * chunk_size;
+			int top = cy * chunk_size;
+			next_rects[cy * _chunks_x + cx].expand(
+				std::max(x0, left), std::max(y0, top),
+				std::min(x1, left + chunk_size - 1),
+				std::min(y1, top + chunk_size - 1)
+			);
+		}
+	}
+}
+
+void PixelWorld::keepActive(int x, int y) noexcept {
+	auto *next_rects = _thread_next_active_rects
+		? _thread_next_active_rects
+		: _next_active_rects.data();
+	next_rects[(y / chunk_size) * _chunks_x + x / chunk_size].expand(
+		x, y, x, y
+	);
+}
+
+bool PixelWorld::isChunkActive(int chunk_x, int chunk_y) const noexcept {
+	return !_active_rects[chunk_y * _chunks_x + chunk_x].empty();
 }
 
 bool PixelWorld::typeOfIs(int x, int y, PixelType ptype) const noexcept {
@@ -179,22 +268,153 @@ bool PixelWorld::classOfIs(int x, int y, PixelClass pclass) const noexcept {
 }
 
 void PixelWorld::resetDirtyFlags() noexcept {
-	for (int i = 0; i < _width * _height; ++i) {
-		_tags[i].dirty = false;
+	// A byte per pixel rather than a bit, chunk workers set the flags of
+	// pixels next to each other's chunks at the same time. Shared tiles are
+	// never stepped, so their flags are clear.
+	for (auto &slot : _tiles) {
+		if (!slot.shared && !slot.uniform) {
+			slot.tile->dirty.fill(0);
+		}
 	}
 }
 
-void PixelWorld::step() noexcept {
-	for (int i = 0; i < _width * _height; ++i) {
-		_static_tags[i].laser_active = false;
-		_static_tags[i].laser_stroke = false;
-		if (_tags[i].electric_power > 0) {
-			_tags[i].electric_power -= 1;
+void PixelWorld::maintenanceStep() noexcept {
+	for (std::size_t i = 0; i < _tiles.size(); ++i) {
+		const auto &slot = _tiles[i];
+		if (slot.paged) {
+			continue; // no flags, and reading would load it
+		}
+		if (slot.tile->laser_active.any() || slot.tile->laser_stroke.any()) {
+			auto &tile = mutableTile(i);
+			tile.laser_active.clear();
+			tile.laser_stroke.clear();
+		}
+	}
+	decayElectricPower();
+}
+
+void PixelWorld::decayElectricPower() noexcept {
+	std::ranges::sort(_charged_pixels);
+	auto duplicates = std::ranges::unique(_charged_pixels);
+	_charged_pixels.erase(duplicates.begin(), duplicates.end());
+
+	std::erase_if(_charged_pixels, [this](int i) {
+		const int x = i % _width;
+		const int y = i / _width;
+
+		// Replaced since it was charged
+		if (std::as_const(*this).uncheckedTagOf(x, y).electric_power == 0) {
+			return true;
+		}
+
+		auto tag = uncheckedTagOf(x, y);
+		tag.electric_power -= 1;
+		keepActive(x, y);
+		return tag.electric_power == 0;
+	});
+}
+
+void PixelWorld::setParallelStep(bool enabled) noexcept {
+	_parallel_step = enabled;
+}
+
+bool PixelWorld::isParallelStep() const noexcept {
+	return _parallel_step;
+}
+
+void PixelWorld::setFluidInterval(int interval) noexcept {
+	_fluid_interval = std::clamp(interval, 1, max_pass_interval);
+}
+
+void PixelWorld::setThermalInterval(int interval) noexcept {
+	_thermal_interval = std::clamp(interval, 1, max_pass_interval);
+}
+
+int PixelWorld::fluidInterval() const noexcept {
+	return _fluid_interval;
+}
+
+int PixelWorld::thermalInterval() const noexcept {
+	return _thermal_interval;
+}
+
+void PixelWorld::setRng(Xoroshiro128PP rng) noexcept {
+	_rng = rng;
+}
+
+CounterRng PixelWorld::nextCounterRng() noexcept {
+	return CounterRng(_rng.next());
+}
+
+void PixelWorld::elementStep() noexcept {
+	auto &rng = Xoroshiro128PP::globalInstance();
+	for (int y = _height - 1; y >= 0; --y) {
+		bool reverse_x = (rng.next() % 2 == 0);
+		int cy = y / chunk_size;
+		for (int icx = 0; icx < _chunks_x; ++icx) {
+			int cx = reverse_x ? (_chunks_x - 1 - icx) : icx;
+			const auto rect = _active_rects[cy * _chunks_x + cx];
+			if (rect.empty() || y < rect.y_min || y > rect.y_max
+			    || isTileUniform(cx, cy)) {
+				continue;
+			}
+
+			for (int ix = rect.x_min; ix <= rect.x_max; ++ix) {
+				stepPixel(reverse_x ? (rect.x_max + rect.x_min - ix) : ix, y);
+			}
+		}
+	}
+}
+
+void PixelWorld::stepChunk(int chunk_index) noexcept {
+	const auto rect = _active_rects[chunk_index];
+	auto &rng = Xoroshiro128PP::globalInstance();
+	for (int y = rect.y_max; y >= rect.y_min; --y) {
+		bool reverse_x = (rng.next() % 2 == 0);
+		for (int ix = rect.x_min; ix <= rect.x_max; ++ix) {
+			stepPixel(reverse_x ? (rect.x_max + rect.x_min - ix) : ix, y);
+		}
+	}
+}
+
+void PixelWorld::stepPixel(int x, int y) noexcept {
+	// Read first, static pixels are left alone so that their tiles may stay
+	// shared
+	const PixelWorld &view = *this;
+	for (;;) {
+		const PixelTag tag = view.uncheckedTagOf(x, y);
+		const auto &dispatch = elementDispatchOf(tag.type);
+		if (tag.dirty || dispatch.is_static) {
+			break;
 		}
+
+		// Stepping it would change nothing, see EmptySubsElement::isAsleep()
+		if (dispatch.is_asleep && dispatch.is_asleep(view, x, y, tag)) {
+			break;
+		}
+
+		uncheckedTagOf(x, y).dirty = true;
+		dispatch.step(*this, x, y);
 	}
 
-	fluidAnalysisStep();
-	thermalAnalysisStep();
+	if (isRestless(view, x, y, view.uncheckedTagOf(x, y))) {
+		keepActive(x, y);
+	}
+}
+
+void PixelWorld::step() noexcept {
+	// Elements and passes on this thread draw from the world's generator
+	ScopedThreadRng bind_rng(_rng);
+
+	maintenanceStep();
+	const std::uint64_t fluid_interval = _fluid_interval;
+	const std::uint64_t thermal_interval = _thermal_interval;
+	if (_steps % fluid_interval == 0) {
+		fluidAnalysisStep();
+	}
+	if (_steps % thermal_interval == thermal_interval / 2) {
+		thermalAnalysisStep();
+	}
 
 	std::vector<StructureEntity> next_structures;
 	next_structures.reserve(_structures.size());
@@ -205,24 +425,29 @@ void PixelWorld::step() noexcept {
 	}
 	_structures = std::move(next_structures);
 
-	auto &rng = Xoroshiro128PP::globalInstance();
-	for (int y = _height - 1; y >= 0; --y) {
-		bool reverse_x = (rng.next() % 2 == 0);
-		for (int ix = 0; ix < _width; ++ix) {
-			int x = reverse_x ? (_width - 1 - ix) : ix;
-			while (!tagOf(x, y).dirty) {
-				tagOf(x, y).dirty = true;
-				elementOf(x, y)->step(*this, x, y);
-			}
-		}
+	// Only chunks changed since the last step are updated, changes made from
+	// now on are collected for the next step
+	std::swap(_active_rects, _next_active_rects);
+	std::ranges::fill(_next_active_rects, DirtyRect{});
+
+	if (_parallel_step) {
+		parallelElementStep();
+	} else {
+		elementStep();
 	}
 
 	resetDirtyFlags();
+
+	if (++_steps % compaction_interval == 0) {
+		compactRestingTiles();
+	}
 }
 
 void PixelWorld::resetEntityPresenceTags() noexcept {
-	for (int i = 0; i < _width * _height; ++i) {
-		_static_tags[i].external_entity_present = false;
+	for (std::size_t i = 0; i < _tiles.size(); ++i) {
+		if (!_tiles[i].paged && _tiles[i].tile->external_entity_present.any()) {
+			mutableTile(i).external_entity_present.clear();
+		}
 	}
 }
 
@@ -258,9 +483,26 @@ void PixelWorld::renderToBuffer(std::span<std::uint8_t> buf) const noexcept {
 
 	auto &rng = Xoroshiro128PP::globalInstance();
 	std::uniform_int_distribution<int> dist(0, 5);
-	for (int i = 0; i < _width * _height; ++i) {
+	for (int p = 0; p < _width * _height; ++p) {
+		const int x = p % _width;
+		const int y = p / _width;
+		const auto &slot = _tiles[tileIndexOf(x, y)];
+		const auto &tile = *slot.tile;
+		const int i = localIndexOf(x, y);
+
+		// A paged tile is neither burning nor charged nor lit, its colors
+		// are kept in memory so that it is not loaded back
+		if (slot.paged) {
+			const RGBAColor color = colorOfIndex((*slot.colors)[i]);
+			buf[p * 4 + 0] = color.r;
+			buf[p * 4 + 1] = color.g;
+			buf[p * 4 + 2] = color.b;
+			buf[p * 4 + 3] = color.a;
+			continue;
+		}
+
 		int color_idx;
-		if (_tags[i].ignited) {
+		if (tile.flags[i] & _plane::Ignited::byte_mask) {
 			int rd = dist(rng);
 			if (rd == 0) {
 				color_idx = colorIndexOf("Fire1");
@@ -270,25 +512,25 @@ void PixelWorld::renderToBuffer(std::span<std::uint8_t> buf) const noexcept {
 				color_idx = colorIndexOf("Fire3");
 			}
 		} else {
-			color_idx = _tags[i].color_index;
+			color_idx = tile.colors[i];
 		}
 
-		sf::Color color;
-		if (_static_tags[i].laser_active) {
+		RGBAColor color;
+		if (tile.laser_active.test(i)) {
 			color = laserBlendedColorOfIndex(color_idx);
-		} else if (_tags[i].electric_power >= render_electric_power_threshold) {
+		} else if (tile.electric_power[i] >= render_electric_power_threshold) {
 			color = colorPaletteOfIndex(color_idx).active_color;
-		} else if (_tags[i].type == PixelType::Air
-		           && _static_tags[i].laser_stroke) {
+		} else if (tile.tagAt(i).type == PixelType::Air
+		           && tile.laser_stroke.test(i)) {
 			color = colorOfName("LaserStroke");
 		} else {
 			color = colorOfIndex(color_idx);
 		}
 
-		buf[i * 4 + 0] = color.r;
-		buf[i * 4 + 1] = color.g;
-		buf[i * 4 + 2] = color.b;
-		buf[i * 4 + 3] = color.a;
+		buf[p * 4 + 0] = color.r;
+		buf[p * 4 + 1] = color.g;
+		buf[p * 4 + 2] = color.b;
+		buf[p * 4 + 3] = color.a;
 	}
 
 	for (auto &s : _structures) {
@@ -1,5 +1,4 @@
 #include "wforge/level.h"
-#include "wforge/save.h"
 #include <algorithm>
 
 namespace wf::item {
@@ -30,23 +29,4 @@ std::array<int, 2> BrushSizeChangableItem::brushTopLeft(
 	return {world_x - half_brush, world_y - half_brush};
 }
 
-void BrushSizeChangableItem::render(
-	sf::RenderTarget &target, int x, int y, int scale
-) const {
-	constexpr sf::Color outline_color = sf::Color::Red;
-
-	auto [top_left_x, top_left_y] = brushTopLeft(x, y, scale);
-	sf::RectangleShape rect;
-	rect.setPosition(sf::Vector2f(top_left_x * scale, top_left_y * scale));
-	rect.setSize(sf::Vector2f(_brush_size * scale, _brush_size * scale));
-	rect.setFillColor(sf::Color::Transparent);
-	rect.setOutlineColor(outline_color);
-
-	const auto &save = SaveData::instance();
-	rect.setOutlineThickness(
-		save.user_settings.strict_pixel_perfection ? scale : 1.f
-	);
-	target.draw(rect);
-}
-
 } // namespace wf::item
@@ -10,32 +10,17 @@ Item CopperBrush::create() noexcept {
 }
 
 bool CopperBrush::use(Level &level, int x, int y, int scale) noexcept {
-	auto &world = level.fallsand;
 	auto [top_left_x, top_left_y] = brushTopLeft(x, y, scale);
 	int brush_size = brushSize();
-	bool used = false;
-	for (int dx = 0; dx < brush_size; ++dx) {
-		int wx = top_left_x + dx;
-		if (wx < 0 || wx >= world.width()) {
-			continue;
-		}
-
-		for (int dy = 0; dy < brush_size; ++dy) {
-			int wy = top_left_y + dy;
-			if (wy < 0 || wy >= world.height()) {
-				continue;
-			}
-
-			if (!world.isExternalEntityPresent(wx, wy)) {
-				auto &tag = world.tagOf(wx, wy);
-				int old_heat = tag.heat;
-				world.replacePixel(wx, wy, element::Copper::create());
-				tag.heat = old_heat;
-				used = true;
-			}
-		}
-	}
-	return used;
+	int filled = level.fallsand.fillRect(
+		top_left_x, top_left_y, brush_size, brush_size,
+		element::Copper::create(),
+		[](PixelTag, StaticPixelTag static_tag) {
+		return !static_tag.external_entity_present;
+	},
+		true // keep heat
+	);
+	return filled > 0;
 }
 
 std::string_view CopperBrush::name() const noexcept {
@@ -9,22 +9,9 @@ bool FireBrush::use(Level &level, int x, int y, int scale) noexcept {
 	auto &world = level.fallsand;
 	auto [tx, ty] = brushTopLeft(x, y, scale);
 	auto size = brushSize();
-	for (int dx = 0; dx < size; dx++) {
-		int wx = tx + dx;
-		if (wx < 0 || wx >= world.width()) {
-			continue;
-		}
-
-		for (int dy = 0; dy < size; dy++) {
-			int wy = ty + dy;
-			if (wy < 0 || wy >= world.height()) {
-				continue;
-			}
-
-			auto &tag = world.tagOf(wx, wy);
-			tag.heat = PixelTag::heat_max;
-		}
-	}
+	world.paintIf(tx, ty, size, size, AnyPixel{}, [&world](int wx, int wy) {
+		world.tagOf(wx, wy).heat = PixelTag::heat_max;
+	});
 	return true;
 }
 
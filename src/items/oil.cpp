@@ -16,29 +16,15 @@ Item OilBrush::createLarge() noexcept {
 }
 
 bool OilBrush::use(Level &level, int x, int y, int scale) noexcept {
-	auto &world = level.fallsand;
 	auto [top_left_x, top_left_y] = brushTopLeft(x, y, scale);
 	int brush_size = brushSize();
-	bool used = false;
-	for (int dx = 0; dx < brush_size; ++dx) {
-		int wx = top_left_x + dx;
-		if (wx < 0 || wx >= world.width()) {
-			continue;
-		}
-
-		for (int dy = 0; dy < brush_size; ++dy) {
-			int wy = top_left_y + dy;
-			if (wy < 0 || wy >= world.height()) {
-				continue;
-			}
-
-			if (world.classOfIs(wx, wy, PixelClass::Gas)) {
-				world.replacePixel(wx, wy, element::Oil::create());
-				used = true;
-			}
-		}
+	int filled = level.fallsand.fillRect(
+		top_left_x, top_left_y, brush_size, brush_size,
+		element::Oil::create(), [](PixelTag tag, StaticPixelTag) {
+		return tag.pclass == PixelClass::Gas;
 	}
-	return used;
+	);
+	return filled > 0;
 }
 
 std::string_view OilBrush::name() const noexcept {
@@ -1,13 +1,28 @@
 #include "wforge/level.h"
-#include "wforge/colorpalette.h"
 #include "wforge/fallsand.h"
-#include "wforge/save.h"
-#include <SFML/Graphics/Texture.hpp>
-#include <SFML/System/Vector2.hpp>
-#include <cmath>
+#include "wforge/savestate.h"
+#include "wforge/xoroshiro.h"
+#include <algorithm>
+#include <array>
+#include <format>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
 
 namespace wf {
 
+namespace {
+
+std::optional<std::string> run_seed;
+
+constexpr std::array<char, 4> state_magic = {'W', 'F', 'L', 'S'};
+
+// Bump whenever what saveState() writes changes
+constexpr std::uint32_t state_version = 1;
+
+} // namespace
+
 LevelMetadata::Difficulty LevelMetadata::parseDifficulty(
 	std::string_view diff_str
 ) noexcept {
@@ -36,15 +51,147 @@ std::string_view LevelMetadata::difficultyToString(Difficulty difficulty) {
 }
 
 Level::Level(int width, int height) noexcept
-	: fallsand(width, height), _item_use_cooldown(0) {}
+	: fallsand(width, height)
+	, rng(Seed::from_string("Level"))
+	, _item_use_cooldown(0) {}
+
+Level::Level(const Level &level, PixelWorld fallsand)
+	: metadata(level.metadata)
+	, fallsand(std::move(fallsand))
+	, duck(level.duck)
+	, checkpoint(level.checkpoint)
+	, rng(level.rng)
+	, items(level.items)
+	, _active_item_index(level._active_item_index)
+	, _item_use_cooldown(level._item_use_cooldown) {}
+
+Level Level::fork() {
+	return Level(*this, fallsand.fork());
+}
+
+void Level::setRunSeed(std::string seed) {
+	run_seed = std::move(seed);
+}
+
+const std::optional<std::string> &Level::runSeed() noexcept {
+	return run_seed;
+}
+
+Seed Level::seedOf(const std::string &map_id) {
+	if (!run_seed) {
+		return Seed::device_random();
+	}
+
+	return Seed::from_string((map_id + "/" + *run_seed).c_str());
+}
+
+void Level::seed(Seed seed) noexcept {
+	rng = Xoroshiro128PP(seed);
+	fallsand.setRng(rng.jump_96());
+}
 
 void Level::step() {
+	ScopedThreadRng bind_rng(rng);
 	_item_use_cooldown = std::max(0, _item_use_cooldown - 1);
 	fallsand.resetEntityPresenceTags();
 	duck.commitEntityPresence(fallsand);
 	fallsand.step();
 	duck.step(*this);
 	checkpoint.step(*this);
+
+	if (fallsand.stepCount() % page_out_interval == 0) {
+		fallsand.pageOutTiles(
+			duck.position.x + duck.width() / 2,
+			duck.position.y + duck.height() / 2, page_keep_distance
+		);
+	}
+}
+
+std::vector<std::uint8_t> Level::saveState() const {
+	StateWriter out;
+	out.write(state_magic);
+	out.write(state_version);
+	out.writeString(metadata.map_id);
+	writeState(out);
+	return out.takeBytes();
+}
+
+void Level::writeState(StateWriter &out, bool with_tiles) const {
+	fallsand.saveState(out, with_tiles);
+	out.write(duck.position);
+	out.write(duck.velocity);
+	checkpoint.saveState(out);
+	out.write(rng.state());
+
+	out.write<std::int32_t>(items.size());
+	for (const auto &stack : items) {
+		out.write<std::int32_t>(stack.amount);
+		out.write<std::int32_t>(stack.item->brushSize());
+	}
+	out.write<std::int32_t>(_active_item_index);
+	out.write<std::int32_t>(_item_use_cooldown);
+}
+
+void Level::loadState(std::span<const std::uint8_t> state) {
+	StateReader in(state);
+	if (in.read<std::array<char, 4>>() != state_magic) {
+		throw std::runtime_error("Not a save state of a level");
+	}
+
+	const auto version = in.read<std::uint32_t>();
+	if (version != state_version) {
+		throw std::runtime_error(
+			std::format(
+				"Save state version {} is not supported, expected {}", version,
+				state_version
+			)
+		);
+	}
+
+	const auto map_id = in.readString();
+	if (map_id != metadata.map_id) {
+		throw std::runtime_error(
+			std::format(
+				"Save state of map '{}' does not fit map '{}'", map_id,
+				metadata.map_id
+			)
+		);
+	}
+
+	readState(in);
+	if (!in.atEnd()) {
+		throw std::runtime_error("Corrupt save state: trailing bytes");
+	}
+}
+
+void Level::readState(StateReader &in, bool with_tiles) {
+	fallsand.loadState(in, with_tiles);
+	duck.position = in.read<Vec2f>();
+	duck.velocity = in.read<Vec2f>();
+	checkpoint.loadState(in);
+	rng = Xoroshiro128PP(in.read<Seed>());
+
+	const auto num_items = in.read<std::int32_t>();
+	if (num_items != static_cast<int>(items.size())) {
+		throw std::runtime_error(
+			std::format(
+				"Save state with {} items does not fit a level with {}",
+				num_items, items.size()
+			)
+		);
+	}
+	for (auto &stack : items) {
+		stack.amount = in.read<std::int32_t>();
+		if (stack.amount < 0) {
+			throw std::runtime_error("Corrupt save state: negative item count");
+		}
+
+		const auto brush_size = in.read<std::int32_t>();
+		stack.item->changeBrushSize(brush_size - stack.item->brushSize());
+	}
+	_active_item_index = in.read<std::int32_t>();
+	_item_use_cooldown = in.read<std::int32_t>();
+	_normalizeActiveItemIndex();
 }
 
 ItemStack *Level::activeItemStack() noexcept {
@@ -62,6 +209,7 @@ void Level::useActiveItem(int x, int y, int scale) noexcept {
 		return;
 	}
 
+	ScopedThreadRng bind_rng(rng);
 	if (auto itemstack = activeItemStack()) {
 		if (itemstack->item->use(*this, x, y, scale)) {
 			// item used successfully, decrease quantity
@@ -148,138 +296,4 @@ bool Level::isCompleted() const noexcept {
 	return checkpoint.isCompleted();
 }
 
-LevelRenderer::LevelRenderer(Level &level)
-	: _level(level)
-	, _fallsand_buffer(
-		  std::make_unique<std::uint8_t[]>(level.width() * level.height() * 4)
-	  )
-	, _fallsand_texture()
-	, _fallsand_sprite(_fallsand_texture)
-	, _heat_buffer(
-		  std::make_unique<std::uint8_t[]>(level.width() * level.height() * 4)
-	  )
-	, _heat_texture()
-	, _heat_sprite(_heat_texture)
-	, _duck_sprite(
-		  AssetsManager::instance().getAsset<sf::Texture>("duck/texture")
-	  )
-	, _font(AssetsManager::instance().getAsset<PixelFont>("font")) {
-	if (!_fallsand_texture.resize(
-			sf::Vector2u(level.width(), level.height())
-		)) {
-		throw std::runtime_error("Failed to create fallsand texture");
-	}
-	_fallsand_texture.setSmooth(false);
-	_fallsand_sprite = sf::Sprite(_fallsand_texture);
-
-	if (!_heat_texture.resize(sf::Vector2u(level.width(), level.height()))) {
-		throw std::runtime_error("Failed to create heat texture");
-	}
-	_heat_texture.setSmooth(false);
-	_heat_sprite = sf::Sprite(_heat_texture);
-}
-
-void LevelRenderer::_renderFallsand(sf::RenderTarget &target) {
-	std::span<std::uint8_t> fallsand_buffer_view(
-		_fallsand_buffer.get(), _level.width() * _level.height() * 4
-	);
-	_level.fallsand.renderToBuffer(fallsand_buffer_view);
-	_fallsand_texture.update(_fallsand_buffer.get());
-	target.draw(_fallsand_sprite);
-}
-
-void LevelRenderer::_renderHeat(sf::RenderTarget &target) {
-#ifndef NDEBUG
-	// Render heat overlay (semi-transparent red, brighter = hotter)
-	const int width = _level.width();
-	const int height = _level.height();
-
-	for (int y = 0; y < height; ++y) {
-		for (int x = 0; x < width; ++x) {
-			auto tag = _level.fallsand.tagOf(x, y);
-			int idx = (y * width + x) * 4;
-
-			// Heat value is 0-127, map it to red color with alpha
-			if (tag.heat > 0) {
-				// Normalize heat to 0-255 range
-				int heat_normalized = (tag.heat * 256) / PixelTag::heat_max;
-				_heat_buffer[idx + 0] = 255; // R
-				_heat_buffer[idx + 1] = 0;   // G
-				_heat_buffer[idx + 2] = 0;   // B
-				_heat_buffer[idx + 3] = heat_normalized;
-			} else {
-				_heat_buffer[idx + 0] = 0;
-				_heat_buffer[idx + 1] = 0;
-				_heat_buffer[idx + 2] = 0;
-				_heat_buffer[idx + 3] = 0;
-			}
-		}
-	}
-
-	_heat_texture.update(_heat_buffer.get());
-	target.draw(_heat_sprite);
-#endif
-}
-
-void LevelRenderer::_renderDuck(sf::RenderTarget &target, int scale) {
-	sf::Vector2f duck_pos(
-		std::round(_level.duck.position.x) * scale,
-		std::round(_level.duck.position.y) * scale
-	);
-
-	_duck_sprite.setPosition(duck_pos);
-	_duck_sprite.setScale(sf::Vector2f(scale, scale));
-	target.draw(_duck_sprite);
-}
-
-void LevelRenderer::render(
-	sf::RenderTarget &target, int mouse_x, int mouse_y, int scale
-) {
-	_fallsand_sprite.setScale(sf::Vector2f(scale, scale));
-	_heat_sprite.setScale(sf::Vector2f(scale, scale));
-	_renderFallsand(target);
-
-	// Render heat overlay if debug mode is enabled
-	if (SaveData::instance().user_settings.debug_heat_render) {
-		_renderHeat(target);
-	}
-
-	_renderDuck(target, scale);
-	_level.checkpoint.render(target, scale); // checkpoint can render itself
-	_renderItemText(target, scale);
-	if (auto itemstack = _level.activeItemStack()) {
-		itemstack->item->render(target, mouse_x, mouse_y, scale);
-	}
-}
-
-void LevelRenderer::_renderItemText(sf::RenderTarget &target, int scale) {
-	constexpr sf::Color active_color = ui_text_color(200);
-	constexpr sf::Color inactive_color = ui_text_color(120);
-	constexpr int start_x = 2;
-	constexpr int start_y = 2;
-	constexpr int line_spacing = 1;
-
-	auto active_stack = _level.activeItemStack();
-	if (!active_stack) {
-		return;
-	}
-
-	int y = start_y;
-	for (const auto &itemstack : _level.items) {
-		if (itemstack.amount <= 0) {
-			continue;
-		}
-
-		bool is_active = (itemstack.id == active_stack->id);
-		auto color = is_active ? active_color : inactive_color;
-		auto display_text = std::format(
-			"{}{}({})", is_active ? '>' : ' ', itemstack.item->name(),
-			itemstack.amount
-		);
-
-		_font.renderText(target, display_text, color, start_x, y, scale);
-		y += _font.charHeight(1) + line_spacing;
-	}
-}
-
 } // namespace wf
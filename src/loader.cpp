@@ -1,14 +1,19 @@
 #include "wforge/2d.h"
-#include "wforge/assets.h"
 #include "wforge/colorpalette.h"
 #include "wforge/elements.h"
 #include "wforge/fallsand.h"
 #include "wforge/level.h"
+#include "wforge/pagefile.h"
+#include "wforge/pixelshape.h"
 #include "wforge/structures.h"
-#include <SFML/Graphics/Image.hpp>
+#include "wforge/xoroshiro.h"
 #include <array>
+#include <exception>
 #include <format>
+#include <iostream>
 #include <proxy/v4/proxy.h>
+#include <stdexcept>
+#include <unordered_map>
 
 namespace wf {
 
@@ -16,21 +21,21 @@ namespace {
 
 constexpr int structure_marker_alpha = 231;
 
-constexpr sf::Color poi_marker_color = colorOfName("POIMarker");
-constexpr sf::Color duck_marker_color{250, 200, 46, 231};
-constexpr sf::Color checkpoint_marker_color{89, 241, 255, 231};
-constexpr sf::Color laser_emitter_marker_color{51, 255, 184, 231};
-constexpr sf::Color laser_receiver_marker_color{187, 39, 82, 231};
-constexpr sf::Color mirror_marker_color{147, 186, 201, 231};
-constexpr sf::Color pressure_plate_marker_color{240, 34, 159, 231};
-constexpr sf::Color heavy_pressure_plate_marker_color{196, 251, 3, 231};
-constexpr sf::Color power_source_marker_color{148, 168, 58, 231};
-constexpr sf::Color heater_marker_color{183, 35, 54, 231};
-constexpr sf::Color gate_marker_color{50, 50, 50, 231};
-constexpr sf::Color pnp_transistor_marker_color{179, 169, 19, 231};
-constexpr sf::Color npn_transistor_marker_color{240, 133, 168, 231};
-constexpr sf::Color water_tap_marker_color{83, 77, 128, 231};
-constexpr sf::Color oil_tap_marker_color{75, 89, 49, 231};
+constexpr RGBAColor poi_marker_color = colorOfName("POIMarker");
+constexpr RGBAColor duck_marker_color{250, 200, 46, 231};
+constexpr RGBAColor checkpoint_marker_color{89, 241, 255, 231};
+constexpr RGBAColor laser_emitter_marker_color{51, 255, 184, 231};
+constexpr RGBAColor laser_receiver_marker_color{187, 39, 82, 231};
+constexpr RGBAColor mirror_marker_color{147, 186, 201, 231};
+constexpr RGBAColor pressure_plate_marker_color{240, 34, 159, 231};
+constexpr RGBAColor heavy_pressure_plate_marker_color{196, 251, 3, 231};
+constexpr RGBAColor power_source_marker_color{148, 168, 58, 231};
+constexpr RGBAColor heater_marker_color{183, 35, 54, 231};
+constexpr RGBAColor gate_marker_color{50, 50, 50, 231};
+constexpr RGBAColor pnp_transistor_marker_color{179, 169, 19, 231};
+constexpr RGBAColor npn_transistor_marker_color{240, 133, 168, 231};
+constexpr RGBAColor water_tap_marker_color{83, 77, 128, 231};
+constexpr RGBAColor oil_tap_marker_color{75, 89, 49, 231};
 
 std::array<int, 2> convertBottomCenterToTopLeft(
 	int x, int y, int shape_width, int shape_height
@@ -68,16 +73,16 @@ Item constructItemByName(const std::string &name) {
 }
 
 PixelTypeAndColor decideMarkerBaseColor(
-	const sf::Image &img, unsigned int x, unsigned int y
+	const PixelShape &map, int x, int y
 ) {
-	constexpr unsigned int dx[] = {1, 1, 0};
-	constexpr unsigned int dy[] = {0, 1, 1};
+	constexpr int dx[] = {1, 1, 0};
+	constexpr int dy[] = {0, 1, 1};
 	PixelTypeAndColor result{PixelType::Air, 255};
 	int count = 0;
 
 	// B-M voting
 	for (int i = 0; i < 3; ++i) {
-		sf::Color check_color = img.getPixel({x + dx[i], y + dy[i]});
+		RGBAColor check_color = map.colorOf(x + dx[i], y + dy[i]);
 		auto p = pixelTypeFromColor(check_color);
 		if (p.type == result.type && p.color_index == result.color_index) {
 			count += 1;
@@ -94,17 +99,17 @@ PixelTypeAndColor decideMarkerBaseColor(
 
 template<typename T>
 StructureEntity constructStructureWithoutDirection(
-	const sf::Image &img, unsigned int x, unsigned int y
+	const PixelShape &map, int x, int y
 ) {
 	return pro::make_proxy<StructureEntityFacade, T>(x, y);
 }
 
 template<typename T>
 StructureEntity constructStructureWithDirection(
-	const sf::Image &img, unsigned int x, unsigned int y
+	const PixelShape &map, int x, int y
 ) {
-	constexpr unsigned int dx[] = {1, 1, 0};
-	constexpr unsigned int dy[] = {0, 1, 1};
+	constexpr int dx[] = {1, 1, 0};
+	constexpr int dy[] = {0, 1, 1};
 	constexpr FacingDirection directions[] = {
 		FacingDirection::East, FacingDirection::South, FacingDirection::West
 	};
@@ -112,7 +117,7 @@ StructureEntity constructStructureWithDirection(
 	auto dir = FacingDirection::North;
 	bool dir_set = false;
 	for (int i = 0; i < 3; ++i) {
-		sf::Color check_color = img.getPixel({x + dx[i], y + dy[i]});
+		RGBAColor check_color = map.colorOf(x + dx[i], y + dy[i]);
 		if (check_color == poi_marker_color) {
 			dir = directions[i];
 			if (dir_set) {
@@ -134,23 +139,16 @@ StructureEntity constructStructureWithDirection(
 
 } // namespace
 
-Level Level::loadFromAsset(const std::string &level_id) {
-	auto &metadata = AssetsManager::instance().getAsset<LevelMetadata>(
-		level_id
-	);
-	return loadFromMetadata(metadata);
-}
-
-Level Level::loadFromMetadata(LevelMetadata metadata) {
+Level Level::loadFromBitmap(LevelMetadata metadata, const PixelShape &map) {
 	constexpr int min_dimension = 50;
-	constexpr int max_dimension = 500;
-
-	const auto &image = AssetsManager::instance().getAsset<sf::Image>(
-		metadata.map_id
-	);
+	// Pixels are stored in tiles, so the area of large maps costs little
+	// beyond their content. Larger maps exceed the render texture.
+	constexpr int max_dimension = 16384;
+	// Maps from this area on page the tiles far from the duck out to disk
+	constexpr int page_file_min_area = 2048 * 2048;
 
-	auto width = image.getSize().x;
-	auto height = image.getSize().y;
+	int width = map.width();
+	int height = map.height();
 
 	if (width < min_dimension || height < min_dimension) {
 		throw std::runtime_error(
@@ -173,14 +171,27 @@ Level Level::loadFromMetadata(LevelMetadata metadata) {
 	}
 
 	Level level(width, height);
+	level.seed(seedOf(metadata.map_id));
+	ScopedThreadRng bind_rng(level.rng);
 	auto &world = level.fallsand;
+	world.setFluidInterval(metadata.fluid_interval);
+	world.setThermalInterval(metadata.thermal_interval);
+
+	if (width * height >= page_file_min_area) {
+		try {
+			world.setPageFile(TilePageFile::createTemporary());
+		} catch (const std::exception &e) {
+			std::cerr << "Warning: " << e.what()
+					  << "\nKeeping the whole map in memory.\n";
+		}
+	}
 
 	std::vector<StructureEntity> structures;
 
 	bool duck_placed = false, checkpoint_placed = false;
-	for (unsigned int y = 0; y < height; ++y) {
-		for (unsigned int x = 0; x < width; ++x) {
-			sf::Color color = image.getPixel({x, y});
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			RGBAColor color = map.colorOf(x, y);
 			if (color.a != structure_marker_alpha
 			    && color != poi_marker_color) {
 				auto ptype_color = pixelTypeFromColor(color);
@@ -228,7 +239,7 @@ Level Level::loadFromMetadata(LevelMetadata metadata) {
 			case laser_emitter_marker_color.toInteger():
 				structures.push_back(
 					constructStructureWithDirection<structure::LaserEmitter>(
-						image, x, y
+						map, x, y
 					)
 				);
 				break;
@@ -236,7 +247,7 @@ Level Level::loadFromMetadata(LevelMetadata metadata) {
 			case laser_receiver_marker_color.toInteger():
 				structures.push_back(
 					constructStructureWithDirection<structure::LaserReceiver>(
-						image, x, y
+						map, x, y
 					)
 				);
 				break;
@@ -244,7 +255,7 @@ Level Level::loadFromMetadata(LevelMetadata metadata) {
 			case mirror_marker_color.toInteger():
 				structures.push_back(
 					constructStructureWithDirection<structure::Mirror>(
-						image, x, y
+						map, x, y
 					)
 				);
 				break;
@@ -252,21 +263,21 @@ Level Level::loadFromMetadata(LevelMetadata metadata) {
 			case pressure_plate_marker_color.toInteger():
 				structures.push_back(
 					constructStructureWithoutDirection<
-						structure::PressurePlate>(image, x, y)
+						structure::PressurePlate>(map, x, y)
 				);
 				break;
 
 			case heavy_pressure_plate_marker_color.toInteger():
 				structures.push_back(
 					constructStructureWithoutDirection<
-						structure::HeavyPressurePlate>(image, x, y)
+						structure::HeavyPressurePlate>(map, x, y)
 				);
 				break;
 
 			case power_source_marker_color.toInteger():
 				structures.push_back(
 					constructStructureWithoutDirection<structure::PowerSource>(
-						image, x, y
+						map, x, y
 					)
 				);
 				break;
@@ -274,7 +285,7 @@ Level Level::loadFromMetadata(LevelMetadata metadata) {
 			case heater_marker_color.toInteger():
 				structures.push_back(
 					constructStructureWithDirection<structure::Heater>(
-						image, x, y
+						map, x, y
 					)
 				);
 				break;
@@ -282,7 +293,7 @@ Level Level::loadFromMetadata(LevelMetadata metadata) {
 			case gate_marker_color.toInteger():
 				structures.push_back(
 					constructStructureWithDirection<structure::Gate>(
-						image, x, y
+						map, x, y
 					)
 				);
 				break;
@@ -290,7 +301,7 @@ Level Level::loadFromMetadata(LevelMetadata metadata) {
 			case pnp_transistor_marker_color.toInteger():
 				structures.push_back(
 					constructStructureWithDirection<structure::TransistorPNP>(
-						image, x, y
+						map, x, y
 					)
 				);
 				break;
@@ -298,7 +309,7 @@ Level Level::loadFromMetadata(LevelMetadata metadata) {
 			case npn_transistor_marker_color.toInteger():
 				structures.push_back(
 					constructStructureWithDirection<structure::TransistorNPN>(
-						image, x, y
+						map, x, y
 					)
 				);
 				break;
@@ -306,7 +317,7 @@ Level Level::loadFromMetadata(LevelMetadata metadata) {
 			case water_tap_marker_color.toInteger():
 				structures.push_back(
 					constructStructureWithDirection<structure::WaterTap>(
-						image, x, y
+						map, x, y
 					)
 				);
 				break;
@@ -314,7 +325,7 @@ Level Level::loadFromMetadata(LevelMetadata metadata) {
 			case oil_tap_marker_color.toInteger():
 				structures.push_back(
 					constructStructureWithDirection<structure::OilTap>(
-						image, x, y
+						map, x, y
 					)
 				);
 				break;
@@ -329,12 +340,18 @@ Level Level::loadFromMetadata(LevelMetadata metadata) {
 				);
 			}
 
-			auto ptype_color = decideMarkerBaseColor(image, x, y);
+			auto ptype_color = decideMarkerBaseColor(map, x, y);
 			world.replacePixel(x, y, constructElementByType(ptype_color.type));
 			if (ptype_color.color_index != 255) {
 				world.tagOf(x, y).color_index = ptype_color.color_index;
 			}
 		}
+
+		// Share the plain tiles of each finished row of tiles right away,
+		// so that loading large maps never holds all of them
+		if ((y + 1) % PixelWorld::chunk_size == 0) {
+			world.compactTiles();
+		}
 	}
 
 	if (!duck_placed) {
@@ -352,6 +369,7 @@ Level Level::loadFromMetadata(LevelMetadata metadata) {
 	for (auto &s : structures) {
 		world.addStructure(std::move(s));
 	}
+	world.compactTiles();
 
 	for (int i = 0; i < metadata.items.size(); ++i) {
 		auto [item_name, item_count] = metadata.items[i];
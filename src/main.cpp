@@ -1,4 +1,7 @@
 #include "wforge/assets.h"
+#include "wforge/level.h"
+#include "wforge/replay.h"
+#include "wforge/rewind.h"
 #include "wforge/save.h"
 #include "wforge/scene.h"
 #include <SFML/Audio.hpp>
@@ -6,14 +9,23 @@
 #include <SFML/Graphics/RenderTexture.hpp>
 #include <SFML/Window/Mouse.hpp>
 #include <SFML/Window/WindowEnums.hpp>
+#include <algorithm>
 #include <argparse/argparse.hpp>
+#include <chrono>
 #include <cpptrace/cpptrace.hpp>
 #include <cpptrace/from_current.hpp>
 #include <cpptrace/from_current_macros.hpp>
+#include <cstdint>
+#include <format>
 #include <iostream>
 #include <proxy/proxy.h>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 void entry(const std::string &level_id, int scale_config, bool is_first_launch);
+int runReplay(const std::string &path);
 
 std::filesystem::path wf::_executable_path;
 int main(int argc, char **argv) {
@@ -30,18 +42,6 @@ int main(int argc, char **argv) {
 		wf::_executable_path = std::filesystem::current_path();
 	}
 
-	CPPTRACE_TRY {
-		wf::AssetsManager::loadAllAssets();
-		wf::SaveData::instance(); // load / initialize save data
-	}
-	CPPTRACE_CATCH(const std::exception &e) {
-		std::cerr << "Failed to load assets: " << e.what() << "\n";
-		cpptrace::from_current_exception().print();
-		return 1;
-	}
-
-	auto &save = wf::SaveData::instance();
-
 	argparse::ArgumentParser program(
 		"waveforge", WAVEFORGE_VERSION, argparse::default_arguments::help
 	);
@@ -51,10 +51,22 @@ int main(int argc, char **argv) {
 		.default_value("-");
 
 	program.add_argument("--scale")
-		.help("Set rendering scale (0 for automatic)")
-		.default_value(save.user_settings.scale)
+		.help("Set rendering scale (0 for automatic, default from the "
+		      "settings)")
 		.scan<'i', int>();
 
+	program.add_argument("--seed")
+		.help("Seed levels from this string, replaying the same inputs gives "
+		      "the same run");
+
+	program.add_argument("--record")
+		.help("Record the inputs of the level played last into this replay "
+		      "file");
+
+	program.add_argument("--replay")
+		.help("Play a replay file back without a window as fast as possible "
+		      "and print the step and rewind times");
+
 	try {
 		program.parse_args(argc, argv);
 	} catch (const std::exception &e) {
@@ -63,9 +75,50 @@ int main(int argc, char **argv) {
 		return 1;
 	}
 
+	// Replays only load what the simulation reads, so that they run without
+	// a display or audio device
+	if (auto path = program.present("--replay")) {
+		CPPTRACE_TRY {
+			wf::AssetsManager::loadSimulationAssets();
+			return runReplay(*path);
+		}
+		CPPTRACE_CATCH(const std::exception &e) {
+			std::cerr << "Failed to replay: " << e.what() << "\n";
+			cpptrace::from_current_exception().print();
+			return 1;
+		}
+	}
+
+	CPPTRACE_TRY {
+		wf::AssetsManager::loadAllAssets();
+		wf::SaveData::instance(); // load / initialize save data
+	}
+	CPPTRACE_CATCH(const std::exception &e) {
+		std::cerr << "Failed to load assets: " << e.what() << "\n";
+		cpptrace::from_current_exception().print();
+		return 1;
+	}
+
+	auto &save = wf::SaveData::instance();
+
+	if (auto seed = program.present("--seed")) {
+		wf::Level::setRunSeed(*seed);
+	} else if (program.present("--record")) {
+		// Replays load the level with the same seed
+		const auto seed = wf::Seed::device_random();
+		wf::Level::setRunSeed(
+			std::format("{:016x}{:016x}", seed.s[0], seed.s[1])
+		);
+	}
+
+	if (auto path = program.present("--record")) {
+		wf::scene::LevelPlaying::setRecordPath(*path);
+	}
+
 	CPPTRACE_TRY {
 		entry(
-			program.get<std::string>("level"), program.get<int>("--scale"),
+			program.get<std::string>("level"),
+			program.present<int>("--scale").value_or(save.user_settings.scale),
 			save.is_first_launch()
 		);
 	}
@@ -114,3 +167,112 @@ void entry(
 		scene_mgr.tick();
 	}
 }
+
+namespace {
+
+// Total, mean, median, p99 and max of times in ms, on one line
+void printTimes(std::string_view what, std::vector<double> times) {
+	std::ranges::sort(times);
+	double total = 0;
+	for (double ms : times) {
+		total += ms;
+	}
+	auto percentile = [&](double p) {
+		return times.empty() ? 0.0 : times[(times.size() - 1) * p];
+	};
+	std::cout << std::format(
+		"  {:<6} {:>5} ticks in {:8.1f} ms: mean {:.3f} ms, median {:.3f} ms, "
+		"p99 {:.3f} ms, max {:.3f} ms\n",
+		what, times.size(), total, times.empty() ? 0.0 : total / times.size(),
+		percentile(0.5), percentile(0.99), percentile(1.0)
+	);
+}
+
+} // namespace
+
+// Step the level of the replay the way LevelPlaying does, without a window,
+// and print the time the steps took apart from the time the rewind buffer
+// took, recording ticks or stepping back. Returns 1 if the replay no longer
+// plays out the way it was recorded, the times are not comparable then.
+int runReplay(const std::string &path) {
+	using Clock = std::chrono::steady_clock;
+	using wf::ReplayInput;
+	using wf::scene::LevelPlaying;
+	auto ms_between = [](Clock::time_point start, Clock::time_point end) {
+		return std::chrono::duration<double, std::milli>(end - start).count();
+	};
+
+	const auto replay = wf::Replay::load(path);
+	const auto &level_seq =
+		wf::AssetsManager::instance().getAsset<wf::LevelSequence>(
+			"level-sequence"
+		);
+	const auto it = std::ranges::find_if(level_seq.levels, [&](auto *level) {
+		return level->map_id == replay.map_id;
+	});
+	if (it == level_seq.levels.end()) {
+		throw std::runtime_error(
+			std::format("No level has map '{}'", replay.map_id)
+		);
+	}
+
+	wf::Level::setRunSeed(replay.run_seed);
+	auto level = wf::Level::loadFromMetadata(**it);
+	level.fallsand.setParallelStep(true);
+	level.fallsand.setFluidInterval(replay.fluid_interval);
+	level.fallsand.setThermalInterval(replay.thermal_interval);
+
+	wf::RewindBuffer rewind(
+		LevelPlaying::rewind_ticks, LevelPlaying::rewind_keyframe_interval,
+		LevelPlaying::rewind_max_bytes
+	);
+	rewind.record(level);
+
+	std::vector<double> step_ms;
+	std::vector<double> rewind_ms;
+	step_ms.reserve(replay.num_ticks);
+	rewind_ms.reserve(replay.num_ticks);
+	std::uint32_t ticks_played = 0;
+	bool rewinding = false;
+	auto input = replay.inputs.begin();
+	for (std::uint32_t tick = 0; tick < replay.num_ticks; ++tick) {
+		for (; input != replay.inputs.end() && input->tick == tick; ++input) {
+			if (input->kind == ReplayInput::Kind::Rewind) {
+				rewinding = input->value != 0;
+			} else {
+				input->applyTo(level);
+			}
+		}
+
+		const auto start = Clock::now();
+		if (rewinding) {
+			rewind.stepBackward(level);
+			rewind_ms.push_back(ms_between(start, Clock::now()));
+		} else {
+			level.step();
+			const auto stepped = Clock::now();
+			rewind.record(level);
+			step_ms.push_back(ms_between(start, stepped));
+			rewind_ms.push_back(ms_between(stepped, Clock::now()));
+		}
+		++ticks_played;
+
+		if (level.isFailed() || level.isCompleted()) {
+			break;
+		}
+	}
+
+	std::cout << std::format(
+		"{} ticks of {}, rewind history of {} KiB:\n", ticks_played,
+		replay.map_id, rewind.memoryUsage() / 1024
+	);
+	printTimes("step", std::move(step_ms));
+	printTimes("rewind", std::move(rewind_ms));
+
+	if (ticks_played != replay.num_ticks
+	    || wf::Replay::digestOf(level.saveState()) != replay.end_digest) {
+		std::cerr << "Replay diverged from the recording\n";
+		return 1;
+	}
+	return 0;
+}
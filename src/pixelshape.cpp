@@ -0,0 +1,104 @@
+#include "wforge/pixelshape.h"
+#include "wforge/colorpalette.h"
+
+#ifndef NDEBUG
+#include <cpptrace/cpptrace.hpp>
+#include <format>
+#include <iostream>
+#endif
+
+namespace wf {
+
+PixelTypeAndColor pixelTypeFromColor(const RGBAColor &color) noexcept {
+	switch (color.toInteger()) {
+	case packColorByName("Air"):
+	case packColorByName("POIMarker"):
+		return {PixelType::Air, colorIndexOf("Air")};
+
+	case packColorByName("Stone1"):
+		return {PixelType::Stone, colorIndexOf("Stone1")};
+	case packColorByName("Stone2"):
+		return {PixelType::Stone, colorIndexOf("Stone2")};
+	case packColorByName("Stone3"):
+		return {PixelType::Stone, colorIndexOf("Stone3")};
+	case packColorByName("Stone4"):
+		return {PixelType::Stone, colorIndexOf("Stone4")};
+
+	case packColorByName("Wood1"):
+		return {PixelType::Wood, colorIndexOf("Wood1")};
+	case packColorByName("Wood2"):
+		return {PixelType::Wood, colorIndexOf("Wood2")};
+	case packColorByName("Wood3"):
+		return {PixelType::Wood, colorIndexOf("Wood3")};
+
+	case packColorByName("Copper1"):
+		return {PixelType::Copper, colorIndexOf("Copper1")};
+	case packColorByName("Copper2"):
+		return {PixelType::Copper, colorIndexOf("Copper2")};
+	case packColorByName("Copper3"):
+		return {PixelType::Copper, colorIndexOf("Copper3")};
+	case packColorByName("Copper4"):
+		return {PixelType::Copper, colorIndexOf("Copper4")};
+	case packColorByName("Copper5"):
+		return {PixelType::Copper, colorIndexOf("Copper5")};
+
+	case packColorByName("Sand1"):
+		return {PixelType::Sand, colorIndexOf("Sand1")};
+
+	case packColorByName("Sand2"):
+		return {PixelType::Sand, colorIndexOf("Sand2")};
+
+	case packColorByName("Water"):
+	case packColorByNameNoAlpha("Water"):
+		return {PixelType::Water, colorIndexOf("Water")};
+
+	case packColorByName("Oil"):
+	case packColorByNameNoAlpha("Oil"):
+		return {PixelType::Oil, colorIndexOf("Oil")};
+
+	default:
+		return {PixelType::Decoration, 255};
+	}
+}
+
+PixelShape::PixelShape(
+	int width, int height, const std::uint8_t *data
+) noexcept
+	: _width(width), _height(height), _data(data) {}
+
+PixelShape::PixelShape() noexcept: _width(0), _height(0), _data(nullptr) {}
+
+bool PixelShape::hasPixel(int x, int y) const noexcept {
+	if (colorOf(x, y).a == 0) {
+		return false;
+	}
+
+	return !isPOIPixel(x, y);
+}
+
+RGBAColor PixelShape::colorOf(int x, int y) const noexcept {
+#ifndef NDEBUG
+	if (x < 0 || x >= _width || y < 0 || y >= _height) {
+		std::cerr << std::format(
+			"PixelMap::colorOf: index out of bounds: x = {}, y = {}, width = "
+			"{}, height = {}\n",
+			x, y, _width, _height
+		);
+		cpptrace::generate_trace().print();
+		std::abort();
+	}
+#endif
+	// Data: size is _width * _height * 4, each pixel is 4 bytes (RGBA)
+	std::uint8_t r = _data[(y * _width + x) * 4 + 0];
+	std::uint8_t g = _data[(y * _width + x) * 4 + 1];
+	std::uint8_t b = _data[(y * _width + x) * 4 + 2];
+	std::uint8_t a = _data[(y * _width + x) * 4 + 3];
+	return RGBAColor{r, g, b, a};
+}
+
+bool PixelShape::isPOIPixel(int x, int y) const noexcept {
+	// Almost transparent red indicates POI
+	return colorOf(x, y) == colorOfName("POIMarker");
+}
+
+} // namespace wf
@@ -0,0 +1,188 @@
+#include "wforge/assets.h"
+#include "wforge/colorpalette.h"
+#include "wforge/level.h"
+#include "wforge/save.h"
+#include "wforge/scene.h"
+#include <SFML/Graphics/RectangleShape.hpp>
+#include <SFML/Graphics/Texture.hpp>
+#include <SFML/System/Vector2.hpp>
+#include <cmath>
+#include <format>
+#include <span>
+
+namespace wf {
+
+LevelRenderer::LevelRenderer(Level &level)
+	: _level(level)
+	, _fallsand_buffer(
+		  std::make_unique<std::uint8_t[]>(level.width() * level.height() * 4)
+	  )
+	, _fallsand_texture()
+	, _fallsand_sprite(_fallsand_texture)
+	, _heat_buffer(
+		  std::make_unique<std::uint8_t[]>(level.width() * level.height() * 4)
+	  )
+	, _heat_texture()
+	, _heat_sprite(_heat_texture)
+	, _duck_sprite(
+		  AssetsManager::instance().getAsset<sf::Texture>("duck/texture")
+	  )
+	, _checkpoint_sprite(
+		  AssetsManager::instance().getAsset<CheckpointSprite>(
+			  "checkpoint/sprite"
+		  )
+	  )
+	, _font(AssetsManager::instance().getAsset<PixelFont>("font")) {
+	if (!_fallsand_texture.resize(
+			sf::Vector2u(level.width(), level.height())
+		)) {
+		throw std::runtime_error("Failed to create fallsand texture");
+	}
+	_fallsand_texture.setSmooth(false);
+	_fallsand_sprite = sf::Sprite(_fallsand_texture);
+
+	if (!_heat_texture.resize(sf::Vector2u(level.width(), level.height()))) {
+		throw std::runtime_error("Failed to create heat texture");
+	}
+	_heat_texture.setSmooth(false);
+	_heat_sprite = sf::Sprite(_heat_texture);
+}
+
+void LevelRenderer::_renderFallsand(sf::RenderTarget &target) {
+	std::span<std::uint8_t> fallsand_buffer_view(
+		_fallsand_buffer.get(), _level.width() * _level.height() * 4
+	);
+	_level.fallsand.renderToBuffer(fallsand_buffer_view);
+	_fallsand_texture.update(_fallsand_buffer.get());
+	target.draw(_fallsand_sprite);
+}
+
+void LevelRenderer::_renderHeat(sf::RenderTarget &target) {
+#ifndef NDEBUG
+	// Render heat overlay (semi-transparent red, brighter = hotter)
+	const int width = _level.width();
+	const int height = _level.height();
+	const PixelWorld &world = _level.fallsand; // reading copies no tiles
+
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			PixelTag tag = world.tagOf(x, y);
+			int idx = (y * width + x) * 4;
+
+			// Heat value is 0-127, map it to red color with alpha
+			if (tag.heat > 0) {
+				// Normalize heat to 0-255 range
+				int heat_normalized = (tag.heat * 256) / PixelTag::heat_max;
+				_heat_buffer[idx + 0] = 255; // R
+				_heat_buffer[idx + 1] = 0;   // G
+				_heat_buffer[idx + 2] = 0;   // B
+				_heat_buffer[idx + 3] = heat_normalized;
+			} else {
+				_heat_buffer[idx + 0] = 0;
+				_heat_buffer[idx + 1] = 0;
+				_heat_buffer[idx + 2] = 0;
+				_heat_buffer[idx + 3] = 0;
+			}
+		}
+	}
+
+	_heat_texture.update(_heat_buffer.get());
+	target.draw(_heat_sprite);
+#endif
+}
+
+void LevelRenderer::_renderDuck(sf::RenderTarget &target, int scale) {
+	sf::Vector2f duck_pos(
+		std::round(_level.duck.position.x) * scale,
+		std::round(_level.duck.position.y) * scale
+	);
+
+	_duck_sprite.setPosition(duck_pos);
+	_duck_sprite.setScale(sf::Vector2f(scale, scale));
+	target.draw(_duck_sprite);
+}
+
+void LevelRenderer::render(
+	sf::RenderTarget &target, int mouse_x, int mouse_y, int scale
+) {
+	_fallsand_sprite.setScale(sf::Vector2f(scale, scale));
+	_heat_sprite.setScale(sf::Vector2f(scale, scale));
+	_renderFallsand(target);
+
+	// Render heat overlay if debug mode is enabled
+	if (SaveData::instance().user_settings.debug_heat_render) {
+		_renderHeat(target);
+	}
+
+	_renderDuck(target, scale);
+	_renderCheckpoint(target, scale);
+	_renderItemText(target, scale);
+	_renderBrushOutline(target, mouse_x, mouse_y, scale);
+}
+
+void LevelRenderer::_renderCheckpoint(sf::RenderTarget &target, int scale) {
+	const auto &checkpoint = _level.checkpoint;
+	_checkpoint_sprite.render(
+		target, checkpoint.x, checkpoint.y, checkpoint.progress(), scale
+	);
+}
+
+void LevelRenderer::_renderBrushOutline(
+	sf::RenderTarget &target, int mouse_x, int mouse_y, int scale
+) {
+	constexpr sf::Color outline_color = sf::Color::Red;
+
+	auto itemstack = _level.activeItemStack();
+	if (!itemstack) {
+		return;
+	}
+
+	auto [top_left_x, top_left_y] = itemstack->item->brushTopLeft(
+		mouse_x, mouse_y, scale
+	);
+	int brush_size = itemstack->item->brushSize();
+
+	sf::RectangleShape rect;
+	rect.setPosition(sf::Vector2f(top_left_x * scale, top_left_y * scale));
+	rect.setSize(sf::Vector2f(brush_size * scale, brush_size * scale));
+	rect.setFillColor(sf::Color::Transparent);
+	rect.setOutlineColor(outline_color);
+
+	const auto &save = SaveData::instance();
+	rect.setOutlineThickness(
+		save.user_settings.strict_pixel_perfection ? scale : 1.f
+	);
+	target.draw(rect);
+}
+
+void LevelRenderer::_renderItemText(sf::RenderTarget &target, int scale) {
+	constexpr sf::Color active_color = ui_text_color(200);
+	constexpr sf::Color inactive_color = ui_text_color(120);
+	constexpr int start_x = 2;
+	constexpr int start_y = 2;
+	constexpr int line_spacing = 1;
+
+	auto active_stack = _level.activeItemStack();
+	if (!active_stack) {
+		return;
+	}
+
+	int y = start_y;
+	for (const auto &itemstack : _level.items) {
+		if (itemstack.amount <= 0) {
+			continue;
+		}
+
+		bool is_active = (itemstack.id == active_stack->id);
+		auto color = is_active ? active_color : inactive_color;
+		auto display_text = std::format(
+			"{}{}({})", is_active ? '>' : ' ', itemstack.item->name(),
+			itemstack.amount
+		);
+
+		_font.renderText(target, display_text, color, start_x, y, scale);
+		y += _font.charHeight(1) + line_spacing;
+	}
+}
+
+} // namespace wf
@@ -0,0 +1,151 @@
+#include "wforge/replay.h"
+#include "wforge/level.h"
+#include "wforge/savestate.h"
+#include <array>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace wf {
+
+namespace {
+
+constexpr std::array<char, 4> replay_magic = {'W', 'F', 'R', 'P'};
+
+// Bump whenever what Replay::save() writes changes
+constexpr std::uint32_t replay_version = 2;
+
+} // namespace
+
+void ReplayInput::applyTo(Level &level) const noexcept {
+	switch (kind) {
+	case Kind::UseItem:
+		level.useActiveItem(x, y, value);
+		break;
+
+	case Kind::SelectItem:
+		level.selectItem(value);
+		break;
+
+	case Kind::PrevItem:
+		level.prevItem();
+		break;
+
+	case Kind::NextItem:
+		level.nextItem();
+		break;
+
+	case Kind::ChangeBrushSize:
+		level.changeActiveItemBrushSize(value);
+		break;
+
+	case Kind::Rewind:
+		break;
+	}
+}
+
+std::uint64_t Replay::digestOf(std::span<const std::uint8_t> bytes
+) noexcept {
+	// FNV-1a
+	std::uint64_t digest = 0xcbf29ce484222325;
+	for (std::uint8_t byte : bytes) {
+		digest = (digest ^ byte) * 0x100000001b3;
+	}
+	return digest;
+}
+
+void Replay::save(const std::filesystem::path &path) const {
+	StateWriter out;
+	out.write(replay_magic);
+	out.write(replay_version);
+	out.writeString(map_id);
+	out.writeString(run_seed);
+	out.write(fluid_interval);
+	out.write(thermal_interval);
+	out.write(num_ticks);
+	out.write(end_digest);
+
+	out.write<std::uint32_t>(inputs.size());
+	for (const auto &input : inputs) {
+		out.write(input.tick);
+		out.write(input.kind);
+		out.write(input.value);
+		out.write(input.x);
+		out.write(input.y);
+	}
+
+	std::ofstream file(path, std::ios::binary);
+	const auto &bytes = out.bytes();
+	file.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+	if (!file) {
+		throw std::runtime_error(
+			std::format("Failed to write replay '{}'", path.string())
+		);
+	}
+}
+
+Replay Replay::load(const std::filesystem::path &path) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		throw std::runtime_error(
+			std::format("Failed to open replay '{}'", path.string())
+		);
+	}
+	const std::vector<std::uint8_t> bytes(
+		(std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>()
+	);
+
+	StateReader in(bytes);
+	if (in.read<std::array<char, 4>>() != replay_magic) {
+		throw std::runtime_error(
+			std::format("'{}' is not a replay", path.string())
+		);
+	}
+
+	const auto version = in.read<std::uint32_t>();
+	if (version != replay_version) {
+		throw std::runtime_error(
+			std::format(
+				"Replay version {} is not supported, expected {}", version,
+				replay_version
+			)
+		);
+	}
+
+	Replay replay;
+	replay.map_id = in.readString();
+	replay.run_seed = in.readString();
+	replay.fluid_interval = in.read<std::int32_t>();
+	replay.thermal_interval = in.read<std::int32_t>();
+	replay.num_ticks = in.read<std::uint32_t>();
+	replay.end_digest = in.read<std::uint64_t>();
+
+	const auto num_inputs = in.read<std::uint32_t>();
+	std::uint32_t last_tick = 0;
+	for (std::uint32_t i = 0; i < num_inputs; ++i) {
+		ReplayInput input{
+			.tick = in.read<std::uint32_t>(),
+			.kind = in.read<ReplayInput::Kind>(),
+			.value = in.read<std::int32_t>(),
+			.x = in.read<std::int32_t>(),
+			.y = in.read<std::int32_t>(),
+		};
+		if (input.kind > ReplayInput::Kind::Rewind) {
+			throw std::runtime_error("Corrupt replay: unknown input");
+		}
+		if (input.tick < last_tick) {
+			throw std::runtime_error("Corrupt replay: inputs out of order");
+		}
+
+		last_tick = input.tick;
+		replay.inputs.push_back(input);
+	}
+
+	if (!in.atEnd()) {
+		throw std::runtime_error("Corrupt replay: trailing bytes");
+	}
+	return replay;
+}
+
+} // namespace wf
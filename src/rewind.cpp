@@ -0,0 +1,141 @@
+#include "wforge/rewind.h"
+#include "wforge/level.h"
+#include "wforge/savestate.h"
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+
+namespace wf {
+
+RewindBuffer::RewindBuffer(
+	int capacity, int keyframe_interval, std::size_t max_bytes
+)
+	: _capacity(std::max(capacity, 1))
+	, _keyframe_interval(std::max(keyframe_interval, 1))
+	, _max_bytes(max_bytes) {}
+
+void RewindBuffer::record(Level &level) {
+	while (size() > _position + 1) {
+		_bytes -= _frames.back().bytes();
+		_frames.pop_back();
+	}
+
+	Frame frame;
+	if (_previous) {
+		StateWriter tile_delta;
+		level.fallsand.saveTileDelta(tile_delta, *_previous);
+		frame.tile_delta = tile_delta.takeBytes();
+	}
+
+	StateWriter state;
+	level.writeState(state, false);
+	frame.state = state.takeBytes();
+
+	// One keyframe every keyframe_interval ticks at most
+	bool keyframe_due = true;
+	for (int i = _position; i >= 0 && i > _position - _keyframe_interval + 1;
+	     --i) {
+		if (!_frames[i].keyframe.empty()) {
+			keyframe_due = false;
+			break;
+		}
+	}
+	if (keyframe_due) {
+		frame.keyframe = level.saveState();
+	}
+
+	_bytes += frame.bytes();
+	_frames.push_back(std::move(frame));
+	_position = size() - 1;
+	forkWorld(level);
+
+	while (size() > 1 && (size() > _capacity || memoryUsage() > _max_bytes)) {
+		dropOldest();
+	}
+}
+
+bool RewindBuffer::stepBackward(Level &level) {
+	if (_position <= 0) {
+		return false;
+	}
+
+	moveTo(level, _position - 1);
+	forkWorld(level);
+	return true;
+}
+
+bool RewindBuffer::stepForward(Level &level) {
+	if (_position + 1 >= size()) {
+		return false;
+	}
+
+	moveTo(level, _position + 1);
+	forkWorld(level);
+	return true;
+}
+
+void RewindBuffer::seek(Level &level, int index) {
+	if (_frames.empty()) {
+		return;
+	}
+
+	index = std::clamp(index, 0, size() - 1);
+
+	// Restoring a keyframe costs about as much as a few deltas, so one is
+	// only taken if it is closer than the current tick
+	int keyframe = index;
+	while (keyframe >= 0 && _frames[keyframe].keyframe.empty()) {
+		--keyframe;
+	}
+	if (keyframe >= 0 && index - keyframe < std::abs(index - _position)) {
+		level.loadState(_frames[keyframe].keyframe);
+		_position = keyframe;
+	}
+
+	while (_position < index) {
+		moveTo(level, _position + 1);
+	}
+	while (_position > index) {
+		moveTo(level, _position - 1);
+	}
+	forkWorld(level);
+}
+
+void RewindBuffer::clear() noexcept {
+	_frames.clear();
+	_position = -1;
+	_bytes = 0;
+	_previous.reset();
+	_pinned_bytes = 0;
+}
+
+void RewindBuffer::dropOldest() noexcept {
+	_bytes -= _frames.front().bytes();
+	_frames.pop_front();
+	--_position;
+
+	// The tick the delta of the new oldest one leads to is gone
+	auto &oldest = _frames.front();
+	_bytes -= oldest.tile_delta.size();
+	oldest.tile_delta = {};
+}
+
+void RewindBuffer::moveTo(Level &level, int index) {
+	StateReader tile_delta(_frames[std::max(index, _position)].tile_delta);
+	level.fallsand.applyTileDelta(tile_delta);
+
+	StateReader state(_frames[index].state);
+	level.readState(state, false);
+	_position = index;
+}
+
+void RewindBuffer::forkWorld(Level &level) {
+	// Tiles the world copied since the last fork, the old fork held on to
+	// the tiles they were copied from until now
+	_pinned_bytes = _previous
+		? level.fallsand.ownedTileCount() * sizeof(PixelTile)
+		: 0;
+	_previous = level.fallsand.fork();
+}
+
+} // namespace wf
@@ -63,6 +63,7 @@ void loadUserSettings(UserSettings &settings, nlohmann::json &json_data) {
 	);
 	settings.skip_animations = json_data.value("skip_animations", false);
 	settings.debug_heat_render = json_data.value("debug_heat_render", false);
+	settings.pass_interval = json_data.value("pass_interval", 1);
 }
 
 void loadSaveData(SaveData &data, nlohmann::json &json_data) {
@@ -114,6 +115,7 @@ void SaveData::save() const {
 		{"strict_pixel_perfection", user_settings.strict_pixel_perfection},
 		{"skip_animations", user_settings.skip_animations},
 		{"debug_heat_render", user_settings.debug_heat_render},
+		{"pass_interval", user_settings.pass_interval},
 	};
 
 	std::ofstream file(path);
@@ -153,6 +155,7 @@ UserSettings UserSettings::defaultSettings() noexcept {
 		.strict_pixel_perfection = false,
 		.skip_animations = false,
 		.debug_heat_render = false,
+		.pass_interval = 1,
 	};
 }
 
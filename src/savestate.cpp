@@ -0,0 +1,120 @@
+#include "wforge/savestate.h"
+#include <algorithm>
+#include <bit>
+#include <format>
+#include <stdexcept>
+
+namespace wf {
+
+static_assert(
+	std::endian::native == std::endian::little,
+	"Save states are stored little endian"
+);
+
+namespace {
+
+// A control byte below 128 is followed by that many plus one literal bytes,
+// any other by a byte repeated that many minus 125 times
+constexpr std::size_t max_literals = 128;
+constexpr std::size_t min_run = 3;
+constexpr std::size_t max_run = 255 - 128 + min_run;
+
+} // namespace
+
+void StateWriter::writeString(std::string_view str) {
+	write<std::uint32_t>(str.size());
+	_bytes.insert(_bytes.end(), str.begin(), str.end());
+}
+
+void StateWriter::writePacked(std::span<const std::uint8_t> bytes) {
+	const std::uint8_t *src = bytes.data();
+	const std::size_t size = bytes.size();
+	auto starts_run = [&](std::size_t i) {
+		return i + min_run <= size && src[i] == src[i + 1]
+			&& src[i] == src[i + 2];
+	};
+
+	// Literals take one control byte per max_literals bytes, runs shrink
+	const std::size_t offset = _bytes.size();
+	_bytes.resize(offset + size + size / max_literals + 1);
+	std::uint8_t *dst = _bytes.data() + offset;
+
+	std::size_t i = 0;
+	while (i < size) {
+		if (starts_run(i)) {
+			// Word by word first, runs of zeros fill most planes
+			const std::size_t limit = std::min(size - i, max_run);
+			const std::uint64_t pattern = src[i] * 0x0101010101010101ull;
+			std::size_t run = min_run;
+			for (std::uint64_t word; run + 8 <= limit; run += 8) {
+				std::memcpy(&word, src + i + run, 8);
+				if (word != pattern) {
+					break;
+				}
+			}
+			while (run < limit && src[i + run] == src[i]) {
+				++run;
+			}
+			*dst++ = 128 + run - min_run;
+			*dst++ = src[i];
+			i += run;
+			continue;
+		}
+
+		// Literals up to the next run
+		std::size_t end = i + 1;
+		while (end < size && end - i < max_literals && !starts_run(end)) {
+			++end;
+		}
+		*dst++ = end - i - 1;
+		std::memcpy(dst, src + i, end - i);
+		dst += end - i;
+		i = end;
+	}
+	_bytes.resize(dst - _bytes.data());
+}
+
+std::string StateReader::readString() {
+	const auto size = read<std::uint32_t>();
+	const auto *chars = reinterpret_cast<const char *>(take(size));
+	return std::string(chars, size);
+}
+
+void StateReader::readPacked(std::span<std::uint8_t> out) {
+	std::size_t i = 0;
+	while (i < out.size()) {
+		const std::uint8_t control = read<std::uint8_t>();
+		const std::size_t count = control < 128
+			? control + 1
+			: control - 128 + min_run;
+		if (count > out.size() - i) {
+			throw std::runtime_error(
+				"Corrupt save state: packed bytes overflow their plane"
+			);
+		}
+
+		if (control < 128) {
+			std::memcpy(&out[i], take(count), count);
+		} else {
+			std::memset(&out[i], read<std::uint8_t>(), count);
+		}
+		i += count;
+	}
+}
+
+const std::uint8_t *StateReader::take(std::size_t count) {
+	if (count > _bytes.size() - _pos) {
+		throw std::runtime_error(
+			std::format(
+				"Corrupt save state: ends after {} bytes, {} more expected",
+				_bytes.size(), count
+			)
+		);
+	}
+
+	const std::uint8_t *bytes = &_bytes[_pos];
+	_pos += count;
+	return bytes;
+}
+
+} // namespace wf
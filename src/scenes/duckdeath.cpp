@@ -25,7 +25,7 @@ PixelAnimationFrames &duckDeathAnimation() {
 
 DuckDeath::DuckDeath(
 	int level_width, int level_height, int duck_x, int duck_y,
-	LevelMetadata level_metadata
+	Level pristine_level
 )
 	: _level_width(level_width)
 	, _level_height(level_height)
@@ -33,7 +33,7 @@ DuckDeath::DuckDeath(
 	, _duck_y(duck_y)
 	, _tick(0)
 	, _animation_frame(0)
-	, _level_metadata(std::move(level_metadata))
+	, _pristine_level(std::move(pristine_level))
 	, _animation(duckDeathAnimation())
 	, _reborn_sound(
 		  AssetsManager::instance().getAsset<sf::SoundBuffer>("sfx/duckdeath")
@@ -102,7 +102,7 @@ void DuckDeath::step(SceneManager &mgr) {
 		_reborn_sound.stop();
 		mgr.changeScene(
 			pro::make_proxy<SceneFacade, LevelPlaying>(
-				Level::loadFromMetadata(std::move(_level_metadata))
+				std::move(_pristine_level)
 			)
 		);
 		return;
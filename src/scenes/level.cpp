@@ -5,7 +5,14 @@
 #include "wforge/scene.h"
 #include <SFML/Window/Event.hpp>
 #include <SFML/Window/Keyboard.hpp>
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <optional>
 #include <proxy/v4/proxy.h>
 #include <string_view>
 
@@ -32,6 +39,8 @@ auto loadFont() {
 constexpr int hint_fade_speed = 3;
 constexpr int hint_max_opacity = 200;
 
+std::optional<std::filesystem::path> record_path;
+
 enum HintType {
 	None = 0,
 	RestartLevel,
@@ -51,6 +60,16 @@ std::string_view hintTextOf(int type) {
 	}
 }
 
+// The global passes of the level run at most as often as the user settings
+// allow
+Level withUserPassInterval(Level level) {
+	const int interval = SaveData::instance().user_settings.pass_interval;
+	auto &world = level.fallsand;
+	world.setFluidInterval(std::max(world.fluidInterval(), interval));
+	world.setThermalInterval(std::max(world.thermalInterval(), interval));
+	return level;
+}
+
 } // namespace
 
 LevelPlaying::LevelPlaying(const std::string &level_id)
@@ -67,12 +86,47 @@ LevelPlaying::LevelPlaying(Level level)
 	, _paused(false)
 	, _show_help(false)
 	, _paused_menu_current_button_index(PausedMenuButton::RESUME)
-	, _level(std::move(level))
+	, _level(withUserPassInterval(std::move(level)))
+	, _pristine_level(_level.fork())
+	, _rewind(rewind_ticks, rewind_keyframe_interval, rewind_max_bytes)
+	, _rewinding(false)
 	, _renderer(_level)
 	, _hint_type(HintType::None)
 	, _hint_opacity(0)
 	, font(*loadFont()) {
 	_help_texture = &AssetsManager::instance().getAsset<sf::Texture>("ui/help");
+	_level.fallsand.setParallelStep(true);
+	_rewind.record(_level);
+
+	if (record_path) {
+		_replay = std::make_unique<Replay>(
+			Replay{
+				.map_id = _level.metadata.map_id,
+				.run_seed = Level::runSeed().value_or(""),
+				.fluid_interval = _level.fallsand.fluidInterval(),
+				.thermal_interval = _level.fallsand.thermalInterval(),
+			}
+		);
+	}
+}
+
+LevelPlaying::~LevelPlaying() {
+	if (!_replay) {
+		return; // not recording, or moved from
+	}
+
+	try {
+		_replay->num_ticks = _tick;
+		_replay->end_digest = Replay::digestOf(_level.saveState());
+		_replay->save(*record_path);
+	} catch (const std::exception &e) {
+		std::cerr << "Warning: failed to record the replay: " << e.what()
+				  << "\n";
+	}
+}
+
+void LevelPlaying::setRecordPath(std::filesystem::path path) {
+	record_path = std::move(path);
 }
 
 std::array<int, 2> LevelPlaying::size() const {
@@ -81,7 +135,7 @@ std::array<int, 2> LevelPlaying::size() const {
 
 void LevelPlaying::setup(SceneManager &mgr) {
 	mgr.setWindowTitle(std::format("Level {} - {}", _level.metadata.index + 1, _level.metadata.name));
-	_level.selectItem(0);
+	_input(ReplayInput::Kind::SelectItem, 0);
 	mgr.bgm.setCollection("background/level-music");
 	const auto &bgm_fade = FadeIOConfig::load();
 	mgr.bgm.fadeInCurrent(
@@ -91,6 +145,10 @@ void LevelPlaying::setup(SceneManager &mgr) {
 
 void LevelPlaying::pause(SceneManager &mgr) noexcept {
 	_paused = true;
+	if (_rewinding) {
+		// The release would be ignored
+		_input(ReplayInput::Kind::Rewind, 0);
+	}
 	mgr.bgm.setVolume(0.15f);
 }
 
@@ -180,16 +238,25 @@ void LevelPlaying::handleEvent(SceneManager &mgr, sf::Event &ev) {
 
 	if (auto mw = ev.getIf<sf::Event::MouseWheelScrolled>()) {
 		if (mw->delta > 0) {
-			_level.changeActiveItemBrushSize(1);
+			_input(ReplayInput::Kind::ChangeBrushSize, 1);
 		} else if (mw->delta < 0) {
-			_level.changeActiveItemBrushSize(-1);
+			_input(ReplayInput::Kind::ChangeBrushSize, -1);
 		}
 	}
 
 	if (auto mb = ev.getIf<sf::Event::MouseButtonPressed>()) {
 		auto mouse_pos = mgr.mousePosition();
 		if (mb->button == sf::Mouse::Button::Left) {
-			_level.useActiveItem(mouse_pos.x, mouse_pos.y, mgr.scale());
+			_input(
+				ReplayInput::Kind::UseItem, mgr.scale(), mouse_pos.x,
+				mouse_pos.y
+			);
+		}
+	}
+
+	if (auto kb = ev.getIf<sf::Event::KeyReleased>()) {
+		if (kb->code == sf::Keyboard::Key::Backspace && _rewinding) {
+			_input(ReplayInput::Kind::Rewind, 0);
 		}
 	}
 
@@ -206,12 +273,12 @@ void LevelPlaying::handleEvent(SceneManager &mgr, sf::Event &ev) {
 		const int key_code = static_cast<int>(kb->code);
 		if (key_code >= min_num_key && key_code <= max_num_key) {
 			int index = key_code - min_num_key;
-			_level.selectItem(index);
+			_input(ReplayInput::Kind::SelectItem, index);
 			return;
 		}
 		if (key_code >= min_numpad_key && key_code <= max_numpad_key) {
 			int index = key_code - min_numpad_key;
-			_level.selectItem(index);
+			_input(ReplayInput::Kind::SelectItem, index);
 			return;
 		}
 
@@ -234,16 +301,22 @@ void LevelPlaying::handleEvent(SceneManager &mgr, sf::Event &ev) {
 			pause(mgr);
 			break;
 
+		case sf::Keyboard::Key::Backspace:
+			if (!_rewinding) {
+				_input(ReplayInput::Kind::Rewind, 1); // key repeat aside
+			}
+			break;
+
 		case sf::Keyboard::Key::Up:
 		case sf::Keyboard::Key::PageUp:
 		case sf::Keyboard::Key::W:
-			_level.prevItem();
+			_input(ReplayInput::Kind::PrevItem);
 			break;
 
 		case sf::Keyboard::Key::Down:
 		case sf::Keyboard::Key::PageDown:
 		case sf::Keyboard::Key::S:
-			_level.nextItem();
+			_input(ReplayInput::Kind::NextItem);
 			break;
 
 		default:
@@ -252,6 +325,25 @@ void LevelPlaying::handleEvent(SceneManager &mgr, sf::Event &ev) {
 	}
 }
 
+void LevelPlaying::_input(ReplayInput::Kind kind, int value, int x, int y) {
+	const ReplayInput input{
+		.tick = static_cast<std::uint32_t>(_tick),
+		.kind = kind,
+		.value = value,
+		.x = x,
+		.y = y,
+	};
+	if (_replay) {
+		_replay->inputs.push_back(input);
+	}
+
+	if (kind == ReplayInput::Kind::Rewind) {
+		_rewinding = value != 0;
+	} else {
+		input.applyTo(_level);
+	}
+}
+
 void LevelPlaying::_restartLevel(SceneManager &mgr, bool is_failed) {
 	int duck_x = std::round(_level.duck.position.x);
 	int duck_y = std::round(_level.duck.position.y);
@@ -268,7 +360,7 @@ void LevelPlaying::_restartLevel(SceneManager &mgr, bool is_failed) {
 	mgr.changeScene(
 		pro::make_proxy<SceneFacade, DuckDeath>(
 			_level.width(), _level.height(), duck_x, duck_y,
-			LevelMetadata(_level.metadata)
+			std::move(_pristine_level)
 		)
 	);
 	return;
@@ -355,7 +447,12 @@ void LevelPlaying::step(SceneManager &mgr) {
 	// Only step the level when not paused
 	if (!_paused) {
 		_tick += 1;
-		_level.step();
+		if (_rewinding) {
+			_rewind.stepBackward(_level);
+		} else {
+			_level.step();
+			_rewind.record(_level);
+		}
 	}
 
 	if (_hint_opacity > 0) {
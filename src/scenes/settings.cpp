@@ -136,6 +136,37 @@ struct SkipAnimationsOption : SettingsMenu::Option {
 	}
 };
 
+struct PhysicsRateOption : SettingsMenu::Option {
+	std::string displayText() const override {
+		return "Physics Rate";
+	}
+
+	std::string valueText() const override {
+		int interval = SaveData::instance().user_settings.pass_interval;
+		if (interval <= 1) {
+			return "Full";
+		} else {
+			return std::format("1/{}", interval);
+		}
+	}
+
+	void handleLeft() override {
+		auto &settings = SaveData::instance().user_settings;
+		if (settings.pass_interval < PixelWorld::max_pass_interval) {
+			settings.pass_interval += 1;
+			SaveData::instance().save();
+		}
+	}
+
+	void handleRight() override {
+		auto &settings = SaveData::instance().user_settings;
+		if (settings.pass_interval > 1) {
+			settings.pass_interval -= 1;
+			SaveData::instance().save();
+		}
+	}
+};
+
 struct DebugHeatRenderOption : SettingsMenu::Option {
 	std::string displayText() const override {
 		return "Debug Heat Render";
@@ -237,6 +268,7 @@ SettingsMenu::SettingsMenu()
 	_options.push_back(std::make_unique<VolumnOption>());
 	_options.push_back(std::make_unique<StrictPixelPerfectionOption>());
 	_options.push_back(std::make_unique<SkipAnimationsOption>());
+	_options.push_back(std::make_unique<PhysicsRateOption>());
 
 #ifndef NDEBUG
 	_options.push_back(std::make_unique<DebugHeatRenderOption>());
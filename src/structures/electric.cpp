@@ -1,3 +1,4 @@
+#include "wforge/savestate.h"
 #include "wforge/structures.h"
 
 namespace wf {
@@ -32,6 +33,16 @@ break2:
 	return true;
 }
 
+void InputElectricalStructure::saveState(StateWriter &out) const {
+	PixelShapedStructure::saveState(out);
+	out.write<std::int32_t>(_power_cap);
+}
+
+void InputElectricalStructure::loadState(StateReader &in) {
+	PixelShapedStructure::loadState(in);
+	_power_cap = in.read<std::int32_t>();
+}
+
 OutputElectricalStructure::OutputElectricalStructure(
 	int x, int y, const PixelShape &shape
 ) noexcept
@@ -1,7 +1,10 @@
-#include "wforge/elements.h"
 #include "wforge/fallsand.h"
+#include "wforge/savestate.h"
 #include "wforge/structures.h"
+#include <algorithm>
 #include <cstdlib>
+#include <format>
+#include <stdexcept>
 
 namespace wf::structure {
 
@@ -91,7 +94,7 @@ Gate::Gate(int x, int y, FacingDirection dir)
 		break;
 	}
 
-	_gate_wall_pixel_types = std::make_unique<PixelTypeAndColor[]>(
+	_gate_wall_pixel_types = std::make_shared<PixelTypeAndColor[]>(
 		_gate_wall_shape.width() * _gate_wall_shape.height()
 	);
 	for (int i = 0; i < _gate_wall_shape.width(); ++i) {
@@ -143,7 +146,7 @@ bool Gate::_canPlaceAt(
 				continue;
 			}
 
-			auto tag = world.tagOf(wx, wy);
+			PixelTag tag = world.tagOf(wx, wy);
 			if (tag.pclass == PixelClass::Solid) {
 				if (block_x) {
 					*block_x = wx;
@@ -172,37 +175,22 @@ void Gate::_placeTo(
 	int offset_x = -progress * dx;
 	int offset_y = -progress * dy;
 
-	for (int i = 0; i < _gate_wall_shape.width(); ++i) {
-		int wx = _base_place_x + offset_x + i;
-		if (wx < 0 || wx >= world.width()) {
-			continue;
+	static constexpr PixelTypeAndColor air{PixelType::Air, 255};
+	world.fillMask(
+		_base_place_x + offset_x, _base_place_y + offset_y,
+		_gate_wall_shape.width(), _gate_wall_shape.height(),
+		[this, remove](int i, int j) -> const PixelTypeAndColor * {
+		if (!_gate_wall_shape.hasPixel(i, j)) {
+			return nullptr;
 		}
-
-		for (int j = 0; j < _gate_wall_shape.height(); ++j) {
-			if (!_gate_wall_shape.hasPixel(i, j)) {
-				continue;
-			}
-			int wy = _base_place_y + offset_y + j;
-			if (wy < 0 || wy >= world.height()) {
-				continue;
-			}
-
-			auto &tag = world.tagOf(wx, wy);
-			int old_heat = tag.heat;
-			if (remove) {
-				world.replacePixelWithAir(wx, wy);
-			} else {
-				auto p = _gate_wall_pixel_types
-					[j * _gate_wall_shape.width() + i];
-				world.replacePixel(wx, wy, constructElementByType(p.type));
-
-				if (tag.color_index != 255) {
-					tag.color_index = p.color_index;
-				}
-			}
-			tag.heat = old_heat;
+		if (remove) {
+			return &air;
 		}
-	}
+		return &_gate_wall_pixel_types[j * _gate_wall_shape.width() + i];
+	},
+		AnyPixel{},
+		true // keep heat
+	);
 }
 
 bool Gate::step(PixelWorld &world) noexcept {
@@ -264,7 +252,7 @@ void Gate::customRender(
 			}
 
 			int buf_index = (wy * world.width() + wx) * 4;
-			sf::Color color = _gate_wall_shape.colorOf(i, j);
+			RGBAColor color = _gate_wall_shape.colorOf(i, j);
 			buf[buf_index + 0] = color.r;
 			buf[buf_index + 1] = color.g;
 			buf[buf_index + 2] = color.b;
@@ -277,4 +265,19 @@ int Gate::priority() const noexcept {
 	return 5; // gates must be earlier than lasers
 }
 
+void Gate::saveState(StateWriter &out) const {
+	InputElectricalStructure::saveState(out);
+	out.write<std::int32_t>(_open_state);
+}
+
+void Gate::loadState(StateReader &in) {
+	InputElectricalStructure::loadState(in);
+	_open_state = in.read<std::int32_t>();
+	if (_open_state < 0 || _open_state > _max_open_length * gate_open_speed) {
+		throw std::runtime_error(
+			std::format("Corrupt save state: gate open by {}", _open_state)
+		);
+	}
+}
+
 } // namespace wf::structure
@@ -39,8 +39,9 @@ bool Heater::step(PixelWorld &world) noexcept {
 
 	if (isPowered()) {
 		for (auto [bx, by] : poi) {
-			auto &tag = world.tagOf(x + bx, y + by);
+			auto tag = world.tagOf(x + bx, y + by);
 			tag.heat = std::min(tag.heat + heat_production, PixelTag::heat_max);
+			world.markActive(x + bx, y + by);
 		}
 	}
 
@@ -1,5 +1,5 @@
 #include "wforge/2d.h"
-#include "wforge/assets.h"
+#include "wforge/assetcache.h"
 #include "wforge/fallsand.h"
 #include "wforge/structures.h"
 #include <format>
@@ -53,7 +53,7 @@ void shootLaserBeam(
 		for (; cur_x >= 0 && cur_x < world.width() && cur_y >= 0
 		     && cur_y < world.height();
 		     (cur_x += dx), (cur_y += dy)) {
-			auto &pixel_tag = world.tagOf(cur_x, cur_y);
+			auto pixel_tag = world.tagOf(cur_x, cur_y);
 
 			// Solid and smoke can block the laser beam
 			if (pixel_tag.pclass == PixelClass::Solid) {
@@ -65,6 +65,7 @@ void shootLaserBeam(
 				}
 
 				pixel_tag.heat += laser_heat_amount;
+				world.markActive(cur_x, cur_y);
 				return;
 			}
 
@@ -85,7 +86,7 @@ void shootLaserBeam(
 				continue;
 			}
 
-			auto &check_tag = world.tagOf(check_x, check_y);
+			auto check_tag = world.tagOf(check_x, check_y);
 			if (check_tag.pclass == PixelClass::Solid) {
 				continue;
 			}
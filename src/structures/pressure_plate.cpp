@@ -37,7 +37,7 @@ bool PressurePlate::step(PixelWorld &world) noexcept {
 
 	bool powered = false;
 	for (const auto &[px, py] : poi) {
-		auto tag = world.tagOf(x + px, y + py);
+		PixelTag tag = world.tagOf(x + px, y + py);
 		if (tag.pclass == PixelClass::Solid
 		    || tag.pclass == PixelClass::Fluid) {
 			powered = true;
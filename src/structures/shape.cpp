@@ -1,5 +1,5 @@
-#include "wforge/assets.h"
-#include "wforge/elements.h"
+#include "wforge/pixelshape.h"
+#include "wforge/savestate.h"
 #include "wforge/structures.h"
 #include <format>
 #include <memory>
@@ -19,7 +19,7 @@ PixelShapedStructure::PixelShapedStructure(
 	: PositionedStructure(x, y)
 	, _shape(shape)
 	, _pixel_types(
-		  std::make_unique<PixelTypeAndColor[]>(shape.width() * shape.height())
+		  std::make_shared<PixelTypeAndColor[]>(shape.width() * shape.height())
 	  ) {
 	for (int sy = 0; sy < shape.height(); ++sy) {
 		for (int sx = 0; sx < shape.width(); ++sx) {
@@ -46,23 +46,21 @@ void PixelShapedStructure::setup(PixelWorld &world) {
 		);
 	}
 
-	for (int sy = 0; sy < height(); ++sy) {
-		for (int sx = 0; sx < width(); ++sx) {
-			int wx = x + sx;
-			int wy = y + sy;
-			auto p = _pixel_types[sy * width() + sx];
-			if (p.type == PixelType::Air) {
-				continue;
-			}
-
-			world.replacePixel(wx, wy, constructElementByType(p.type));
-			if (p.color_index != 255) {
-				world.tagOf(wx, wy).color_index = p.color_index;
-			}
-		}
-	}
+	// Air in the shape leaves the world as it is
+	world.fillMask(
+		x, y, width(), height(),
+		[this](int sx, int sy) -> const PixelTypeAndColor * {
+		const auto &p = _pixel_types[sy * width() + sx];
+		return p.type == PixelType::Air ? nullptr : &p;
+	},
+		AnyPixel{}
+	);
 }
 
+void PixelShapedStructure::saveState(StateWriter &out) const {}
+
+void PixelShapedStructure::loadState(StateReader &in) {}
+
 PixelType PixelShapedStructure::pixelTypeOf(int px, int py) const noexcept {
 #ifndef NDEBUG
 	if (px < 0 || px >= width() || py < 0 || py >= height()) {
@@ -92,7 +90,7 @@ void PixelShapedStructure::customRender(
 			}
 
 			int buf_index = (world_y * world.width() + world_x) * 4;
-			sf::Color color = _shape.colorOf(sx, sy);
+			RGBAColor color = _shape.colorOf(sx, sy);
 			buf[buf_index + 0] = color.r;
 			buf[buf_index + 1] = color.g;
 			buf[buf_index + 2] = color.b;
@@ -40,7 +40,7 @@ bool WaterTap::step(PixelWorld &world) noexcept {
 		for (const auto &[px, py] : poi) {
 			int wx = x + px;
 			int wy = y + py;
-			auto &tag = world.tagOf(wx, wy);
+			auto tag = world.tagOf(wx, wy);
 			if (tag.pclass == PixelClass::Gas) {
 				world.replacePixel(wx, wy, element::Water::create());
 			}
@@ -69,7 +69,7 @@ bool OilTap::step(PixelWorld &world) noexcept {
 		for (const auto &[px, py] : poi) {
 			int wx = x + px;
 			int wy = y + py;
-			auto &tag = world.tagOf(wx, wy);
+			auto tag = world.tagOf(wx, wy);
 			if (tag.pclass == PixelClass::Gas) {
 				world.replacePixel(wx, wy, element::Oil::create());
 			}
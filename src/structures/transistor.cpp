@@ -1,5 +1,6 @@
-#include "wforge/assets.h"
+#include "wforge/assetcache.h"
 #include "wforge/elements.h"
+#include "wforge/savestate.h"
 #include "wforge/structures.h"
 
 namespace wf::structure {
@@ -37,7 +38,7 @@ bool TransistorNPN::step(PixelWorld &world) noexcept {
 		for (auto [bx, by] : poi) {
 			int wx = x + bx;
 			int wy = y + by;
-			auto &tag = world.tagOf(wx, wy);
+			auto tag = world.tagOf(wx, wy);
 			int old_heat = tag.heat;
 			if (_conducting) {
 				world.replacePixel(wx, wy, element::Copper::create());
@@ -54,6 +55,16 @@ int TransistorNPN::priority() const noexcept {
 	return 5; // must be earlier than lasers
 }
 
+void TransistorNPN::saveState(StateWriter &out) const {
+	InputElectricalStructure::saveState(out);
+	out.write<std::uint8_t>(_conducting);
+}
+
+void TransistorNPN::loadState(StateReader &in) {
+	InputElectricalStructure::loadState(in);
+	_conducting = in.read<std::uint8_t>() != 0;
+}
+
 TransistorPNP::TransistorPNP(int x, int y, FacingDirection dir)
 	: InputElectricalStructure(x, y, transistorShape(dir))
 	, _dir(dir)
@@ -74,7 +85,7 @@ bool TransistorPNP::step(PixelWorld &world) noexcept {
 		for (auto [bx, by] : poi) {
 			int wx = x + bx;
 			int wy = y + by;
-			auto &tag = world.tagOf(wx, wy);
+			auto tag = world.tagOf(wx, wy);
 			int old_heat = tag.heat;
 			if (_insulating) {
 				world.replacePixelWithAir(wx, wy);
@@ -91,4 +102,14 @@ int TransistorPNP::priority() const noexcept {
 	return 5; // must be earlier than lasers
 }
 
+void TransistorPNP::saveState(StateWriter &out) const {
+	InputElectricalStructure::saveState(out);
+	out.write<std::uint8_t>(_insulating);
+}
+
+void TransistorPNP::loadState(StateReader &in) {
+	InputElectricalStructure::loadState(in);
+	_insulating = in.read<std::uint8_t>() != 0;
+}
+
 } // namespace wf::structure
@@ -2,6 +2,7 @@
 #include <bit>
 #include <initializer_list>
 #include <random>
+#include <utility>
 
 namespace wf {
 
@@ -32,6 +33,10 @@ Seed Seed::device_random() {
 
 Xoroshiro128PP::Xoroshiro128PP(Seed seed) noexcept: seed(seed) {}
 
+Seed Xoroshiro128PP::state() const noexcept {
+	return seed;
+}
+
 std::uint64_t Xoroshiro128PP::next() noexcept {
 	std::uint64_t s0 = seed.s[0];
 	std::uint64_t s1 = seed.s[1];
@@ -49,15 +54,16 @@ Xoroshiro128PP Xoroshiro128PP::jump_64() const noexcept {
 		0x180ec6d33cfd0aba, 0xd5a61266f0c9392c
 	};
 
-	Xoroshiro128PP res{seed};
+	Xoroshiro128PP res{Seed{0, 0}};
+	Xoroshiro128PP cur{seed};
 
 	for (int i : {0, 1}) {
 		for (int b = 0; b < 64; ++b) {
 			if (JUMP_64[i] & (1ULL << b)) {
-				res.seed.s[0] ^= seed.s[0];
-				res.seed.s[1] ^= seed.s[1];
+				res.seed.s[0] ^= cur.seed.s[0];
+				res.seed.s[1] ^= cur.seed.s[1];
 			}
-			res.next();
+			cur.next();
 		}
 	}
 
@@ -69,24 +75,41 @@ Xoroshiro128PP Xoroshiro128PP::jump_96() const noexcept {
 		0x360fd5f2cf8d5d99, 0x9c6e6877736c46e3
 	};
 
-	Xoroshiro128PP res{seed};
+	Xoroshiro128PP res{Seed{0, 0}};
+	Xoroshiro128PP cur{seed};
 
 	for (int i : {0, 1}) {
 		for (int b = 0; b < 64; ++b) {
 			if (JUMP_96[i] & (1ULL << b)) {
-				res.seed.s[0] ^= seed.s[0];
-				res.seed.s[1] ^= seed.s[1];
+				res.seed.s[0] ^= cur.seed.s[0];
+				res.seed.s[1] ^= cur.seed.s[1];
 			}
-			res.next();
+			cur.next();
 		}
 	}
 
 	return res;
 }
 
+namespace {
+
+thread_local Xoroshiro128PP *thread_instance = nullptr;
+
+} // namespace
+
 Xoroshiro128PP &Xoroshiro128PP::globalInstance() noexcept {
+	if (thread_instance != nullptr) {
+		return *thread_instance;
+	}
+
 	static Xoroshiro128PP instance(Seed::device_random());
 	return instance;
 }
 
+Xoroshiro128PP *Xoroshiro128PP::bindThreadInstance(
+	Xoroshiro128PP *rng
+) noexcept {
+	return std::exchange(thread_instance, rng);
+}
+
 } // namespace wf
\ No newline at end of file